@@ -0,0 +1,315 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/chashmap.h"
+#include "bench_util.h"
+
+/*
+ * Microbenchmarks for the core HashMap operations.
+ *
+ * Every configuration (key distribution, key size, value size, table size)
+ * builds a map and times: insert, hit and miss lookups, update, two
+ * read/update mixes, iteration, remove and destroy. Table sizes are derived
+ * from the cache sizes: about half of L1, L2 and L3, and 10x L3.
+ *
+ * Usage: chashmap_bench [--quick] [--ops N] [--max-mb N] [--only uniform|zipf]
+ */
+
+typedef enum
+{
+    DIST_UNIFORM,
+    DIST_ZIPF
+} Distribution;
+
+static const char *const dist_names[] = {"uniform", "zipf"};
+
+typedef struct
+{
+    size_t ops;    // Operations per timed lookup/update/mix phase
+    size_t max_mb; // Cap on the largest table's estimated footprint
+    int quick;
+    int only;      // -1 = both distributions
+} Options;
+
+typedef struct
+{
+    Distribution dist;
+    size_t key_size;
+    size_t val_size;
+    size_t entries;
+    const char *tier; // Which cache level the table was sized for
+} Config;
+
+typedef struct
+{
+    unsigned char *keys;     // `entries` keys, key_size bytes each
+    unsigned char *misses;   // `entries` keys that are never inserted
+    unsigned char *value;
+    uint32_t *stream;        // `ops` key indices drawn from the distribution
+    unsigned char *is_write; // `ops` values in [0, 100) choosing reads vs updates
+} Workload;
+
+static void report(const Config *c, const char *op, size_t count, uint64_t ns)
+{
+    double per_op = count ? (double)ns / (double)count : 0.0;
+    double mops = ns ? (double)count * 1e3 / (double)ns : 0.0;
+    printf("%-8s %4zu %4zu %10zu %-4s %-12s %9.1f %9.2f %9.1f\n",
+           dist_names[c->dist], c->key_size, c->val_size, c->entries, c->tier, op,
+           per_op, mops, (double)bench_rss_bytes() / (1024.0 * 1024.0));
+    fflush(stdout);
+}
+
+/**
+ * Rough bytes per entry: the entry, out-of-line key/value copies, malloc
+ * headers and the bucket pointer at the default load factor.
+ */
+static size_t estimate_entry_bytes(size_t key_size, size_t val_size)
+{
+    size_t bytes = sizeof(HashMapEntry) + 16 + 11;
+    if (key_size > HASHMAP_INLINE_SIZE)
+        bytes += key_size + 16;
+    if (val_size > HASHMAP_INLINE_SIZE)
+        bytes += val_size + 16;
+    return bytes;
+}
+
+static int make_workload(const Config *c, const Options *o, Workload *w)
+{
+    w->keys = (unsigned char *)malloc(c->entries * c->key_size);
+    w->misses = (unsigned char *)malloc(c->entries * c->key_size);
+    w->value = (unsigned char *)malloc(c->val_size);
+    w->stream = (uint32_t *)malloc(o->ops * sizeof(uint32_t));
+    w->is_write = (unsigned char *)malloc(o->ops);
+    if (!w->keys || !w->misses || !w->value || !w->stream || !w->is_write)
+        return -1;
+
+    for (size_t i = 0; i < c->entries; i++)
+    {
+        bench_make_key(w->keys + i * c->key_size, c->key_size, i);
+        bench_make_key(w->misses + i * c->key_size, c->key_size, i + c->entries);
+    }
+    memset(w->value, 0xab, c->val_size);
+
+    uint64_t rng = 42;
+    BenchZipf zipf;
+    memset(&zipf, 0, sizeof(zipf));
+    if (c->dist == DIST_ZIPF)
+        bench_zipf_init(&zipf, c->entries, 0.99);
+    for (size_t i = 0; i < o->ops; i++)
+    {
+        uint64_t k = c->dist == DIST_ZIPF ? bench_zipf_scrambled(&zipf, &rng)
+                                          : bench_rand(&rng) % c->entries;
+        w->stream[i] = (uint32_t)k;
+        w->is_write[i] = (unsigned char)(bench_rand(&rng) % 100);
+    }
+    return 0;
+}
+
+static void free_workload(Workload *w)
+{
+    free(w->keys);
+    free(w->misses);
+    free(w->value);
+    free(w->stream);
+    free(w->is_write);
+}
+
+static uint64_t time_lookups(const HashMap *map, const unsigned char *keys, size_t key_size,
+                             const uint32_t *stream, size_t ops, size_t *found)
+{
+    size_t hits = 0;
+    uint64_t t0 = bench_now_ns();
+    for (size_t i = 0; i < ops; i++)
+    {
+        void *out = NULL;
+        size_t out_size = 0;
+        if (hashmap_get(map, keys + (size_t)stream[i] * key_size, key_size, &out, &out_size) == 1)
+        {
+            hits++;
+            free(out);
+        }
+    }
+    uint64_t ns = bench_now_ns() - t0;
+    *found = hits;
+    return ns;
+}
+
+/**
+ * Mixed phase: `write_percent` of operations update, the rest look up.
+ */
+static uint64_t time_mix(HashMap *map, const Config *c, const Workload *w, size_t ops,
+                         unsigned write_percent)
+{
+    uint64_t t0 = bench_now_ns();
+    for (size_t i = 0; i < ops; i++)
+    {
+        const unsigned char *key = w->keys + (size_t)w->stream[i] * c->key_size;
+        if (w->is_write[i] < write_percent)
+        {
+            hashmap_insert(map, key, c->key_size, w->value, c->val_size);
+        }
+        else
+        {
+            void *out = NULL;
+            size_t out_size = 0;
+            if (hashmap_get(map, key, c->key_size, &out, &out_size) == 1)
+                free(out);
+        }
+    }
+    return bench_now_ns() - t0;
+}
+
+static int run_config(const Config *c, const Options *o)
+{
+    Workload w;
+    memset(&w, 0, sizeof(w));
+    if (make_workload(c, o, &w) != 0)
+    {
+        fprintf(stderr, "out of memory for %zu entries of %zu+%zu bytes\n",
+                c->entries, c->key_size, c->val_size);
+        free_workload(&w);
+        return -1;
+    }
+
+    HashMap map;
+    if (hashmap_init(&map, 0, NULL, NULL, 0.0f) != 0)
+    {
+        free_workload(&w);
+        return -1;
+    }
+
+    uint64_t t0 = bench_now_ns();
+    for (size_t i = 0; i < c->entries; i++)
+        hashmap_insert(&map, w.keys + i * c->key_size, c->key_size, w.value, c->val_size);
+    report(c, "insert", c->entries, bench_now_ns() - t0);
+
+    size_t found = 0;
+    report(c, "get-hit", o->ops, time_lookups(&map, w.keys, c->key_size, w.stream, o->ops, &found));
+    if (found != o->ops)
+        fprintf(stderr, "warning: %zu of %zu hit lookups missed\n", o->ops - found, o->ops);
+    report(c, "get-miss", o->ops, time_lookups(&map, w.misses, c->key_size, w.stream, o->ops, &found));
+
+    t0 = bench_now_ns();
+    for (size_t i = 0; i < o->ops; i++)
+        hashmap_insert(&map, w.keys + (size_t)w.stream[i] * c->key_size, c->key_size,
+                       w.value, c->val_size);
+    report(c, "update", o->ops, bench_now_ns() - t0);
+
+    report(c, "mix-90r/10w", o->ops, time_mix(&map, c, &w, o->ops, 10));
+    report(c, "mix-50r/50w", o->ops, time_mix(&map, c, &w, o->ops, 50));
+
+    volatile size_t checksum = 0;
+    t0 = bench_now_ns();
+    for (size_t b = 0; b < map.capacity; b++)
+        for (const HashMapEntry *e = map.buckets[b]; e; e = e->next)
+            checksum += *(const unsigned char *)hashmap_entry_value(e) + e->key_size;
+    report(c, "iterate", map.size, bench_now_ns() - t0);
+
+    // Remove half the keys, then destroy the map with the other half
+    size_t removing = c->entries / 2;
+    t0 = bench_now_ns();
+    for (size_t i = 0; i < removing; i++)
+        hashmap_remove(&map, w.keys + i * c->key_size, c->key_size);
+    report(c, "remove", removing, bench_now_ns() - t0);
+
+    size_t remaining = map.size;
+    t0 = bench_now_ns();
+    hashmap_destroy(&map);
+    report(c, "destroy", remaining, bench_now_ns() - t0);
+
+    free_workload(&w);
+    return 0;
+}
+
+/**
+ * Run every table size for one distribution / key size / value size.
+ */
+static int run_sizes(Distribution dist, size_t key_size, size_t val_size, const Options *o)
+{
+    static const char *const tiers[] = {"L1", "L2", "L3", "10L3"};
+    size_t footprint[4] = {bench_cache_bytes(1) / 2, bench_cache_bytes(2) / 2,
+                           bench_cache_bytes(3) / 2, bench_cache_bytes(3) * 10};
+    size_t tier_count = o->quick ? 3 : 4;
+    size_t per_entry = estimate_entry_bytes(key_size, val_size);
+
+    for (size_t t = 0; t < tier_count; t++)
+    {
+        size_t bytes = footprint[t];
+        if (bytes > o->max_mb * 1024 * 1024)
+            bytes = o->max_mb * 1024 * 1024;
+        Config c = {dist, key_size, val_size, bytes / per_entry, tiers[t]};
+        if (c.entries < 64)
+            c.entries = 64;
+        if (run_config(&c, o) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int parse_options(int argc, char **argv, Options *o)
+{
+    o->ops = 2000000;
+    o->max_mb = 1024;
+    o->quick = 0;
+    o->only = -1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+        {
+            o->quick = 1;
+            o->ops = 200000;
+        }
+        else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+            o->ops = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--max-mb") == 0 && i + 1 < argc)
+            o->max_mb = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc)
+        {
+            i++;
+            o->only = strcmp(argv[i], "zipf") == 0 ? DIST_ZIPF : DIST_UNIFORM;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--quick] [--ops N] [--max-mb N] [--only uniform|zipf]\n",
+                    argv[0]);
+            return -1;
+        }
+    }
+    return o->ops && o->max_mb ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    Options o;
+    if (parse_options(argc, argv, &o) != 0)
+        return 2;
+
+    static const size_t key_sizes[] = {4, 8, 16, 64, 256};
+    static const size_t quick_key_sizes[] = {8, 64};
+    static const size_t val_sizes[] = {64, 256};
+    const size_t *keys = o.quick ? quick_key_sizes : key_sizes;
+    size_t key_count = o.quick ? 2 : 5;
+
+    printf("# caches: L1d %zu KiB, L2 %zu KiB, L3 %zu KiB; %zu ops per phase\n",
+           bench_cache_bytes(1) / 1024, bench_cache_bytes(2) / 1024,
+           bench_cache_bytes(3) / 1024, o.ops);
+    printf("%-8s %4s %4s %10s %-4s %-12s %9s %9s %9s\n",
+           "dist", "key", "val", "entries", "tier", "op", "ns/op", "Mops/s", "RSS MB");
+
+    for (int d = DIST_UNIFORM; d <= DIST_ZIPF; d++)
+    {
+        if (o.only >= 0 && o.only != d)
+            continue;
+        // Key sizes with 8-byte values, then value sizes with 8-byte keys
+        for (size_t k = 0; k < key_count; k++)
+            if (run_sizes((Distribution)d, keys[k], 8, &o) != 0)
+                return 1;
+        for (size_t v = 0; v < (o.quick ? 1u : 2u); v++)
+            if (run_sizes((Distribution)d, 8, val_sizes[v], &o) != 0)
+                return 1;
+    }
+    printf("# peak RSS %.1f MB\n", (double)bench_peak_rss_bytes() / (1024.0 * 1024.0));
+    return 0;
+}
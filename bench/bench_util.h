@@ -0,0 +1,195 @@
+#ifndef CHASHMAP_BENCH_UTIL_H
+#define CHASHMAP_BENCH_UTIL_H
+
+#include <malloc.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Helpers shared by the benchmark drivers in bench/: timing, a fast RNG,
+ * key generation, YCSB-style Zipfian key choice, heap and RSS readings.
+ */
+
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * SplitMix64 finaliser: a bijective 64-bit mix.
+ */
+static inline uint64_t bench_mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static inline uint64_t bench_rand(uint64_t *state)
+{
+    *state += 0x9e3779b97f4a7c15ull;
+    uint64_t x = *state;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Uniform double in [0, 1).
+ */
+static inline double bench_rand_unit(uint64_t *state)
+{
+    return (double)(bench_rand(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Write key number `index` into `buf` (`size` bytes). Distinct indices give
+ * distinct keys as long as the index fits in `size` bytes; the rest of the
+ * key is filled from a hash of the index.
+ */
+static inline void bench_make_key(unsigned char *buf, size_t size, uint64_t index)
+{
+    size_t head = size < sizeof(index) ? size : sizeof(index);
+    memcpy(buf, &index, head);
+    uint64_t fill = bench_mix64(index);
+    for (size_t i = head; i < size; i++)
+    {
+        if ((i - head) % 8 == 0)
+            fill = bench_mix64(fill);
+        buf[i] = (unsigned char)(fill >> (8 * ((i - head) % 8)));
+    }
+}
+
+/**
+ * Zipfian ranks over [0, n), as in YCSB (Gray et al., "Quickly generating
+ * billion-record synthetic databases"). Rank 0 is the most popular.
+ */
+typedef struct
+{
+    uint64_t n;
+    double theta;
+    double alpha;
+    double zetan;
+    double eta;
+    double half_pow_theta;
+} BenchZipf;
+
+static inline double bench_zeta(uint64_t n, double theta)
+{
+    double sum = 0.0;
+    for (uint64_t i = 1; i <= n; i++)
+        sum += 1.0 / pow((double)i, theta);
+    return sum;
+}
+
+static inline void bench_zipf_init(BenchZipf *z, uint64_t n, double theta)
+{
+    double zeta2 = bench_zeta(2, theta);
+    z->n = n;
+    z->theta = theta;
+    z->alpha = 1.0 / (1.0 - theta);
+    z->zetan = bench_zeta(n, theta);
+    z->eta = (1.0 - pow(2.0 / (double)n, 1.0 - theta)) / (1.0 - zeta2 / z->zetan);
+    z->half_pow_theta = 1.0 + pow(0.5, theta);
+}
+
+static inline uint64_t bench_zipf_next(const BenchZipf *z, uint64_t *state)
+{
+    double u = bench_rand_unit(state);
+    double uz = u * z->zetan;
+    if (uz < 1.0)
+        return 0;
+    if (uz < z->half_pow_theta)
+        return 1;
+    uint64_t rank = (uint64_t)((double)z->n * pow(z->eta * u - z->eta + 1.0, z->alpha));
+    return rank < z->n ? rank : z->n - 1;
+}
+
+/**
+ * Zipfian choice scattered over [0, n) so that popular keys are not neighbours.
+ */
+static inline uint64_t bench_zipf_scrambled(const BenchZipf *z, uint64_t *state)
+{
+    return bench_mix64(bench_zipf_next(z, state)) % z->n;
+}
+
+/**
+ * Histogram slot for a latency, in the layout of HashMapOpCounters.latency
+ * (see chashmap_instrument.h), so hashmap_counters_percentile() can read it.
+ */
+static inline size_t bench_latency_slot(uint64_t ns)
+{
+    if (ns < 16)
+        return (size_t)ns;
+    unsigned e = 63 - (unsigned)__builtin_clzll(ns);
+    return 16 + (size_t)(e - 4) * 8 + (size_t)((ns >> (e - 3)) & 7);
+}
+
+/**
+ * Current resident set size in bytes (0 if unavailable).
+ */
+static inline size_t bench_rss_bytes(void)
+{
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return 0;
+    unsigned long pages = 0, resident = 0;
+    int ok = fscanf(f, "%lu %lu", &pages, &resident) == 2;
+    fclose(f);
+    return ok ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+}
+
+/**
+ * Peak resident set size of the process in bytes.
+ */
+static inline size_t bench_peak_rss_bytes(void)
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return 0;
+    return (size_t)ru.ru_maxrss * 1024;
+}
+
+/**
+ * Bytes currently allocated from the heap, including allocator headers
+ * (glibc mallinfo2). Falls back to the RSS elsewhere.
+ */
+static inline size_t bench_heap_bytes(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return bench_rss_bytes();
+#endif
+}
+
+/**
+ * Data cache size in bytes for level 1, 2 or 3, with a typical value when
+ * the system does not report it.
+ */
+static inline size_t bench_cache_bytes(int level)
+{
+    long size = -1;
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    if (level == 1)
+        size = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    else if (level == 2)
+        size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    else
+        size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+    if (size > 0)
+        return (size_t)size;
+    return level == 1 ? 32 * 1024 : level == 2 ? 1024 * 1024 : 32 * 1024 * 1024;
+}
+
+#endif // CHASHMAP_BENCH_UTIL_H
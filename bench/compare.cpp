@@ -0,0 +1,354 @@
+/*
+ * Runs one workload against several hash tables and prints a comparison:
+ *
+ *   HashMap            the generic byte-keyed C map (hashmap_get copies the value)
+ *   HashMapU64         the integer-key C map (hashmap_u64_find, no copy)
+ *   CHASHMAP_DEFINE    the header-only typed C map
+ *   chashmap::flat_map the C++ wrapper
+ *   std::unordered_map the standard library's node-based table
+ *   open addressing    a bundled linear-probing table (flat arrays, no
+ *                      per-entry allocation), standing in for flat tables
+ *                      such as absl::flat_hash_map
+ *
+ * Keys and values are uint64_t. For each table size: insert n random keys,
+ * look up present and absent keys, then erase them all. Memory per entry is
+ * the heap growth during the inserts, divided by n.
+ *
+ * Usage: chashmap_compare [--sizes 1000,100000,...] [--lookups N]
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chashmap.h"
+#include "chashmap.hpp"
+#include "chashmap_int.h"
+#include "chashmap_typed.h"
+#include "bench_util.h"
+
+CHASHMAP_DEFINE(TypedU64, uint64_t, uint64_t, chashmap_hash_u64, CHASHMAP_EQ_INT)
+
+// Keeps lookup results live so the compiler cannot drop the loops
+volatile uint64_t compare_sink;
+
+namespace
+{
+    /**
+     * Linear probing over power-of-two arrays, at most 7/8 full, with
+     * backward-shift deletion (no tombstones).
+     */
+    class OpenTable
+    {
+    public:
+        OpenTable() { rehash(16); }
+        OpenTable(const OpenTable &) = delete;
+        OpenTable &operator=(const OpenTable &) = delete;
+
+        void insert(uint64_t key, uint64_t value)
+        {
+            if ((size_ + 1) * 8 > keys_.size() * 7)
+                rehash(keys_.size() * 2);
+            size_t i = slot(key);
+            while (used_[i] && keys_[i] != key)
+                i = (i + 1) & mask_;
+            if (!used_[i])
+            {
+                used_[i] = 1;
+                keys_[i] = key;
+                size_++;
+            }
+            values_[i] = value;
+        }
+
+        const uint64_t *find(uint64_t key) const
+        {
+            for (size_t i = slot(key); used_[i]; i = (i + 1) & mask_)
+                if (keys_[i] == key)
+                    return &values_[i];
+            return nullptr;
+        }
+
+        bool erase(uint64_t key)
+        {
+            size_t i = slot(key);
+            while (used_[i] && keys_[i] != key)
+                i = (i + 1) & mask_;
+            if (!used_[i])
+                return false;
+            // Shift later members of the run back over the hole
+            for (size_t j = (i + 1) & mask_; used_[j]; j = (j + 1) & mask_)
+            {
+                size_t home = slot(keys_[j]);
+                if (((j - home) & mask_) >= ((j - i) & mask_))
+                {
+                    keys_[i] = keys_[j];
+                    values_[i] = values_[j];
+                    i = j;
+                }
+            }
+            used_[i] = 0;
+            size_--;
+            return true;
+        }
+
+    private:
+        size_t slot(uint64_t key) const { return (size_t)(chashmap_hash_u64(key) & mask_); }
+
+        void rehash(size_t capacity)
+        {
+            std::vector<uint64_t> keys(capacity), values(capacity);
+            std::vector<unsigned char> used(capacity);
+            keys.swap(keys_);
+            values.swap(values_);
+            used.swap(used_);
+            mask_ = capacity - 1;
+            size_ = 0;
+            for (size_t i = 0; i < used.size(); i++)
+                if (used[i])
+                    insert(keys[i], values[i]);
+        }
+
+        std::vector<uint64_t> keys_, values_;
+        std::vector<unsigned char> used_;
+        size_t mask_ = 0;
+        size_t size_ = 0;
+    };
+
+    /**
+     * Uniform adapter: each table is wrapped in a struct with insert, find
+     * (returns whether found and the value) and erase.
+     */
+    struct CMap
+    {
+        static constexpr const char *name = "HashMap";
+        HashMap map;
+        CMap() { hashmap_init(&map, 0, nullptr, nullptr, 0.0f); }
+        ~CMap() { hashmap_destroy(&map); }
+        void insert(uint64_t k, uint64_t v) { hashmap_insert(&map, &k, sizeof(k), &v, sizeof(v)); }
+        bool find(uint64_t k, uint64_t *v) const
+        {
+            void *out = nullptr;
+            size_t size = 0;
+            if (hashmap_get(&map, &k, sizeof(k), &out, &size) != 1)
+                return false;
+            memcpy(v, out, sizeof(*v));
+            free(out);
+            return true;
+        }
+        bool erase(uint64_t k) { return hashmap_remove(&map, &k, sizeof(k)) == 1; }
+    };
+
+    struct U64Map
+    {
+        static constexpr const char *name = "HashMapU64";
+        HashMapU64 map;
+        U64Map() { hashmap_u64_init(&map, 0, 0.0f); }
+        ~U64Map() { hashmap_u64_destroy(&map); }
+        void insert(uint64_t k, uint64_t v) { hashmap_u64_insert(&map, k, &v, sizeof(v)); }
+        bool find(uint64_t k, uint64_t *v) const
+        {
+            const void *p = hashmap_u64_find(&map, k, nullptr);
+            if (p)
+                memcpy(v, p, sizeof(*v));
+            return p != nullptr;
+        }
+        bool erase(uint64_t k) { return hashmap_u64_remove(&map, k) == 1; }
+    };
+
+    struct TypedMap
+    {
+        static constexpr const char *name = "CHASHMAP_DEFINE";
+        TypedU64 map;
+        TypedMap() { TypedU64_init(&map, 0, 0.0f); }
+        ~TypedMap() { TypedU64_destroy(&map); }
+        void insert(uint64_t k, uint64_t v) { TypedU64_insert(&map, k, v); }
+        bool find(uint64_t k, uint64_t *v) const
+        {
+            const uint64_t *p = TypedU64_get(&map, k);
+            if (p)
+                *v = *p;
+            return p != nullptr;
+        }
+        bool erase(uint64_t k) { return TypedU64_remove(&map, k) == 1; }
+    };
+
+    struct FlatMap
+    {
+        static constexpr const char *name = "chashmap::flat_map";
+        chashmap::flat_map<uint64_t, uint64_t> map;
+        void insert(uint64_t k, uint64_t v) { map.insert_or_assign(k, v); }
+        bool find(uint64_t k, uint64_t *v) const
+        {
+            const auto *kv = map.find(k);
+            if (kv)
+                *v = kv->second;
+            return kv != nullptr;
+        }
+        bool erase(uint64_t k) { return map.erase(k) == 1; }
+    };
+
+    struct StdMap
+    {
+        static constexpr const char *name = "std::unordered_map";
+        std::unordered_map<uint64_t, uint64_t> map;
+        void insert(uint64_t k, uint64_t v) { map[k] = v; }
+        bool find(uint64_t k, uint64_t *v) const
+        {
+            auto it = map.find(k);
+            if (it == map.end())
+                return false;
+            *v = it->second;
+            return true;
+        }
+        bool erase(uint64_t k) { return map.erase(k) == 1; }
+    };
+
+    struct OpenMap
+    {
+        static constexpr const char *name = "open addressing";
+        OpenTable map;
+        void insert(uint64_t k, uint64_t v) { map.insert(k, v); }
+        bool find(uint64_t k, uint64_t *v) const
+        {
+            const uint64_t *p = map.find(k);
+            if (p)
+                *v = *p;
+            return p != nullptr;
+        }
+        bool erase(uint64_t k) { return map.erase(k); }
+    };
+
+    struct Workload
+    {
+        std::vector<uint64_t> keys;   // Inserted, in insertion order
+        std::vector<uint64_t> misses; // Never inserted
+        std::vector<uint32_t> order;  // Lookup sequence (indices into keys / misses)
+    };
+
+    struct Result
+    {
+        double insert_ns, hit_ns, miss_ns, erase_ns, bytes_per_entry;
+    };
+
+    template <class Map>
+    Result run(const Workload &w)
+    {
+        Result r;
+        size_t n = w.keys.size();
+        size_t heap_before = bench_heap_bytes();
+        Map *map = new Map();
+
+        uint64_t t0 = bench_now_ns();
+        for (size_t i = 0; i < n; i++)
+            map->insert(w.keys[i], w.keys[i] ^ 1);
+        r.insert_ns = (double)(bench_now_ns() - t0) / (double)n;
+        r.bytes_per_entry = (double)(bench_heap_bytes() - heap_before) / (double)n;
+
+        uint64_t sum = 0, value = 0;
+        size_t found = 0;
+        t0 = bench_now_ns();
+        for (uint32_t i : w.order)
+        {
+            if (map->find(w.keys[i], &value))
+            {
+                found++;
+                sum += value;
+            }
+        }
+        r.hit_ns = (double)(bench_now_ns() - t0) / (double)w.order.size();
+
+        t0 = bench_now_ns();
+        for (uint32_t i : w.order)
+            found += map->find(w.misses[i], &value);
+        r.miss_ns = (double)(bench_now_ns() - t0) / (double)w.order.size();
+        if (found != w.order.size())
+            fprintf(stderr, "%s: %zu of %zu lookups wrong\n", Map::name,
+                    found > w.order.size() ? found - w.order.size() : w.order.size() - found,
+                    w.order.size());
+
+        size_t erased = 0;
+        t0 = bench_now_ns();
+        for (size_t i = 0; i < n; i++)
+            erased += map->erase(w.keys[i]);
+        r.erase_ns = (double)(bench_now_ns() - t0) / (double)n;
+        if (erased != n)
+            fprintf(stderr, "%s: erased %zu of %zu keys\n", Map::name, erased, n);
+
+        delete map;
+        compare_sink = sum;
+        return r;
+    }
+
+    template <class Map>
+    void report(const Workload &w)
+    {
+        Result r = run<Map>(w);
+        printf("%10zu  %-20s %9.1f %9.1f %9.1f %9.1f %9.1f %12.1f\n", w.keys.size(), Map::name,
+               r.insert_ns, r.hit_ns, r.miss_ns, r.erase_ns, 1e3 / r.hit_ns, r.bytes_per_entry);
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<size_t> sizes = {1000, 100000, 1000000, 10000000};
+    size_t lookups = 2000000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+        {
+            sizes.clear();
+            for (const char *p = argv[++i]; *p;)
+            {
+                char *end = nullptr;
+                size_t n = strtoull(p, &end, 10);
+                if (end == p || n == 0 || n > UINT32_MAX)
+                    break;
+                sizes.push_back(n);
+                p = *end == ',' ? end + 1 : end;
+            }
+        }
+        else if (strcmp(argv[i], "--lookups") == 0 && i + 1 < argc)
+            lookups = strtoull(argv[++i], nullptr, 10);
+        else
+        {
+            fprintf(stderr, "usage: %s [--sizes 1000,100000,...] [--lookups N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (sizes.empty() || lookups == 0)
+        return 2;
+
+    printf("# uint64_t keys and values; times in ns/op; %zu lookups per size\n", lookups);
+    printf("%10s  %-20s %9s %9s %9s %9s %9s %12s\n", "entries", "table", "insert", "get-hit",
+           "get-miss", "erase", "hit Mop/s", "bytes/entry");
+    for (size_t n : sizes)
+    {
+        Workload w;
+        w.keys.resize(n);
+        w.misses.resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            w.keys[i] = bench_mix64(i);
+            w.misses[i] = bench_mix64(i + n);
+        }
+        uint64_t rng = 7;
+        w.order.resize(lookups);
+        for (uint32_t &i : w.order)
+            i = (uint32_t)(bench_rand(&rng) % n);
+
+        report<CMap>(w);
+        report<U64Map>(w);
+        report<TypedMap>(w);
+        report<FlatMap>(w);
+        report<StdMap>(w);
+        report<OpenMap>(w);
+    }
+    return 0;
+}
@@ -0,0 +1,597 @@
+#define _GNU_SOURCE
+#include <malloc.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../include/chashcache.h"
+#include "../include/chashfrozen.h"
+#include "../include/chashmap.h"
+#include "../include/chashmap_int.h"
+#include "../include/chashmap_typed.h"
+#include "../include/chashset.h"
+#include "../include/chashttl.h"
+#include "bench_util.h"
+
+/*
+ * Memory cost per entry of each map type.
+ *
+ * This driver is linked with -Wl,--wrap for malloc, calloc, realloc,
+ * aligned_alloc and free (see the Makefile), so every allocation made by the
+ * library goes through the counting wrappers below. They record the size
+ * asked for, the usable size glibc handed out (malloc_usable_size) and the
+ * chunk that costs, which includes the allocator's size header.
+ *
+ * Each (map type, key size, value size, entry count) runs in a child process
+ * so that heaps do not mix. The child builds the map and reports:
+ *   bytes/entry   live chunk bytes / entries (what the map really costs)
+ *   asked/entry   bytes requested from malloc / entries
+ *   payload       key + value bytes
+ *   alloc-ovh     (chunk - requested) / entries: headers and rounding
+ *   allocs/entry  live allocations / entries
+ * Mutable maps then go through --churn rounds, each removing half of the
+ * keys at random and inserting as many new ones, and report:
+ *   held/entry    heap the process holds (arena + mmapped) / entries
+ *   frag          free bytes inside the arena / arena bytes
+ *
+ * Usage: chashmap_memreport [--sizes 1000,100000,...] [--churn N]
+ */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_aligned_alloc(size_t alignment, size_t size);
+void __real_free(void *ptr);
+
+typedef struct
+{
+    size_t live_allocs;
+    size_t live_requested;
+    size_t live_chunk;
+    size_t total_allocs;
+} AllocStats;
+
+/**
+ * Requested size of every live allocation, keyed by address (open
+ * addressing, grown with the real allocator).
+ */
+typedef struct
+{
+    uintptr_t ptr;
+    size_t size;
+} Tracked;
+
+static pthread_mutex_t track_lock = PTHREAD_MUTEX_INITIALIZER;
+static Tracked *tracked = NULL;
+static size_t tracked_capacity = 0;
+static AllocStats stats;
+
+static size_t track_slot(uintptr_t ptr)
+{
+    return (size_t)(bench_mix64(ptr) & (tracked_capacity - 1));
+}
+
+static void track_grow(void)
+{
+    size_t old_capacity = tracked_capacity;
+    Tracked *old = tracked;
+    tracked_capacity = old_capacity ? old_capacity * 2 : 1 << 16;
+    tracked = (Tracked *)__real_calloc(tracked_capacity, sizeof(Tracked));
+    if (!tracked)
+        abort();
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (!old[i].ptr)
+            continue;
+        size_t s = track_slot(old[i].ptr);
+        while (tracked[s].ptr)
+            s = (s + 1) & (tracked_capacity - 1);
+        tracked[s] = old[i];
+    }
+    __real_free(old);
+}
+
+/**
+ * glibc chunk cost of an allocation: the usable bytes plus one size word.
+ */
+static size_t chunk_bytes(void *ptr)
+{
+    return malloc_usable_size(ptr) + sizeof(size_t);
+}
+
+static void track_add(void *ptr, size_t size)
+{
+    if (!ptr)
+        return;
+    pthread_mutex_lock(&track_lock);
+    if ((stats.live_allocs + 1) * 2 > tracked_capacity)
+        track_grow();
+    size_t s = track_slot((uintptr_t)ptr);
+    while (tracked[s].ptr)
+        s = (s + 1) & (tracked_capacity - 1);
+    tracked[s].ptr = (uintptr_t)ptr;
+    tracked[s].size = size;
+    stats.live_allocs++;
+    stats.total_allocs++;
+    stats.live_requested += size;
+    stats.live_chunk += chunk_bytes(ptr);
+    pthread_mutex_unlock(&track_lock);
+}
+
+static void track_remove(void *ptr)
+{
+    if (!ptr)
+        return;
+    pthread_mutex_lock(&track_lock);
+    size_t s = tracked_capacity ? track_slot((uintptr_t)ptr) : 0;
+    while (tracked_capacity && tracked[s].ptr && tracked[s].ptr != (uintptr_t)ptr)
+        s = (s + 1) & (tracked_capacity - 1);
+    if (tracked_capacity && tracked[s].ptr == (uintptr_t)ptr)
+    {
+        stats.live_allocs--;
+        stats.live_requested -= tracked[s].size;
+        stats.live_chunk -= chunk_bytes(ptr);
+        // Backward-shift deletion keeps probe runs intact
+        size_t hole = s;
+        for (size_t j = (s + 1) & (tracked_capacity - 1); tracked[j].ptr;
+             j = (j + 1) & (tracked_capacity - 1))
+        {
+            size_t home = track_slot(tracked[j].ptr);
+            if (((j - home) & (tracked_capacity - 1)) >= ((j - hole) & (tracked_capacity - 1)))
+            {
+                tracked[hole] = tracked[j];
+                hole = j;
+            }
+        }
+        tracked[hole].ptr = 0;
+    }
+    pthread_mutex_unlock(&track_lock);
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *p = __real_malloc(size);
+    track_add(p, size);
+    return p;
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    void *p = __real_calloc(count, size);
+    track_add(p, count * size);
+    return p;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    track_remove(ptr);
+    void *p = __real_realloc(ptr, size);
+    if (p)
+        track_add(p, size);
+    else if (ptr && size)
+        track_add(ptr, malloc_usable_size(ptr)); // Failed: the old block is still live
+    return p;
+}
+
+void *__wrap_aligned_alloc(size_t alignment, size_t size)
+{
+    void *p = __real_aligned_alloc(alignment, size);
+    track_add(p, size);
+    return p;
+}
+
+void __wrap_free(void *ptr)
+{
+    track_remove(ptr);
+    __real_free(ptr);
+}
+
+static AllocStats read_stats(void)
+{
+    pthread_mutex_lock(&track_lock);
+    AllocStats s = stats;
+    pthread_mutex_unlock(&track_lock);
+    return s;
+}
+
+CHASHMAP_DEFINE(TypedU64, uint64_t, uint64_t, chashmap_hash_u64, CHASHMAP_EQ_INT)
+
+typedef struct
+{
+    size_t key_size;
+    size_t val_size;
+    size_t entries;
+    unsigned char *value;
+} Layout;
+
+/**
+ * One map type: create it holding keys [0, entries), then (optionally)
+ * remove and insert single keys for churn. `map` is an opaque buffer.
+ */
+typedef struct
+{
+    const char *name;
+    int u64_keys;   // Keys are uint64_t (key size 8 only)
+    int u64_values; // Values are uint64_t (value size 8 only)
+    int keys_only;  // No values stored
+    int (*build)(void *map, const Layout *l);
+    int (*insert)(void *map, const Layout *l, uint64_t key);
+    int (*remove)(void *map, const Layout *l, uint64_t key);
+    void (*destroy)(void *map);
+} MapType;
+
+static unsigned char key_buf[1024];
+
+static const unsigned char *key_bytes(const Layout *l, uint64_t key)
+{
+    bench_make_key(key_buf, l->key_size, key);
+    return key_buf;
+}
+
+static int map_insert(void *map, const Layout *l, uint64_t key)
+{
+    return hashmap_insert((HashMap *)map, key_bytes(l, key), l->key_size, l->value, l->val_size);
+}
+
+static int map_remove(void *map, const Layout *l, uint64_t key)
+{
+    return hashmap_remove((HashMap *)map, key_bytes(l, key), l->key_size) == 1 ? 0 : -1;
+}
+
+static int map_build(void *map, const Layout *l)
+{
+    if (hashmap_init((HashMap *)map, 0, NULL, NULL, 0.0f) != 0)
+        return -1;
+    for (size_t i = 0; i < l->entries; i++)
+        if (map_insert(map, l, i) != 0)
+            return -1;
+    return 0;
+}
+
+static int filtered_build(void *map, const Layout *l)
+{
+    if (hashmap_init((HashMap *)map, 0, NULL, NULL, 0.0f) != 0 ||
+        hashmap_enable_filter((HashMap *)map, 0) != 0)
+        return -1;
+    for (size_t i = 0; i < l->entries; i++)
+        if (map_insert(map, l, i) != 0)
+            return -1;
+    return 0;
+}
+
+/**
+ * Build, save and reload, so entries come from hashmap_load()'s slabs. The
+ * source map is freed before the counters are read.
+ */
+static int loaded_build(void *map, const Layout *l)
+{
+    HashMap source;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/chashmap_memreport.%ld", (long)getpid());
+    int status = map_build(&source, l) == 0 && hashmap_save(&source, path) == 0 ? 0 : -1;
+    hashmap_destroy(&source);
+    if (status == 0)
+        status = hashmap_load((HashMap *)map, path, NULL, NULL);
+    unlink(path);
+    return status;
+}
+
+static void map_destroy(void *map)
+{
+    hashmap_destroy((HashMap *)map);
+}
+
+static int u64_insert(void *map, const Layout *l, uint64_t key)
+{
+    return hashmap_u64_insert((HashMapU64 *)map, bench_mix64(key), l->value, l->val_size);
+}
+
+static int u64_remove(void *map, const Layout *l, uint64_t key)
+{
+    (void)l;
+    return hashmap_u64_remove((HashMapU64 *)map, bench_mix64(key)) == 1 ? 0 : -1;
+}
+
+static int u64_build(void *map, const Layout *l)
+{
+    if (hashmap_u64_init((HashMapU64 *)map, 0, 0.0f) != 0)
+        return -1;
+    for (size_t i = 0; i < l->entries; i++)
+        if (u64_insert(map, l, i) != 0)
+            return -1;
+    return 0;
+}
+
+static void u64_destroy(void *map)
+{
+    hashmap_u64_destroy((HashMapU64 *)map);
+}
+
+static int typed_insert(void *map, const Layout *l, uint64_t key)
+{
+    (void)l;
+    return TypedU64_insert((TypedU64 *)map, bench_mix64(key), key);
+}
+
+static int typed_remove(void *map, const Layout *l, uint64_t key)
+{
+    (void)l;
+    return TypedU64_remove((TypedU64 *)map, bench_mix64(key)) == 1 ? 0 : -1;
+}
+
+static int typed_build(void *map, const Layout *l)
+{
+    if (TypedU64_init((TypedU64 *)map, 0, 0.0f) != 0)
+        return -1;
+    for (size_t i = 0; i < l->entries; i++)
+        if (typed_insert(map, l, i) != 0)
+            return -1;
+    return 0;
+}
+
+static void typed_destroy(void *map)
+{
+    TypedU64_destroy((TypedU64 *)map);
+}
+
+static int set_insert(void *map, const Layout *l, uint64_t key)
+{
+    return hashset_insert((HashSet *)map, key_bytes(l, key), l->key_size) < 0 ? -1 : 0;
+}
+
+static int set_remove(void *map, const Layout *l, uint64_t key)
+{
+    return hashset_remove((HashSet *)map, key_bytes(l, key), l->key_size) == 1 ? 0 : -1;
+}
+
+static int set_build(void *map, const Layout *l)
+{
+    if (hashset_init((HashSet *)map, 0, NULL, NULL, 0.0f) != 0)
+        return -1;
+    for (size_t i = 0; i < l->entries; i++)
+        if (set_insert(map, l, i) != 0)
+            return -1;
+    return 0;
+}
+
+static void set_destroy(void *map)
+{
+    hashset_destroy((HashSet *)map);
+}
+
+static int cache_insert(void *map, const Layout *l, uint64_t key)
+{
+    return hashcache_insert((HashCache *)map, key_bytes(l, key), l->key_size, l->value, l->val_size);
+}
+
+static int cache_remove(void *map, const Layout *l, uint64_t key)
+{
+    return hashcache_remove((HashCache *)map, key_bytes(l, key), l->key_size) == 1 ? 0 : -1;
+}
+
+static int cache_build(void *map, const Layout *l)
+{
+    // Unbounded, so nothing is evicted and every key stays
+    if (hashcache_init((HashCache *)map, 0, 0, NULL, NULL) != 0)
+        return -1;
+    for (size_t i = 0; i < l->entries; i++)
+        if (cache_insert(map, l, i) != 0)
+            return -1;
+    return 0;
+}
+
+static void cache_destroy(void *map)
+{
+    hashcache_destroy((HashCache *)map);
+}
+
+static int ttl_insert(void *map, const Layout *l, uint64_t key)
+{
+    return hashttl_insert((HashTTLMap *)map, key_bytes(l, key), l->key_size, l->value, l->val_size,
+                          3600 * 1000);
+}
+
+static int ttl_remove(void *map, const Layout *l, uint64_t key)
+{
+    return hashttl_remove((HashTTLMap *)map, key_bytes(l, key), l->key_size) == 1 ? 0 : -1;
+}
+
+static int ttl_build(void *map, const Layout *l)
+{
+    if (hashttl_init((HashTTLMap *)map, 0, NULL, NULL, 0.0f, 0) != 0)
+        return -1;
+    for (size_t i = 0; i < l->entries; i++)
+        if (ttl_insert(map, l, i) != 0)
+            return -1;
+    return 0;
+}
+
+static void ttl_destroy(void *map)
+{
+    hashttl_destroy((HashTTLMap *)map);
+}
+
+static int frozen_build(void *map, const Layout *l)
+{
+    HashMap source;
+    int status = map_build(&source, l) == 0 ? hashmap_freeze(&source, (FrozenHashMap *)map, 0) : -1;
+    hashmap_destroy(&source);
+    return status;
+}
+
+static void frozen_destroy(void *map)
+{
+    hashmap_frozen_destroy((FrozenHashMap *)map);
+}
+
+static const MapType map_types[] = {
+    {"HashMap", 0, 0, 0, map_build, map_insert, map_remove, map_destroy},
+    {"HashMap+filter", 0, 0, 0, filtered_build, map_insert, map_remove, map_destroy},
+    {"HashMap (loaded)", 0, 0, 0, loaded_build, map_insert, map_remove, map_destroy},
+    {"HashMapU64", 1, 0, 0, u64_build, u64_insert, u64_remove, u64_destroy},
+    {"CHASHMAP_DEFINE", 1, 1, 0, typed_build, typed_insert, typed_remove, typed_destroy},
+    {"HashSet", 0, 0, 1, set_build, set_insert, set_remove, set_destroy},
+    {"HashCache", 0, 0, 0, cache_build, cache_insert, cache_remove, cache_destroy},
+    {"HashTTLMap", 0, 0, 0, ttl_build, ttl_insert, ttl_remove, ttl_destroy},
+    {"FrozenHashMap", 0, 0, 0, frozen_build, NULL, NULL, frozen_destroy},
+};
+
+typedef union
+{
+    HashMap map;
+    HashMapU64 u64;
+    TypedU64 typed;
+    HashSet set;
+    HashCache cache;
+    HashTTLMap ttl;
+    FrozenHashMap frozen;
+} AnyMap;
+
+/**
+ * Churn: rounds of removing a random half of the live keys and inserting
+ * as many fresh keys. Live keys are tracked in `live` (key numbers).
+ */
+static int churn(const MapType *t, void *map, const Layout *l, unsigned rounds)
+{
+    uint64_t *live = (uint64_t *)__real_malloc(l->entries * sizeof(uint64_t));
+    if (!live)
+        return -1;
+    for (size_t i = 0; i < l->entries; i++)
+        live[i] = i;
+    uint64_t next = l->entries, rng = 11;
+    for (unsigned r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < l->entries; i++)
+        {
+            if (bench_rand(&rng) & 1)
+                continue;
+            if (t->remove(map, l, live[i]) != 0 || t->insert(map, l, next) != 0)
+            {
+                __real_free(live);
+                return -1;
+            }
+            live[i] = next++;
+        }
+    }
+    __real_free(live);
+    return 0;
+}
+
+static int measure(const MapType *t, const Layout *l, unsigned rounds)
+{
+    size_t payload = t->keys_only ? l->key_size : l->key_size + l->val_size;
+    AnyMap map;
+    memset(&map, 0, sizeof(map));
+    AllocStats before = read_stats();
+    if (t->build(&map, l) != 0)
+    {
+        fprintf(stderr, "%s: build failed (%zu entries)\n", t->name, l->entries);
+        return -1;
+    }
+    AllocStats after = read_stats();
+    double n = (double)l->entries;
+    size_t chunk = after.live_chunk - before.live_chunk;
+    size_t requested = after.live_requested - before.live_requested;
+    printf("%-17s %4zu %4zu %9zu %9.1f %9.1f %7zu %9.1f %9.2f", t->name, l->key_size, l->val_size,
+           l->entries, (double)chunk / n, (double)requested / n, payload,
+           (double)(chunk - requested) / n, (double)(after.live_allocs - before.live_allocs) / n);
+
+    if (t->insert && rounds > 0)
+    {
+        if (churn(t, &map, l, rounds) != 0)
+        {
+            printf("\n");
+            fprintf(stderr, "%s: churn failed\n", t->name);
+            t->destroy(&map);
+            return -1;
+        }
+        struct mallinfo2 info = mallinfo2();
+        double held = (double)(info.arena + info.hblkhd);
+        printf(" %10.1f %6.1f%%", held / n, info.arena ? 100.0 * (double)info.fordblks / (double)info.arena : 0.0);
+    }
+    else
+    {
+        printf(" %10s %7s", "-", "-");
+    }
+    printf("\n");
+    t->destroy(&map);
+    return 0;
+}
+
+static int run_child(const MapType *t, const Layout *l, unsigned rounds)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+        return measure(t, l, rounds);
+    if (pid == 0)
+    {
+        int status = measure(t, l, rounds);
+        fflush(stdout);
+        _exit(status == 0 ? 0 : 1);
+    }
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return -1;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    size_t sizes[32] = {1000, 100000, 1000000};
+    size_t size_count = 3;
+    unsigned rounds = 4;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+        {
+            size_count = 0;
+            for (const char *p = argv[++i]; *p && size_count < 32;)
+            {
+                char *end = NULL;
+                unsigned long long n = strtoull(p, &end, 10);
+                if (end == p || n == 0)
+                    break;
+                sizes[size_count++] = (size_t)n;
+                p = *end == ',' ? end + 1 : end;
+            }
+        }
+        else if (strcmp(argv[i], "--churn") == 0 && i + 1 < argc)
+            rounds = (unsigned)strtoul(argv[++i], NULL, 10);
+        else
+        {
+            fprintf(stderr, "usage: %s [--sizes 1000,100000,...] [--churn N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (size_count == 0)
+        return 2;
+
+    static const size_t layouts[][2] = {{8, 8}, {16, 16}, {24, 24}, {8, 64}, {32, 256}};
+    unsigned char value[256];
+    memset(value, 0x5a, sizeof(value));
+
+    printf("# glibc chunk accounting; churn: %u rounds of replacing half the keys\n", rounds);
+    printf("%-17s %4s %4s %9s %9s %9s %7s %9s %9s %10s %7s\n", "map", "key", "val", "entries",
+           "bytes/ent", "asked/ent", "payload", "alloc-ovh", "allocs/ent", "held/ent", "frag");
+    int failed = 0;
+    for (size_t s = 0; s < size_count; s++)
+    {
+        for (size_t k = 0; k < sizeof(layouts) / sizeof(layouts[0]); k++)
+        {
+            Layout l = {layouts[k][0], layouts[k][1], sizes[s], value};
+            for (size_t m = 0; m < sizeof(map_types) / sizeof(map_types[0]); m++)
+            {
+                const MapType *t = &map_types[m];
+                if ((t->u64_keys && l.key_size != 8) || (t->u64_values && l.val_size != 8))
+                    continue;
+                if (run_child(t, &l, rounds) != 0)
+                    failed = 1;
+            }
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,277 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "../include/chashmap.h"
+#include "bench_util.h"
+
+/*
+ * Hardware counters per HashMap operation, read with perf_event_open(2).
+ *
+ * For each table size, the driver builds a map with 8-byte keys and values.
+ * It counts events over four phases: hashmap_insert of every key, hit and
+ * miss hashmap_get, and hashmap_remove of every key. Each count is divided
+ * by the number of operations in the phase. The events are cycles,
+ * instructions, L1D read misses, last-level-cache misses, dTLB read misses
+ * and branch mispredictions.
+ *
+ * Only user-space events of this process are counted, which works at the
+ * default perf_event_paranoid setting. Events the CPU or kernel does not
+ * offer (or any, inside many containers and VMs) are shown as "-". If the
+ * kernel multiplexes the counters, counts are scaled by enabled / running
+ * time.
+ *
+ * Usage: chashmap_perfcount [--sizes 1000,100000,...] [--lookups N]
+ */
+
+typedef struct
+{
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} EventSpec;
+
+#define CACHE_EVENT(cache, op, result) \
+    ((cache) | ((uint64_t)(op) << 8) | ((uint64_t)(result) << 16))
+
+static const EventSpec event_specs[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instr", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"L1D-miss", PERF_TYPE_HW_CACHE,
+     CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"LLC-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"dTLB-miss", PERF_TYPE_HW_CACHE,
+     CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+#define EVENT_COUNT (sizeof(event_specs) / sizeof(event_specs[0]))
+
+typedef struct
+{
+    int fd[EVENT_COUNT]; // -1 where the event could not be opened
+    int opened;
+} Counters;
+
+typedef struct
+{
+    double value[EVENT_COUNT]; // Per operation; < 0 if unavailable
+    double ns;
+} Reading;
+
+static int open_event(const EventSpec *spec)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec->type;
+    attr.config = spec->config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void counters_open(Counters *c)
+{
+    c->opened = 0;
+    for (size_t i = 0; i < EVENT_COUNT; i++)
+    {
+        c->fd[i] = open_event(&event_specs[i]);
+        if (c->fd[i] >= 0)
+            c->opened++;
+        else
+            fprintf(stderr, "# %s unavailable: %s\n", event_specs[i].name, strerror(errno));
+    }
+}
+
+static void counters_close(Counters *c)
+{
+    for (size_t i = 0; i < EVENT_COUNT; i++)
+        if (c->fd[i] >= 0)
+            close(c->fd[i]);
+}
+
+static void counters_start(const Counters *c)
+{
+    for (size_t i = 0; i < EVENT_COUNT; i++)
+    {
+        if (c->fd[i] >= 0)
+        {
+            ioctl(c->fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(c->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+static void counters_stop(const Counters *c, size_t ops, Reading *r)
+{
+    for (size_t i = 0; i < EVENT_COUNT; i++)
+        if (c->fd[i] >= 0)
+            ioctl(c->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+    for (size_t i = 0; i < EVENT_COUNT; i++)
+    {
+        uint64_t data[3]; // value, time enabled, time running
+        r->value[i] = -1.0;
+        if (c->fd[i] < 0 || read(c->fd[i], data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0)
+            continue;
+        double scaled = (double)data[0] * ((double)data[1] / (double)data[2]);
+        r->value[i] = scaled / (double)ops;
+    }
+}
+
+static void print_reading(size_t entries, const char *phase, const Reading *r)
+{
+    printf("%10zu %-9s %8.1f", entries, phase, r->ns);
+    for (size_t i = 0; i < EVENT_COUNT; i++)
+    {
+        if (r->value[i] < 0)
+            printf(" %9s", "-");
+        else
+            printf(" %9.2f", r->value[i]);
+    }
+    if (r->value[0] > 0 && r->value[1] >= 0)
+        printf(" %6.2f", r->value[1] / r->value[0]);
+    printf("\n");
+    fflush(stdout);
+}
+
+typedef enum
+{
+    PHASE_INSERT,
+    PHASE_GET_HIT,
+    PHASE_GET_MISS,
+    PHASE_REMOVE
+} Phase;
+
+static const char *const phase_names[] = {"insert", "get-hit", "get-miss", "remove"};
+
+/**
+ * Run one phase between counters_start() and counters_stop(); the work
+ * itself is only map calls and array reads.
+ */
+static void run_phase(const Counters *c, Phase phase, HashMap *map, const uint64_t *keys,
+                      const uint64_t *misses, const uint32_t *order, size_t n, size_t lookups,
+                      Reading *r)
+{
+    uint64_t value = 0;
+    size_t ops = (phase == PHASE_GET_HIT || phase == PHASE_GET_MISS) ? lookups : n;
+    const uint64_t *source = phase == PHASE_GET_MISS ? misses : keys;
+
+    uint64_t t0 = bench_now_ns();
+    counters_start(c);
+    switch (phase)
+    {
+    case PHASE_INSERT:
+        for (size_t i = 0; i < n; i++)
+            hashmap_insert(map, &keys[i], sizeof(uint64_t), &value, sizeof(value));
+        break;
+    case PHASE_GET_HIT:
+    case PHASE_GET_MISS:
+        for (size_t i = 0; i < lookups; i++)
+        {
+            void *out = NULL;
+            size_t out_size = 0;
+            if (hashmap_get(map, &source[order[i]], sizeof(uint64_t), &out, &out_size) == 1)
+                free(out);
+        }
+        break;
+    case PHASE_REMOVE:
+        for (size_t i = 0; i < n; i++)
+            hashmap_remove(map, &keys[i], sizeof(uint64_t));
+        break;
+    }
+    counters_stop(c, ops, r);
+    r->ns = (double)(bench_now_ns() - t0) / (double)ops;
+}
+
+static int run_size(const Counters *c, size_t n, size_t lookups)
+{
+    uint64_t *keys = (uint64_t *)malloc(n * sizeof(uint64_t));
+    uint64_t *misses = (uint64_t *)malloc(n * sizeof(uint64_t));
+    uint32_t *order = (uint32_t *)malloc(lookups * sizeof(uint32_t));
+    HashMap map;
+    if (!keys || !misses || !order || hashmap_init(&map, 0, NULL, NULL, 0.0f) != 0)
+    {
+        free(keys);
+        free(misses);
+        free(order);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        keys[i] = bench_mix64(i);
+        misses[i] = bench_mix64(i + n);
+    }
+    uint64_t rng = 3;
+    for (size_t i = 0; i < lookups; i++)
+        order[i] = (uint32_t)(bench_rand(&rng) % n);
+
+    for (Phase p = PHASE_INSERT; p <= PHASE_REMOVE; p++)
+    {
+        Reading r;
+        run_phase(c, p, &map, keys, misses, order, n, lookups, &r);
+        print_reading(n, phase_names[p], &r);
+    }
+
+    hashmap_destroy(&map);
+    free(keys);
+    free(misses);
+    free(order);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    size_t sizes[32] = {1000, 16000, 256000, 4000000};
+    size_t size_count = 4;
+    size_t lookups = 1000000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+        {
+            size_count = 0;
+            for (const char *p = argv[++i]; *p && size_count < 32;)
+            {
+                char *end = NULL;
+                unsigned long long n = strtoull(p, &end, 10);
+                if (end == p || n == 0 || n > UINT32_MAX)
+                    break;
+                sizes[size_count++] = (size_t)n;
+                p = *end == ',' ? end + 1 : end;
+            }
+        }
+        else if (strcmp(argv[i], "--lookups") == 0 && i + 1 < argc)
+            lookups = strtoull(argv[++i], NULL, 10);
+        else
+        {
+            fprintf(stderr, "usage: %s [--sizes 1000,100000,...] [--lookups N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (size_count == 0 || lookups == 0)
+        return 2;
+
+    Counters c;
+    counters_open(&c);
+    if (c.opened == 0)
+        printf("# no hardware counters available (perf_event_paranoid, container or VM); timing only\n");
+    printf("# 8-byte keys and values; per-operation values\n");
+    printf("%10s %-9s %8s", "entries", "phase", "ns");
+    for (size_t i = 0; i < EVENT_COUNT; i++)
+        printf(" %9s", event_specs[i].name);
+    printf(" %6s\n", "IPC");
+
+    int status = 0;
+    for (size_t s = 0; s < size_count && status == 0; s++)
+        status = run_size(&c, sizes[s], lookups);
+    counters_close(&c);
+    return status == 0 ? 0 : 1;
+}
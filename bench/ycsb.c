@@ -0,0 +1,657 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/chashmap.h"
+#include "../include/chashmap_instrument.h"
+#include "bench_util.h"
+
+/*
+ * YCSB-style multithreaded load for shared maps.
+ *
+ * A store wraps a HashMap for use from many threads. Two stores are built in:
+ *   - mutex:   one HashMap behind one pthread mutex.
+ *   - striped: N HashMaps, each behind its own mutex, picked by key hash.
+ * Another concurrent variant is compared by adding a Store entry.
+ *
+ * Workloads follow the YCSB core set:
+ *   A 50% read, 50% update          (zipfian)
+ *   B 95% read, 5% update           (zipfian)
+ *   C 100% read                     (zipfian)
+ *   D 95% read, 5% insert           (latest)
+ *   E 95% scan, 5% insert           (zipfian)
+ *   F 50% read, 50% read-modify-write (zipfian)
+ * HashMap is unordered, so a scan reads a run of consecutive key numbers
+ * (1 to --scan-max of them) with point reads.
+ *
+ * Each run loads --records keys with all threads, runs --warmup operations
+ * per thread, then --ops operations split across the threads. Latencies
+ * are per operation, in ns, in the histogram layout of chashmap_instrument.h.
+ */
+
+typedef enum
+{
+    OP_READ,
+    OP_UPDATE,
+    OP_INSERT,
+    OP_SCAN,
+    OP_RMW,
+    OP_KINDS
+} OpKind;
+
+static const char *const op_names[OP_KINDS] = {"read", "update", "insert", "scan", "rmw"};
+
+typedef enum
+{
+    CHOOSE_ZIPF,
+    CHOOSE_UNIFORM,
+    CHOOSE_LATEST
+} Chooser;
+
+static const char *const chooser_names[] = {"zipfian", "uniform", "latest"};
+
+typedef struct
+{
+    char name;
+    unsigned percent[OP_KINDS];
+    Chooser chooser;
+} Workload;
+
+static const Workload workloads[] = {
+    {'A', {50, 50, 0, 0, 0}, CHOOSE_ZIPF},
+    {'B', {95, 5, 0, 0, 0}, CHOOSE_ZIPF},
+    {'C', {100, 0, 0, 0, 0}, CHOOSE_ZIPF},
+    {'D', {95, 0, 5, 0, 0}, CHOOSE_LATEST},
+    {'E', {0, 0, 5, 95, 0}, CHOOSE_ZIPF},
+    {'F', {50, 0, 0, 0, 50}, CHOOSE_ZIPF},
+};
+
+/**
+ * A map shared by all worker threads.
+ */
+typedef struct
+{
+    const char *name;
+    void *(*create)(size_t expected, unsigned stripes);
+    void (*destroy)(void *store);
+    // 1 if found (value copied into buf, truncated to buf_size), 0 if not
+    int (*read)(void *store, const void *key, size_t key_size, void *buf, size_t buf_size);
+    int (*write)(void *store, const void *key, size_t key_size, const void *val, size_t val_size);
+} Store;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    HashMap map;
+} LockedMap;
+
+static int locked_init(LockedMap *m, size_t expected)
+{
+    size_t capacity = (size_t)((double)expected / HASHMAP_DEFAULT_LOAD_FACTOR) + 1;
+    if (hashmap_init(&m->map, capacity, NULL, NULL, 0.0f) != 0)
+        return -1;
+    pthread_mutex_init(&m->lock, NULL);
+    return 0;
+}
+
+static void locked_destroy(LockedMap *m)
+{
+    hashmap_destroy(&m->map);
+    pthread_mutex_destroy(&m->lock);
+}
+
+static int locked_read(LockedMap *m, const void *key, size_t key_size, void *buf, size_t buf_size)
+{
+    void *out = NULL;
+    size_t out_size = 0;
+    pthread_mutex_lock(&m->lock);
+    int found = hashmap_get(&m->map, key, key_size, &out, &out_size);
+    pthread_mutex_unlock(&m->lock);
+    if (found != 1)
+        return 0;
+    memcpy(buf, out, out_size < buf_size ? out_size : buf_size);
+    free(out);
+    return 1;
+}
+
+static int locked_write(LockedMap *m, const void *key, size_t key_size,
+                        const void *val, size_t val_size)
+{
+    pthread_mutex_lock(&m->lock);
+    int status = hashmap_insert(&m->map, key, key_size, val, val_size);
+    pthread_mutex_unlock(&m->lock);
+    return status;
+}
+
+static void *mutex_create(size_t expected, unsigned stripes)
+{
+    (void)stripes;
+    LockedMap *m = (LockedMap *)malloc(sizeof(LockedMap));
+    if (m && locked_init(m, expected) != 0)
+    {
+        free(m);
+        return NULL;
+    }
+    return m;
+}
+
+static void mutex_destroy(void *store)
+{
+    locked_destroy((LockedMap *)store);
+    free(store);
+}
+
+static int mutex_read(void *store, const void *key, size_t key_size, void *buf, size_t buf_size)
+{
+    return locked_read((LockedMap *)store, key, key_size, buf, buf_size);
+}
+
+static int mutex_write(void *store, const void *key, size_t key_size, const void *val, size_t val_size)
+{
+    return locked_write((LockedMap *)store, key, key_size, val, val_size);
+}
+
+/**
+ * One stripe per cache line group, so neighbouring locks do not share a line.
+ */
+typedef struct
+{
+    LockedMap m;
+    char pad[64 - sizeof(LockedMap) % 64];
+} Stripe;
+
+typedef struct
+{
+    unsigned count;
+    Stripe *stripes;
+} StripedMap;
+
+static Stripe *stripe_for(StripedMap *s, const void *key, size_t key_size)
+{
+    // Mix the hash so the stripe does not use the bits the stripe's buckets use
+    return &s->stripes[bench_mix64(hashmap_hash_bytes(key, key_size)) % s->count];
+}
+
+static void *striped_create(size_t expected, unsigned stripes)
+{
+    StripedMap *s = (StripedMap *)malloc(sizeof(StripedMap));
+    void *mem = NULL;
+    if (!s || posix_memalign(&mem, 64, stripes * sizeof(Stripe)) != 0)
+    {
+        free(s);
+        return NULL;
+    }
+    s->count = stripes;
+    s->stripes = (Stripe *)mem;
+    for (unsigned i = 0; i < stripes; i++)
+    {
+        if (locked_init(&s->stripes[i].m, expected / stripes + 1) != 0)
+        {
+            while (i-- > 0)
+                locked_destroy(&s->stripes[i].m);
+            free(mem);
+            free(s);
+            return NULL;
+        }
+    }
+    return s;
+}
+
+static void striped_destroy(void *store)
+{
+    StripedMap *s = (StripedMap *)store;
+    for (unsigned i = 0; i < s->count; i++)
+        locked_destroy(&s->stripes[i].m);
+    free(s->stripes);
+    free(s);
+}
+
+static int striped_read(void *store, const void *key, size_t key_size, void *buf, size_t buf_size)
+{
+    return locked_read(&stripe_for((StripedMap *)store, key, key_size)->m, key, key_size, buf, buf_size);
+}
+
+static int striped_write(void *store, const void *key, size_t key_size, const void *val, size_t val_size)
+{
+    return locked_write(&stripe_for((StripedMap *)store, key, key_size)->m, key, key_size, val, val_size);
+}
+
+static const Store stores[] = {
+    {"mutex", mutex_create, mutex_destroy, mutex_read, mutex_write},
+    {"striped", striped_create, striped_destroy, striped_read, striped_write},
+};
+
+#define STORE_COUNT (sizeof(stores) / sizeof(stores[0]))
+#define MAX_THREAD_COUNTS 32
+
+/**
+ * YCSB-style key: "user" followed by 16 hex digits of the scrambled key number.
+ */
+#define KEY_SIZE 20
+
+typedef struct
+{
+    size_t records;
+    size_t ops;
+    size_t warmup;
+    size_t value_size;
+    size_t scan_max;
+    unsigned stripes;
+    unsigned threads[MAX_THREAD_COUNTS];
+    size_t thread_count;
+    const char *workloads;
+    int store;    // -1 = all
+    int chooser;  // -1 = the workload's own
+    int per_thread;
+} Options;
+
+typedef struct Run
+{
+    const Options *o;
+    const Store *store;
+    void *handle;
+    const Workload *workload;
+    Chooser chooser;
+    unsigned threads;
+    BenchZipf zipf;
+    _Atomic uint64_t next_key; // Key number the next insert takes
+    pthread_barrier_t barrier;
+} Run;
+
+typedef struct
+{
+    pthread_t thread;
+    unsigned id;
+    Run *run;
+    uint64_t rng;
+    unsigned char *value;
+    unsigned char *buf;
+    uint64_t load_start, load_end;
+    uint64_t start, end;
+    size_t ops;
+    HashMapOpCounters counters[OP_KINDS];
+} Worker;
+
+static void make_key(char *key, uint64_t number)
+{
+    static const char hex[] = "0123456789abcdef";
+    uint64_t h = bench_mix64(number);
+    memcpy(key, "user", 4);
+    for (int i = 0; i < 16; i++)
+        key[4 + i] = hex[(h >> (60 - 4 * i)) & 15];
+}
+
+static uint64_t choose_key(Worker *w)
+{
+    Run *r = w->run;
+    uint64_t existing = atomic_load_explicit(&r->next_key, memory_order_relaxed);
+    switch (r->chooser)
+    {
+    case CHOOSE_UNIFORM:
+        return bench_rand(&w->rng) % existing;
+    case CHOOSE_LATEST:
+    {
+        uint64_t back = bench_zipf_next(&r->zipf, &w->rng);
+        return back < existing ? existing - 1 - back : 0;
+    }
+    default:
+        return bench_zipf_scrambled(&r->zipf, &w->rng);
+    }
+}
+
+static OpKind choose_op(Worker *w)
+{
+    unsigned roll = (unsigned)(bench_rand(&w->rng) % 100);
+    for (int op = 0; op < OP_KINDS; op++)
+    {
+        if (roll < w->run->workload->percent[op])
+            return (OpKind)op;
+        roll -= w->run->workload->percent[op];
+    }
+    return OP_READ;
+}
+
+static int do_op(Worker *w, OpKind op)
+{
+    Run *r = w->run;
+    const Store *s = r->store;
+    size_t value_size = r->o->value_size;
+    char key[KEY_SIZE];
+    int found = 1;
+
+    switch (op)
+    {
+    case OP_INSERT:
+        make_key(key, atomic_fetch_add_explicit(&r->next_key, 1, memory_order_relaxed));
+        s->write(r->handle, key, KEY_SIZE, w->value, value_size);
+        break;
+    case OP_SCAN:
+    {
+        uint64_t first = choose_key(w);
+        uint64_t length = 1 + bench_rand(&w->rng) % r->o->scan_max;
+        uint64_t existing = atomic_load_explicit(&r->next_key, memory_order_relaxed);
+        for (uint64_t k = first; k < first + length && k < existing; k++)
+        {
+            make_key(key, k);
+            found &= s->read(r->handle, key, KEY_SIZE, w->buf, value_size);
+        }
+        break;
+    }
+    default:
+        make_key(key, choose_key(w));
+        if (op != OP_UPDATE)
+            found = s->read(r->handle, key, KEY_SIZE, w->buf, value_size);
+        if (op != OP_READ)
+        {
+            memcpy(w->value, &w->rng, sizeof(w->rng) < value_size ? sizeof(w->rng) : value_size);
+            s->write(r->handle, key, KEY_SIZE, w->value, value_size);
+        }
+        break;
+    }
+    return found;
+}
+
+static void *worker_main(void *arg)
+{
+    Worker *w = (Worker *)arg;
+    Run *r = w->run;
+    char key[KEY_SIZE];
+
+    w->load_start = bench_now_ns();
+    for (size_t k = w->id; k < r->o->records; k += r->threads)
+    {
+        make_key(key, k);
+        r->store->write(r->handle, key, KEY_SIZE, w->value, r->o->value_size);
+    }
+    w->load_end = bench_now_ns();
+    pthread_barrier_wait(&r->barrier);
+
+    for (size_t i = 0; i < r->o->warmup; i++)
+        do_op(w, choose_op(w));
+    pthread_barrier_wait(&r->barrier);
+
+    w->start = bench_now_ns();
+    for (size_t i = 0; i < w->ops; i++)
+    {
+        OpKind op = choose_op(w);
+        uint64_t t0 = bench_now_ns();
+        int found = do_op(w, op);
+        uint64_t ns = bench_now_ns() - t0;
+        HashMapOpCounters *c = &w->counters[op];
+        c->calls++;
+        if (found)
+            c->hits++;
+        else
+            c->misses++;
+        c->samples++;
+        c->latency[bench_latency_slot(ns)]++;
+    }
+    w->end = bench_now_ns();
+    return NULL;
+}
+
+static void print_results(const Run *r, Worker *workers)
+{
+    const Options *o = r->o;
+    uint64_t load_start = UINT64_MAX, load_end = 0, start = UINT64_MAX, end = 0;
+    double min_rate = 0, max_rate = 0, sum_rate = 0;
+    HashMapOpCounters *total = (HashMapOpCounters *)calloc(OP_KINDS, sizeof(HashMapOpCounters));
+    if (!total)
+        return;
+
+    for (unsigned t = 0; t < r->threads; t++)
+    {
+        Worker *w = &workers[t];
+        load_start = w->load_start < load_start ? w->load_start : load_start;
+        load_end = w->load_end > load_end ? w->load_end : load_end;
+        start = w->start < start ? w->start : start;
+        end = w->end > end ? w->end : end;
+        double rate = w->end > w->start ? (double)w->ops * 1e9 / (double)(w->end - w->start) : 0;
+        min_rate = t == 0 || rate < min_rate ? rate : min_rate;
+        max_rate = rate > max_rate ? rate : max_rate;
+        sum_rate += rate;
+        if (o->per_thread)
+            printf("    thread %3u: %10.0f ops/s\n", t, rate);
+        for (int op = 0; op < OP_KINDS; op++)
+        {
+            total[op].calls += w->counters[op].calls;
+            total[op].hits += w->counters[op].hits;
+            total[op].misses += w->counters[op].misses;
+            total[op].samples += w->counters[op].samples;
+            for (size_t i = 0; i < HASHMAP_LATENCY_SLOTS; i++)
+                total[op].latency[i] += w->counters[op].latency[i];
+        }
+    }
+
+    size_t ops = 0;
+    for (unsigned t = 0; t < r->threads; t++)
+        ops += workers[t].ops;
+    printf("%-8s %c %-8s %3u  load %10.0f/s  run %11.0f ops/s  per thread min %10.0f avg %10.0f max %10.0f\n",
+           r->store->name, r->workload->name, chooser_names[r->chooser], r->threads,
+           (double)o->records * 1e9 / (double)(load_end - load_start),
+           (double)ops * 1e9 / (double)(end - start),
+           min_rate, sum_rate / r->threads, max_rate);
+    for (int op = 0; op < OP_KINDS; op++)
+    {
+        const HashMapOpCounters *c = &total[op];
+        if (c->calls == 0)
+            continue;
+        printf("    %-6s %10llu ops  p50 %7llu  p95 %7llu  p99 %7llu  p99.9 %8llu ns  misses %llu\n",
+               op_names[op], (unsigned long long)c->calls,
+               (unsigned long long)hashmap_counters_percentile(c, 50.0),
+               (unsigned long long)hashmap_counters_percentile(c, 95.0),
+               (unsigned long long)hashmap_counters_percentile(c, 99.0),
+               (unsigned long long)hashmap_counters_percentile(c, 99.9),
+               (unsigned long long)c->misses);
+    }
+    fflush(stdout);
+    free(total);
+}
+
+static int run_one(const Options *o, const Store *store, const Workload *workload, unsigned threads)
+{
+    Run r;
+    memset(&r, 0, sizeof(r));
+    r.o = o;
+    r.store = store;
+    r.workload = workload;
+    r.threads = threads;
+    r.chooser = o->chooser >= 0 ? (Chooser)o->chooser : workload->chooser;
+    bench_zipf_init(&r.zipf, o->records, 0.99);
+    atomic_init(&r.next_key, o->records);
+
+    size_t inserts = (o->ops + o->warmup * threads) * workload->percent[OP_INSERT] / 100;
+    r.handle = store->create(o->records + inserts, o->stripes);
+    Worker *workers = (Worker *)calloc(threads, sizeof(Worker));
+    if (!r.handle || !workers)
+    {
+        fprintf(stderr, "out of memory\n");
+        if (r.handle)
+            store->destroy(r.handle);
+        free(workers);
+        return -1;
+    }
+    pthread_barrier_init(&r.barrier, NULL, threads);
+
+    unsigned started = 0;
+    int status = 0;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        Worker *w = &workers[t];
+        w->id = t;
+        w->run = &r;
+        w->rng = bench_mix64(t + 1);
+        w->ops = o->ops / threads + (t < o->ops % threads);
+        w->value = (unsigned char *)malloc(o->value_size);
+        w->buf = (unsigned char *)malloc(o->value_size);
+        if (!w->value || !w->buf)
+        {
+            status = -1;
+            break;
+        }
+        memset(w->value, 'a' + (int)(t % 26), o->value_size);
+    }
+    if (status == 0)
+    {
+        for (; started < threads; started++)
+            if (pthread_create(&workers[started].thread, NULL, worker_main, &workers[started]) != 0)
+                break;
+        // A run needs every thread at the barriers
+        if (started != threads)
+        {
+            fprintf(stderr, "could only start %u of %u threads\n", started, threads);
+            exit(1);
+        }
+        for (unsigned t = 0; t < threads; t++)
+            pthread_join(workers[t].thread, NULL);
+        print_results(&r, workers);
+    }
+
+    pthread_barrier_destroy(&r.barrier);
+    for (unsigned t = 0; t < threads; t++)
+    {
+        free(workers[t].value);
+        free(workers[t].buf);
+    }
+    free(workers);
+    store->destroy(r.handle);
+    return status;
+}
+
+static size_t parse_threads(const char *list, unsigned *threads)
+{
+    size_t count = 0;
+    while (*list && count < MAX_THREAD_COUNTS)
+    {
+        char *end = NULL;
+        unsigned long n = strtoul(list, &end, 10);
+        if (end == list || n == 0)
+            return 0;
+        threads[count++] = (unsigned)n;
+        list = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',')
+            return 0;
+    }
+    return count;
+}
+
+static int parse_options(int argc, char **argv, Options *o)
+{
+    memset(o, 0, sizeof(*o));
+    o->records = 1000000;
+    o->ops = 1000000;
+    o->warmup = 10000;
+    o->value_size = 100;
+    o->scan_max = 100;
+    o->stripes = 256;
+    o->workloads = "ABCDEF";
+    o->store = -1;
+    o->chooser = -1;
+
+    // Default thread counts: powers of two up to the CPU count, plus the CPU count
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1)
+        cpus = 1;
+    for (unsigned n = 1; n < (unsigned)cpus && o->thread_count < MAX_THREAD_COUNTS - 1; n *= 2)
+        o->threads[o->thread_count++] = n;
+    o->threads[o->thread_count++] = (unsigned)cpus;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--per-thread") == 0)
+        {
+            o->per_thread = 1;
+            continue;
+        }
+        if (!val)
+            return -1;
+        i++;
+        if (strcmp(arg, "--records") == 0)
+            o->records = strtoull(val, NULL, 10);
+        else if (strcmp(arg, "--ops") == 0)
+            o->ops = strtoull(val, NULL, 10);
+        else if (strcmp(arg, "--warmup") == 0)
+            o->warmup = strtoull(val, NULL, 10);
+        else if (strcmp(arg, "--value-size") == 0)
+            o->value_size = strtoull(val, NULL, 10);
+        else if (strcmp(arg, "--scan-max") == 0)
+            o->scan_max = strtoull(val, NULL, 10);
+        else if (strcmp(arg, "--stripes") == 0)
+            o->stripes = (unsigned)strtoul(val, NULL, 10);
+        else if (strcmp(arg, "--workloads") == 0)
+            o->workloads = val;
+        else if (strcmp(arg, "--threads") == 0)
+        {
+            o->thread_count = parse_threads(val, o->threads);
+            if (o->thread_count == 0)
+                return -1;
+        }
+        else if (strcmp(arg, "--store") == 0)
+        {
+            o->store = -2;
+            for (size_t s = 0; s < STORE_COUNT; s++)
+                if (strcmp(val, stores[s].name) == 0)
+                    o->store = (int)s;
+            if (strcmp(val, "all") == 0)
+                o->store = -1;
+            if (o->store == -2)
+                return -1;
+        }
+        else if (strcmp(arg, "--dist") == 0)
+        {
+            o->chooser = strcmp(val, "zipfian") == 0   ? CHOOSE_ZIPF
+                         : strcmp(val, "uniform") == 0 ? CHOOSE_UNIFORM
+                         : strcmp(val, "latest") == 0  ? CHOOSE_LATEST
+                                                       : -2;
+            if (o->chooser == -2)
+                return -1;
+        }
+        else
+            return -1;
+    }
+    return o->records && o->value_size && o->scan_max && o->stripes ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    Options o;
+    if (parse_options(argc, argv, &o) != 0)
+    {
+        fprintf(stderr,
+                "usage: %s [--workloads ABCDEF] [--threads 1,2,4] [--store mutex|striped|all]\n"
+                "          [--records N] [--ops N] [--warmup N] [--value-size N] [--scan-max N]\n"
+                "          [--stripes N] [--dist zipfian|uniform|latest] [--per-thread]\n",
+                argv[0]);
+        return 2;
+    }
+
+    printf("# %zu records, %zu ops per run, %zu warmup ops per thread, %zu-byte values, %u stripes\n",
+           o.records, o.ops, o.warmup, o.value_size, o.stripes);
+    for (const char *wl = o.workloads; *wl; wl++)
+    {
+        const Workload *workload = NULL;
+        for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++)
+            if (workloads[i].name == (*wl & ~0x20))
+                workload = &workloads[i];
+        if (!workload)
+        {
+            fprintf(stderr, "unknown workload '%c'\n", *wl);
+            return 2;
+        }
+        for (size_t s = 0; s < STORE_COUNT; s++)
+        {
+            if (o.store >= 0 && (size_t)o.store != s)
+                continue;
+            for (size_t t = 0; t < o.thread_count; t++)
+                if (run_one(&o, &stores[s], workload, o.threads[t]) != 0)
+                    return 1;
+        }
+    }
+    return 0;
+}
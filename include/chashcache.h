@@ -0,0 +1,201 @@
+#ifndef CHASHCACHE_H
+#define CHASHCACHE_H
+
+#include "chashmap.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * Called for each entry evicted to make room. The key and value bytes are
+     * only valid during the call.
+     */
+    typedef void (*evict_func_t)(const void *key_data, size_t key_size,
+                                 const void *val_data, size_t val_size,
+                                 void *ctx);
+
+    /**
+     * Eviction policy of a HashCache.
+     *   - HASHCACHE_LRU:     least recently used; every hit moves the entry.
+     *   - HASHCACHE_CLOCK:   second chance; a hit only sets a reference bit.
+     *   - HASHCACHE_S3FIFO:  small + main FIFO queues and a ghost queue of
+     *                        recently evicted hashes (Yang et al., SOSP'23).
+     *   - HASHCACHE_TINYLFU: W-TinyLFU; a 1% LRU window in front of a
+     *                        segmented LRU, admission decided by a count-min
+     *                        sketch of access frequencies.
+     * CLOCK, S3-FIFO and W-TinyLFU are resistant to one-off scans.
+     */
+    typedef enum
+    {
+        HASHCACHE_LRU = 0,
+        HASHCACHE_CLOCK,
+        HASHCACHE_S3FIFO,
+        HASHCACHE_TINYLFU
+    } HashCachePolicy;
+
+    /**
+     * An entry of a HashCache: a HashMapEntry plus intrusive links into the
+     * policy's queue, so a lookup and the policy update share one probe. The
+     * key's hash is kept so resizing and eviction never rehash a key.
+     */
+    typedef struct HashCacheEntry
+    {
+        HashMapData key;
+        HashMapData value;
+        size_t key_size;
+        size_t value_size;
+        struct HashCacheEntry *next;      // Chain link
+        uint64_t hash;                    // hash_func of the key
+        struct HashCacheEntry *list_prev; // Towards the queue head (newest)
+        struct HashCacheEntry *list_next; // Towards the queue tail (eviction end)
+        unsigned char queue;              // Which queue the entry is in
+        unsigned char freq;               // Reference bit (CLOCK) / frequency (S3-FIFO)
+    } HashCacheEntry;
+
+    /**
+     * A queue of entries, newest at the head.
+     */
+    typedef struct
+    {
+        HashCacheEntry *head;
+        HashCacheEntry *tail;
+        size_t count;
+        size_t bytes;
+    } HashCacheList;
+
+    /**
+     * Hit/miss counters of a HashCache (see hashcache_get_stats()).
+     */
+    typedef struct
+    {
+        uint64_t hits;      // Lookups that found the key
+        uint64_t misses;    // Lookups that did not
+        uint64_t evictions; // Entries evicted to make room
+        uint64_t rejected;  // New entries refused admission (W-TinyLFU)
+        double hit_ratio;   // hits / (hits + misses), 0 if no lookups
+    } HashCacheStats;
+
+    /**
+     * A bounded map that evicts entries according to its policy once it holds
+     * more than `max_entries` entries or more than `max_bytes` of key + value
+     * bytes (a limit of 0 means unlimited).
+     */
+    typedef struct
+    {
+        HashCacheEntry **buckets;  // Array of pointers to entries
+        size_t capacity;           // Number of buckets
+        size_t size;               // Number of key-value pairs stored
+        size_t bytes;              // Sum of key and value sizes
+        size_t max_entries;        // Entry limit (0 = none)
+        size_t max_bytes;          // Byte limit (0 = none)
+        hash_func_t hash_func;     // Hash function
+        eq_func_t eq_func;         // Equality function
+        float load_factor;         // Max load factor before resizing
+        HashCachePolicy policy;    // Eviction policy
+        HashCacheList queues[3];   // Policy queues (LRU/CLOCK use queues[0])
+        evict_func_t evict_func;   // Optional eviction callback
+        void *evict_ctx;           // Passed to evict_func
+        uint64_t *ghost;           // S3-FIFO: ring of evicted key hashes
+        unsigned char *ghost_hits; // S3-FIFO: per-slot ghost counts
+        size_t ghost_capacity;     // S3-FIFO: ring size
+        size_t ghost_pos;          // S3-FIFO: next ring slot
+        unsigned char *sketch;     // W-TinyLFU: 4 rows of saturating counters
+        size_t sketch_width;       // W-TinyLFU: counters per row (power of two)
+        size_t sketch_adds;        // W-TinyLFU: increments since last aging
+        uint64_t hits;             // Statistics, see HashCacheStats
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t rejected;
+    } HashCache;
+
+    /**
+     * Initialize a new HashCache with LRU eviction.
+     *   @param cache        Pointer to a HashCache to initialize.
+     *   @param max_entries  Maximum number of entries (0 = unlimited).
+     *   @param max_bytes    Maximum key + value bytes (0 = unlimited).
+     *   @param hash_func    Hash function (NULL => default).
+     *   @param eq_func      Equality function (NULL => default).
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashcache_init(HashCache *cache,
+                       size_t max_entries,
+                       size_t max_bytes,
+                       hash_func_t hash_func,
+                       eq_func_t eq_func);
+
+    /**
+     * Initialize a new HashCache with the given eviction policy.
+     * Parameters are the same as hashcache_init().
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashcache_init_policy(HashCache *cache,
+                              size_t max_entries,
+                              size_t max_bytes,
+                              hash_func_t hash_func,
+                              eq_func_t eq_func,
+                              HashCachePolicy policy);
+
+    /**
+     * Free all resources used by the HashCache. The eviction callback is not called.
+     */
+    void hashcache_destroy(HashCache *cache);
+
+    /**
+     * Set the callback invoked for every evicted entry (NULL to disable).
+     */
+    void hashcache_set_evict_callback(HashCache *cache, evict_func_t evict_func, void *ctx);
+
+    /**
+     * Insert or update a key-value pair, then evict entries according to the
+     * policy until the cache is within its limits. Under W-TinyLFU the entry
+     * evicted may be a new one that lost the admission check.
+     *   @return 0 on success, non-zero on error (including an entry larger
+     *           than max_bytes on its own).
+     */
+    int hashcache_insert(HashCache *cache,
+                         const void *key_data, size_t key_size,
+                         const void *val_data, size_t val_size);
+
+    /**
+     * Retrieve a copy of a value and record the access with the policy.
+     *   @param out_val    Will be allocated and filled if found. Caller must free.
+     *   @param out_size   Size of the returned value in bytes.
+     *   @return 1 if found, 0 if not found, < 0 on error.
+     */
+    int hashcache_get(HashCache *cache,
+                      const void *key_data, size_t key_size,
+                      void **out_val, size_t *out_size);
+
+    /**
+     * Look up a value without copying it and record the access with the policy.
+     *   @param out_size   If non-NULL, receives the size of the value.
+     *   @return Pointer to the stored value bytes, or NULL if not found.
+     *           Valid until the next insert or remove on the cache.
+     */
+    void *hashcache_find(HashCache *cache,
+                         const void *key_data, size_t key_size,
+                         size_t *out_size);
+
+    /**
+     * Remove a key-value pair (the eviction callback is not called).
+     *   @return 1 if removed, 0 if not found, < 0 on error.
+     */
+    int hashcache_remove(HashCache *cache, const void *key_data, size_t key_size);
+
+    /**
+     * Read the hit/miss counters.
+     */
+    void hashcache_get_stats(const HashCache *cache, HashCacheStats *stats);
+
+    /**
+     * Reset the hit/miss counters to zero.
+     */
+    void hashcache_reset_stats(HashCache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHASHCACHE_H
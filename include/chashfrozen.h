@@ -0,0 +1,78 @@
+#ifndef CHASHFROZEN_H
+#define CHASHFROZEN_H
+
+#include "chashmap.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * Where a frozen key and its value live: the key is at data + offset and
+     * the value follows it.
+     */
+    typedef struct
+    {
+        uint64_t offset;
+        uint32_t key_size;
+        uint32_t value_size;
+    } FrozenHashMapSlot;
+
+    /**
+     * A read-only map built from a HashMap by hashmap_freeze().
+     *
+     * Keys are placed by a minimal perfect hash function (PTHash-style: keys
+     * are split into partitions, each partition into buckets, and every bucket
+     * stores an 8-bit "pilot" that sends its keys to free slots). A lookup
+     * computes one slot and compares one key; there are no chains. Keys whose
+     * hashes are identical are kept in a small overflow table, searched only
+     * when the key in the computed slot does not match.
+     */
+    typedef struct
+    {
+        FrozenHashMapSlot *slots;                  // One slot per key
+        unsigned char *data;                       // Packed keys and values
+        size_t size;                               // Number of keys
+        struct FrozenHashMapPartition *partitions; // Per-partition parameters
+        size_t npartitions;                        // Number of partitions
+        uint8_t *pilots;                           // One pilot per bucket
+        uint64_t *escapes;                         // Pilots that do not fit in 8 bits
+        size_t nescapes;                           // Number of escapes
+        uint16_t *remap;                           // Slots past the end -> free slots
+        struct FrozenHashMapOverflow *overflow;    // Keys sharing a hash, sorted by hash
+        size_t noverflow;                          // Number of overflow keys
+        size_t index_bytes;                        // Bytes used by the hash function
+        hash_func_t hash_func;                     // Hash function (the map's)
+        eq_func_t eq_func;                         // Equality function (the map's)
+    } FrozenHashMap;
+
+    /**
+     * Build a FrozenHashMap holding a copy of every entry of `map`.
+     * Partitions are built in parallel on `nthreads` threads.
+     *   @param map       Source map; it is not modified and may be destroyed afterwards.
+     *   @param frozen    Pointer to an uninitialized FrozenHashMap.
+     *   @param nthreads  Worker threads (0 => one per online CPU).
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmap_freeze(const HashMap *map, FrozenHashMap *frozen, unsigned nthreads);
+
+    /**
+     * Free all resources used by the FrozenHashMap.
+     */
+    void hashmap_frozen_destroy(FrozenHashMap *frozen);
+
+    /**
+     * Look up a key. `*val_out` points into the frozen map's storage and
+     * stays valid until hashmap_frozen_destroy().
+     *   @return 1 if found, 0 if not found, <0 on error.
+     */
+    int hashmap_frozen_get(const FrozenHashMap *frozen,
+                           const void *key_data, size_t key_size,
+                           const void **val_out, size_t *val_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHASHFROZEN_H
@@ -0,0 +1,72 @@
+#ifndef CHASHIMAGE_H
+#define CHASHIMAGE_H
+
+#include "chashmap.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * A read-only map image, mapped from a file written by hashmap_image_write().
+     *
+     * The file holds a header, a table of bucket offsets and a packed record
+     * region, all addressed by offsets from the start of the file. Lookups
+     * run directly on the mapping, so opening an image costs one mmap() and
+     * processes that open the same file share its page-cache copy.
+     */
+    typedef struct
+    {
+        const unsigned char *base;     // Start of the mapping
+        size_t length;                 // Length of the mapping in bytes
+        const uint64_t *offsets;       // nbuckets + 1 record offsets
+        const unsigned char *records;  // Packed record region
+        size_t nbuckets;               // Number of buckets (power of two)
+        size_t size;                   // Number of entries
+        hash_func_t hash_func;         // Hash function (must match the writer's)
+        eq_func_t eq_func;             // Equality function
+    } HashMapImage;
+
+    /**
+     * Write the contents of `map` to `path` as a map image. Each bucket's
+     * records are stored contiguously with their hashes, so a lookup reads
+     * one offset pair and scans one packed run. The file is written under a
+     * temporary name and renamed into place.
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmap_image_write(const HashMap *map, const char *path);
+
+    /**
+     * Map an image file for reading.
+     *   @param image      Pointer to an uninitialized HashMapImage.
+     *   @param path       File written by hashmap_image_write().
+     *   @param hash_func  Hash function the image was written with (NULL => default).
+     *   @param eq_func    Equality function (NULL => default).
+     *   @return 0 on success, non-zero on error (bad file, or a hash function
+     *           that does not match the stored hashes).
+     */
+    int hashmap_image_open(HashMapImage *image, const char *path,
+                           hash_func_t hash_func, eq_func_t eq_func);
+
+    /**
+     * Unmap the image. Pointers returned by hashmap_image_get() become invalid.
+     */
+    void hashmap_image_close(HashMapImage *image);
+
+    /**
+     * Look up a key. Nothing is copied: `*val_out` points into the mapping
+     * and stays valid until hashmap_image_close().
+     *   @param val_out   Receives a pointer to the value bytes.
+     *   @param val_size  Receives the value size.
+     *   @return 1 if found, 0 if not found, <0 on error.
+     */
+    int hashmap_image_get(const HashMapImage *image,
+                          const void *key_data, size_t key_size,
+                          const void **val_out, size_t *val_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHASHIMAGE_H
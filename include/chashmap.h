@@ -28,31 +28,124 @@ extern "C"
      */
     typedef int (*eq_func_t)(const void *key_a, const void *key_b, size_t key_size);
 
+    /**
+     * A function pointer type for matching a stored key against a lookup
+     * context (see hashmap_find_hashed()).
+     *   @param key_data: Pointer to the stored key bytes.
+     *   @param key_size: The size in bytes of the stored key.
+     *   @param ctx: The context passed to the lookup.
+     *   @return Non-zero if the stored key matches, 0 otherwise.
+     */
+    typedef int (*match_func_t)(const void *key_data, size_t key_size, void *ctx);
+
+/**
+ * Defaults used when hashmap_init() is given a capacity of 0 or a load factor <= 0.
+ */
+#define HASHMAP_DEFAULT_CAPACITY 16
+#define HASHMAP_DEFAULT_LOAD_FACTOR 0.75f
+
+/**
+ * Keys and values of at most this many bytes are stored inline in the entry
+ * instead of in a separate heap allocation.
+ */
+#define HASHMAP_INLINE_SIZE 16
+
+    /**
+     * Storage for a key or a value. The size stored next to it acts as the tag:
+     *   - size <= HASHMAP_INLINE_SIZE: the bytes live in `bytes`.
+     *   - otherwise: `ptr` points to a heap copy owned by the map.
+     * Inline bytes are only pointer-aligned.
+     */
+    typedef union
+    {
+        void *ptr;
+        unsigned char bytes[HASHMAP_INLINE_SIZE];
+    } HashMapData;
+
     /**
      * An entry in the hash map’s separate chaining list.
+     * Use hashmap_entry_key() / hashmap_entry_value() to reach the bytes.
      */
     typedef struct HashMapEntry
     {
-        void *key;
+        HashMapData key;
+        HashMapData value;
         size_t key_size;
-        void *value;
         size_t value_size;
         struct HashMapEntry *next;
     } HashMapEntry;
 
+    /**
+     * Return a pointer to the bytes held by `data`, given their size.
+     */
+    static inline void *hashmap_data_bytes(const HashMapData *data, size_t size)
+    {
+        return (size <= HASHMAP_INLINE_SIZE) ? (void *)data->bytes : data->ptr;
+    }
+
+    /**
+     * Return a pointer to the key bytes of an entry.
+     */
+    static inline void *hashmap_entry_key(const HashMapEntry *entry)
+    {
+        return hashmap_data_bytes(&entry->key, entry->key_size);
+    }
+
+    /**
+     * Return a pointer to the value bytes of an entry.
+     */
+    static inline void *hashmap_entry_value(const HashMapEntry *entry)
+    {
+        return hashmap_data_bytes(&entry->value, entry->value_size);
+    }
+
     /**
      * The main HashMap structure.
      */
     typedef struct
     {
-        HashMapEntry **buckets; // Array of pointers to entries
-        size_t capacity;        // Number of buckets
-        size_t size;            // Number of key-value pairs stored
-        hash_func_t hash_func;  // Hash function
-        eq_func_t eq_func;      // Equality function
-        float load_factor;      // Max load factor before resizing
+        HashMapEntry **buckets;           // Array of pointers to entries
+        size_t capacity;                  // Number of buckets
+        size_t size;                      // Number of key-value pairs stored
+        hash_func_t hash_func;            // Hash function
+        eq_func_t eq_func;                // Equality function
+        float load_factor;                // Max load factor before resizing
+        struct HashMapFilter *filter;     // Optional membership filter (NULL = none)
+        struct HashMapSlab *slabs;        // Bulk-allocated entries (see hashmap_load)
+        struct HashMapWal *wal;           // Write-ahead log (NULL = not durable)
+        struct HashMapSnapshot *snapshot; // Snapshot in progress (NULL = none)
+        size_t resize_count;              // Resizes since hashmap_init()
+        uint64_t resize_ns;               // Time spent resizing, in nanoseconds
+        unsigned resize_threads;          // Threads that rehash large tables (1 = serial)
     } HashMap;
 
+/**
+ * Chain lengths told apart by HashMapStats; the last slot also counts longer chains.
+ */
+#define HASHMAP_STATS_CHAINS 16
+
+    /**
+     * A snapshot of a map's shape and memory use, filled in by hashmap_stats().
+     */
+    typedef struct
+    {
+        size_t size;                                  // Number of key-value pairs
+        size_t capacity;                              // Number of buckets
+        double load;                                  // size / capacity
+        size_t max_chain;                             // Longest chain
+        double mean_chain;                            // Mean length of non-empty chains
+        double empty_fraction;                        // Fraction of empty buckets
+        size_t chain_histogram[HASHMAP_STATS_CHAINS]; // [n] = buckets with n entries
+        size_t resize_count;                          // Resizes since hashmap_init()
+        uint64_t resize_ns;                           // Time spent resizing
+        size_t bucket_bytes;                          // Bucket array
+        size_t entry_bytes;                           // HashMapEntry structs
+        size_t key_bytes;                             // Keys stored outside entries
+        size_t value_bytes;                           // Values stored outside entries
+        size_t filter_bytes;                          // Membership filter, if enabled
+        size_t total_bytes;                           // Sum of the above
+    } HashMapStats;
+
     /**
      * Initialize a new HashMap.
      *   @param map        Pointer to a HashMap to initialize.
@@ -67,6 +160,11 @@ extern "C"
                      eq_func_t eq_func,
                      float load_factor);
 
+    /**
+     * The default hash function (Jenkins' one-at-a-time over the key bytes).
+     */
+    uint64_t hashmap_hash_bytes(const void *data, size_t size);
+
     /**
      * Free all resources used by the HashMap.
      */
@@ -87,6 +185,42 @@ extern "C"
                        const void *key_data, size_t key_size,
                        const void *val_data, size_t val_size);
 
+    /**
+     * Insert n key-value pairs, with the same result as calling
+     * hashmap_insert() on each pair in order: same size and capacity, and
+     * for repeated keys the last value wins. Into an empty map, keys are
+     * hashed in parallel, the buckets are sized once, pairs are scattered by
+     * bucket range and each range is linked by one thread without locks.
+     * Entries and out-of-line bytes come from two bulk allocations, returned
+     * by hashmap_destroy() (as for hashmap_load()). Non-empty, durable or
+     * snapshotting maps and small inputs take the hashmap_insert() path.
+     *   @param map        Pointer to the HashMap.
+     *   @param keys       keys[i] points to key_sizes[i] bytes (sizes > 0).
+     *   @param vals       vals[i] points to val_sizes[i] bytes.
+     *   @param n          Number of pairs.
+     *   @param nthreads   Worker threads (0 => one per online CPU).
+     *   @return 0 on success, non-zero on error (an invalid pair leaves the
+     *           map unchanged).
+     */
+    int hashmap_build_bulk(HashMap *map,
+                           const void *const *keys, const size_t *key_sizes,
+                           const void *const *vals, const size_t *val_sizes,
+                           size_t n, unsigned nthreads);
+
+    /**
+     * Rehash large tables on `nthreads` threads when the map doubles. Each
+     * thread relinks a disjoint range of old buckets: old bucket i only
+     * feeds new buckets i and i + capacity, so no locks are needed and the
+     * chains come out as a serial resize leaves them. Tables under 65536
+     * buckets are always rehashed serially. The hash function must be safe
+     * to call from several threads at once.
+     *   @param map       Pointer to the HashMap.
+     *   @param nthreads  Worker threads (0 => one per online CPU, 1 => serial,
+     *                    the default).
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmap_set_resize_threads(HashMap *map, unsigned nthreads);
+
     /**
      * Retrieve a value associated with a key.
      *   @param map        Pointer to the HashMap.
@@ -109,6 +243,174 @@ extern "C"
      */
     int hashmap_remove(HashMap *map, const void *key_data, size_t key_size);
 
+    /**
+     * Find an entry given a precomputed hash and a match callback, without
+     * copying anything. This allows lookups by a key representation other
+     * than the stored bytes (e.g. from language bindings).
+     *   @param map        Pointer to the HashMap.
+     *   @param hash       Hash of the key; must equal what map->hash_func
+     *                     returns for the stored key it should match.
+     *   @param match      Called on each candidate in the chain.
+     *   @param ctx        Passed through to `match`.
+     *   @return The matching entry, or NULL if not found. The entry stays
+     *           valid until it is removed or the map is destroyed.
+     */
+    HashMapEntry *hashmap_find_hashed(const HashMap *map, uint64_t hash,
+                                      match_func_t match, void *ctx);
+
+    /**
+     * Insert-if-absent in one chain walk: return the entry
+     * hashmap_find_hashed() would find, or else link a new entry holding a
+     * copy of `key_data` and an empty value into the chain for `hash`.
+     * The caller may overwrite the new entry's key bytes in place (through
+     * hashmap_entry_key()) as long as map->hash_func still maps them to `hash`.
+     *   @param map        Pointer to the HashMap.
+     *   @param hash       Hash of the key, as for hashmap_find_hashed().
+     *   @param match      Called on each candidate in the chain.
+     *   @param ctx        Passed through to `match`.
+     *   @param key_data   Key bytes stored if no entry matches.
+     *   @param key_size   Size of the key in bytes.
+     *   @param inserted   If not NULL, set to 1 if a new entry was linked and
+     *                     0 if a match was found.
+     *   @return The matching or new entry, or NULL on error (map unchanged).
+     */
+    HashMapEntry *hashmap_insert_hashed(HashMap *map, uint64_t hash,
+                                        match_func_t match, void *ctx,
+                                        const void *key_data, size_t key_size,
+                                        int *inserted);
+
+    /**
+     * Remove the entry hashmap_find_hashed() would return, unlinking it from
+     * the chain in the same walk.
+     *   @param map        Pointer to the HashMap.
+     *   @param hash       Hash of the key, as for hashmap_find_hashed().
+     *   @param match      Called on each candidate in the chain; the first
+     *                     match is removed (its key bytes are still valid
+     *                     during the call).
+     *   @param ctx        Passed through to `match`.
+     *   @return 1 if removed, 0 if not found, < 0 on error.
+     */
+    int hashmap_remove_hashed(HashMap *map, uint64_t hash, match_func_t match, void *ctx);
+
+    /**
+     * Walk the map and report its chain-length distribution, resize history
+     * and memory use. O(size + capacity).
+     *   @param map    Pointer to the HashMap.
+     *   @param stats  Filled in on success.
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmap_stats(const HashMap *map, HashMapStats *stats);
+
+    /**
+     * Write the map to `path` in a versioned binary format holding each
+     * entry's key bytes, value bytes and hash. The file is written under a
+     * temporary name and renamed into place. Integers are in host byte order.
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmap_save(const HashMap *map, const char *path);
+
+    /**
+     * Initialize `map` from a file written by hashmap_save().
+     * Buckets are sized once, entries and out-of-line bytes are carved from
+     * two bulk allocations, and the stored hashes are reused when they match
+     * `hash_func` (checked on a sample of entries). Memory of entries loaded
+     * this way is returned by hashmap_destroy(), not by hashmap_remove().
+     *   @param map        Pointer to an uninitialized HashMap.
+     *   @param path       File to read.
+     *   @param hash_func  Hash function (NULL => default); should be the one
+     *                     the map was saved with.
+     *   @param eq_func    Equality function (NULL => default).
+     *   @return 0 on success, non-zero on error (map left uninitialized).
+     */
+    int hashmap_load(HashMap *map, const char *path,
+                     hash_func_t hash_func, eq_func_t eq_func);
+
+    /**
+     * Start writing a point-in-time snapshot of the map to `path` (in the
+     * hashmap_save() format) on a background thread. The map stays usable.
+     * Before an insert or remove changes a bucket the thread has not copied
+     * yet, that bucket is copied into the snapshot first. The map does not
+     * resize until hashmap_snapshot_wait() is called. The map must not be
+     * modified by other threads (as usual), but the snapshot thread runs
+     * alongside the caller's inserts and removes.
+     *   @return 0 if the snapshot started, non-zero on error (including a
+     *           snapshot already in progress).
+     */
+    int hashmap_snapshot_begin(HashMap *map, const char *path);
+
+    /**
+     * Wait for the snapshot started by hashmap_snapshot_begin() to finish.
+     *   @return 0 if the snapshot file was written and renamed into place,
+     *           non-zero on error or if no snapshot was started.
+     */
+    int hashmap_snapshot_wait(HashMap *map);
+
+    /**
+     * Initialize `map` as a durable map backed by the write-ahead log `path`.
+     * The map is rebuilt from the checkpoint `path`.ckpt (if present) and the
+     * log records after it; a torn record at the end of the log is discarded.
+     * From then on, every successful hashmap_insert() and hashmap_remove()
+     * appends a record just before changing the map, once everything the
+     * change needs has been allocated; an operation that fails is not
+     * logged. Records are written and fdatasync'ed in groups: once
+     * `sync_ops` are pending, or every `sync_ms` milliseconds by a background
+     * thread. hashmap_destroy() closes the log.
+     * If a group fails to reach the disk, the log is truncated back to the
+     * last committed group and stays failed: the operation that triggered the
+     * commit returns -1 and later ones are refused. Should that truncation
+     * fail too, whether the uncommitted group survives a crash is unknown.
+     * A record that cannot be replayed makes this call fail without changing
+     * the log.
+     *   @param map        Pointer to an uninitialized HashMap.
+     *   @param path       Log file (created if missing).
+     *   @param hash_func  Hash function (NULL => default).
+     *   @param eq_func    Equality function (NULL => default).
+     *   @param sync_ms    Group-commit interval (0 => only commit on `sync_ops`).
+     *   @param sync_ops   Pending records that trigger a commit (0 => 1, i.e.
+     *                     commit every operation).
+     *   @return 0 on success, non-zero on error (map left uninitialized).
+     */
+    int hashmap_wal_open(HashMap *map, const char *path,
+                         hash_func_t hash_func, eq_func_t eq_func,
+                         unsigned sync_ms, unsigned sync_ops);
+
+    /**
+     * Write and fdatasync every record appended so far.
+     *   @return 0 on success, non-zero if the log is not open or I/O failed.
+     */
+    int hashmap_wal_sync(HashMap *map);
+
+    /**
+     * Compact the log: write the whole map to the checkpoint file, then
+     * truncate the log to empty.
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmap_wal_checkpoint(HashMap *map);
+
+    /**
+     * Commit pending records and detach the log; the map stays usable but is
+     * no longer durable.
+     *   @return 0 on success (or if no log is open), non-zero if the final
+     *           commit failed.
+     */
+    int hashmap_wal_close(HashMap *map);
+
+    /**
+     * Put a blocked Bloom filter in front of the map so that most lookups of
+     * absent keys cost one cache line instead of a bucket and chain walk.
+     * The filter is built from the current keys, updated on insert, rebuilt
+     * as the map grows and after enough removals.
+     *   @param map           Pointer to the HashMap.
+     *   @param bits_per_key  Filter bits per key (0 => 10, about 1% false positives).
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmap_enable_filter(HashMap *map, unsigned bits_per_key);
+
+    /**
+     * Remove the membership filter, if any.
+     */
+    void hashmap_disable_filter(HashMap *map);
+
 #ifdef __cplusplus
 }
 #endif
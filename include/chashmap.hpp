@@ -0,0 +1,500 @@
+#ifndef CHASHMAP_HPP
+#define CHASHMAP_HPP
+
+/*
+ * Header-only C++17 wrapper over the C HashMap engine.
+ *
+ *   chashmap::flat_map<K, V, Hash, Eq, Alloc>
+ *
+ * Each element is a `std::pair<const K, V>` node allocated through `Alloc`
+ * and constructed in place; the C map stores only the node pointer (inline,
+ * see HASHMAP_INLINE_SIZE). Lookups hash on the C++ side and return pointers
+ * to the node, so nothing is copied. Element addresses are stable until the
+ * element is erased.
+ *
+ * `Hash` and `Eq` must be stateless and default-constructible: the C engine
+ * re-hashes stored keys through a plain function pointer when it resizes.
+ * If both define `is_transparent`, find/contains/erase accept any key type
+ * they can hash and compare (e.g. std::string_view against std::string).
+ *
+ * A moved-from map is empty and usable; it allocates buckets again on its
+ * next insert.
+ */
+
+#include "chashmap.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace chashmap
+{
+    /**
+     * Default hasher. Integers use a multiply + xor-shift mix; strings use
+     * the same one-at-a-time hash as hashmap_hash_bytes(). Both are constexpr.
+     * Other types fall back to std::hash.
+     */
+    template <class K, class = void>
+    struct hash : std::hash<K>
+    {
+    };
+
+    template <class K>
+    struct hash<K, std::enable_if_t<std::is_integral_v<K>>>
+    {
+        constexpr std::uint64_t operator()(K key) const noexcept
+        {
+            std::uint64_t h = static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15ULL;
+            return h ^ (h >> 32);
+        }
+    };
+
+    /**
+     * Transparent string hasher, usable with std::string, std::string_view
+     * and const char * alike.
+     */
+    struct string_hash
+    {
+        using is_transparent = void;
+
+        constexpr std::uint64_t operator()(std::string_view key) const noexcept
+        {
+            std::uint64_t h = 0;
+            for (char c : key)
+            {
+                h += static_cast<unsigned char>(c);
+                h += (h << 10);
+                h ^= (h >> 6);
+            }
+            h += (h << 3);
+            h ^= (h >> 11);
+            h += (h << 15);
+            return h;
+        }
+    };
+
+    template <>
+    struct hash<std::string> : string_hash
+    {
+    };
+
+    template <>
+    struct hash<std::string_view> : string_hash
+    {
+    };
+
+    template <class K,
+              class V,
+              class Hash = hash<K>,
+              class Eq = std::equal_to<>,
+              class Alloc = std::allocator<std::pair<const K, V>>>
+    class flat_map
+    {
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<const K, V>;
+        using size_type = std::size_t;
+        using hasher = Hash;
+        using key_equal = Eq;
+        using allocator_type = Alloc;
+
+        static_assert(std::is_default_constructible_v<Hash> && std::is_empty_v<Hash>,
+                      "chashmap::flat_map requires a stateless hasher");
+        static_assert(std::is_default_constructible_v<Eq> && std::is_empty_v<Eq>,
+                      "chashmap::flat_map requires a stateless equality");
+
+    private:
+        using node_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<value_type>;
+        using node_traits = std::allocator_traits<node_alloc>;
+
+        template <class T, class = void>
+        struct is_transparent : std::false_type
+        {
+        };
+        template <class T>
+        struct is_transparent<T, std::void_t<typename T::is_transparent>> : std::true_type
+        {
+        };
+
+        // Lookups take K (or anything convertible to it), or any type at all
+        // when both Hash and Eq are transparent.
+        template <class Q>
+        using enable_transparent = std::enable_if_t<
+            std::is_convertible_v<const Q &, const K &> ||
+                (is_transparent<Hash>::value && is_transparent<Eq>::value),
+            int>;
+
+    public:
+        /**
+         * Forward iterator over the elements, in bucket order.
+         */
+        template <bool Const>
+        class basic_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::conditional_t<Const, const flat_map::value_type, flat_map::value_type>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = value_type *;
+            using reference = value_type &;
+
+            basic_iterator() = default;
+
+            reference operator*() const { return *node_of(entry_); }
+            pointer operator->() const { return node_of(entry_); }
+
+            basic_iterator &operator++()
+            {
+                entry_ = entry_->next;
+                skip_empty();
+                return *this;
+            }
+
+            basic_iterator operator++(int)
+            {
+                basic_iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            friend bool operator==(const basic_iterator &a, const basic_iterator &b) { return a.entry_ == b.entry_; }
+            friend bool operator!=(const basic_iterator &a, const basic_iterator &b) { return a.entry_ != b.entry_; }
+
+        private:
+            friend class flat_map;
+
+            basic_iterator(const HashMap *map, std::size_t bucket, HashMapEntry *entry)
+                : map_(map), bucket_(bucket), entry_(entry)
+            {
+                skip_empty();
+            }
+
+            void skip_empty()
+            {
+                while (!entry_ && map_ && ++bucket_ < map_->capacity)
+                    entry_ = map_->buckets[bucket_];
+            }
+
+            const HashMap *map_ = nullptr;
+            std::size_t bucket_ = 0;
+            HashMapEntry *entry_ = nullptr;
+        };
+
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        explicit flat_map(size_type capacity = 0, float load_factor = 0.0f, const Alloc &alloc = Alloc())
+            : alloc_(alloc)
+        {
+            if (hashmap_init(&map_, capacity, &hash_stored, &eq_stored, load_factor) != 0)
+                throw std::bad_alloc();
+        }
+
+        flat_map(const flat_map &) = delete;
+        flat_map &operator=(const flat_map &) = delete;
+
+        flat_map(flat_map &&other) noexcept
+            : map_(other.map_), alloc_(std::move(other.alloc_))
+        {
+            other.map_ = HashMap{};
+        }
+
+        flat_map &operator=(flat_map &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                map_ = other.map_;
+                alloc_ = std::move(other.alloc_);
+                other.map_ = HashMap{};
+            }
+            return *this;
+        }
+
+        ~flat_map() { release(); }
+
+        size_type size() const noexcept { return map_.size; }
+        bool empty() const noexcept { return map_.size == 0; }
+        allocator_type get_allocator() const { return allocator_type(alloc_); }
+
+        iterator begin() noexcept { return first<iterator>(); }
+        iterator end() noexcept { return iterator(); }
+        const_iterator begin() const noexcept { return first<const_iterator>(); }
+        const_iterator end() const noexcept { return const_iterator(); }
+
+        /**
+         * Find an element. Returns a pointer to it, or nullptr if absent.
+         */
+        template <class Q, enable_transparent<Q> = 0>
+        value_type *find(const Q &key) noexcept
+        {
+            HashMapEntry *entry = find_entry(key);
+            return entry ? node_of(entry) : nullptr;
+        }
+
+        template <class Q, enable_transparent<Q> = 0>
+        const value_type *find(const Q &key) const noexcept
+        {
+            HashMapEntry *entry = find_entry(key);
+            return entry ? node_of(entry) : nullptr;
+        }
+
+        template <class Q, enable_transparent<Q> = 0>
+        bool contains(const Q &key) const noexcept
+        {
+            return find_entry(key) != nullptr;
+        }
+
+        /**
+         * Insert a value constructed from `key` and `args` only if `key` is
+         * absent; otherwise nothing is constructed or moved from.
+         *   @return The element for `key` and whether it was inserted.
+         */
+        template <class... Args>
+        std::pair<value_type *, bool> try_emplace(const K &key, Args &&...args)
+        {
+            return insert_absent(key, [&] {
+                return make_node(std::piecewise_construct,
+                                 std::forward_as_tuple(key),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+            });
+        }
+
+        template <class... Args>
+        std::pair<value_type *, bool> try_emplace(K &&key, Args &&...args)
+        {
+            return insert_absent(key, [&] {
+                return make_node(std::piecewise_construct,
+                                 std::forward_as_tuple(std::move(key)),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+            });
+        }
+
+        /**
+         * Construct an element in place from `args`. If its key is already
+         * present, the new element is destroyed and the map is unchanged.
+         *   @return The element for the key and whether it was inserted.
+         */
+        template <class... Args>
+        std::pair<value_type *, bool> emplace(Args &&...args)
+        {
+            ensure_buckets();
+            value_type *node = make_node(std::forward<Args>(args)...);
+            probe<K> p{&node->first};
+            int inserted = 0;
+            if (!hashmap_insert_hashed(&map_, static_cast<std::uint64_t>(Hash{}(node->first)),
+                                       &match_probe<K>, &p, &node, sizeof(node), &inserted))
+            {
+                destroy_node(node);
+                throw std::bad_alloc();
+            }
+            if (!inserted)
+            {
+                destroy_node(node);
+                return {p.node, false};
+            }
+            return {node, true};
+        }
+
+        std::pair<value_type *, bool> insert(const value_type &value) { return emplace(value); }
+        std::pair<value_type *, bool> insert(value_type &&value) { return emplace(std::move(value)); }
+
+        /**
+         * Insert or assign the mapped value for `key`.
+         */
+        template <class M>
+        std::pair<value_type *, bool> insert_or_assign(const K &key, M &&value)
+        {
+            auto result = try_emplace(key, std::forward<M>(value));
+            if (!result.second)
+                result.first->second = std::forward<M>(value);
+            return result;
+        }
+
+        V &operator[](const K &key) { return try_emplace(key).first->second; }
+        V &operator[](K &&key) { return try_emplace(std::move(key)).first->second; }
+
+        /**
+         * Remove the element for `key`.
+         *   @return 1 if removed, 0 if not found.
+         */
+        template <class Q, enable_transparent<Q> = 0>
+        size_type erase(const Q &key)
+        {
+            if (!map_.buckets)
+                return 0;
+            probe<Q> p{&key};
+            if (hashmap_remove_hashed(&map_, static_cast<std::uint64_t>(Hash{}(key)),
+                                      &match_probe<Q>, &p) != 1)
+                return 0;
+            destroy_node(p.node);
+            return 1;
+        }
+
+        /**
+         * Remove all elements.
+         */
+        void clear()
+        {
+            if (!map_.buckets)
+                return;
+            size_type capacity = map_.capacity;
+            float load_factor = map_.load_factor;
+            release();
+            if (hashmap_init(&map_, capacity, &hash_stored, &eq_stored, load_factor) != 0)
+                throw std::bad_alloc();
+        }
+
+    private:
+        template <class Q>
+        struct probe
+        {
+            const Q *key;
+            value_type *node = nullptr; // Set to the matching node
+        };
+
+        static value_type *node_of(const HashMapEntry *entry) noexcept
+        {
+            value_type *node;
+            std::memcpy(&node, hashmap_entry_key(entry), sizeof(node));
+            return node;
+        }
+
+        static value_type *node_at(const void *key_data) noexcept
+        {
+            value_type *node;
+            std::memcpy(&node, key_data, sizeof(node));
+            return node;
+        }
+
+        static std::uint64_t hash_stored(const void *key_data, size_t) noexcept
+        {
+            return static_cast<std::uint64_t>(Hash{}(node_at(key_data)->first));
+        }
+
+        static int eq_stored(const void *key_a, const void *key_b, size_t) noexcept
+        {
+            return Eq{}(node_at(key_a)->first, node_at(key_b)->first) ? 1 : 0;
+        }
+
+        template <class Q>
+        static int match_probe(const void *key_data, size_t, void *ctx) noexcept
+        {
+            probe<Q> *p = static_cast<probe<Q> *>(ctx);
+            value_type *node = node_at(key_data);
+            if (!Eq{}(node->first, *p->key))
+                return 0;
+            p->node = node;
+            return 1;
+        }
+
+        // Matches the entry insert_absent() links before its node exists
+        static int match_vacant(const void *key_data, size_t, void *) noexcept
+        {
+            return node_at(key_data) == nullptr ? 1 : 0;
+        }
+
+        template <class Q>
+        HashMapEntry *find_entry(const Q &key) const noexcept
+        {
+            if (!map_.buckets)
+                return nullptr;
+            probe<Q> p{&key};
+            return hashmap_find_hashed(&map_, static_cast<std::uint64_t>(Hash{}(key)),
+                                       &match_probe<Q>, &p);
+        }
+
+        template <class... Args>
+        value_type *make_node(Args &&...args)
+        {
+            value_type *node = node_traits::allocate(alloc_, 1);
+            try
+            {
+                node_traits::construct(alloc_, node, std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                node_traits::deallocate(alloc_, node, 1);
+                throw;
+            }
+            return node;
+        }
+
+        void destroy_node(value_type *node) noexcept
+        {
+            node_traits::destroy(alloc_, node);
+            node_traits::deallocate(alloc_, node, 1);
+        }
+
+        void ensure_buckets()
+        {
+            // A moved-from map has no buckets until its next insert.
+            if (!map_.buckets && hashmap_init(&map_, 0, &hash_stored, &eq_stored, 0.0f) != 0)
+                throw std::bad_alloc();
+        }
+
+        /**
+         * Find `key`, or link an empty entry for it in the same chain walk and
+         * only then construct its node with `make`, so nothing is built for a
+         * key that is already present.
+         */
+        template <class Make>
+        std::pair<value_type *, bool> insert_absent(const K &key, Make &&make)
+        {
+            ensure_buckets();
+            std::uint64_t hash = static_cast<std::uint64_t>(Hash{}(key));
+            probe<K> p{&key};
+            value_type *vacant = nullptr;
+            int inserted = 0;
+            HashMapEntry *entry = hashmap_insert_hashed(&map_, hash, &match_probe<K>, &p,
+                                                        &vacant, sizeof(vacant), &inserted);
+            if (!entry)
+                throw std::bad_alloc();
+            if (!inserted)
+                return {p.node, false};
+
+            value_type *node;
+            try
+            {
+                node = make();
+            }
+            catch (...)
+            {
+                hashmap_remove_hashed(&map_, hash, &match_vacant, nullptr);
+                throw;
+            }
+            std::memcpy(hashmap_entry_key(entry), &node, sizeof(node));
+            return {node, true};
+        }
+
+        template <class It>
+        It first() const noexcept
+        {
+            if (!map_.buckets || map_.size == 0)
+                return It();
+            return It(&map_, 0, map_.buckets[0]);
+        }
+
+        void release() noexcept
+        {
+            if (!map_.buckets)
+                return;
+            for (value_type &node : *this)
+                destroy_node(&node);
+            hashmap_destroy(&map_);
+        }
+
+        HashMap map_;
+        node_alloc alloc_;
+    };
+} // namespace chashmap
+
+#endif // CHASHMAP_HPP
@@ -0,0 +1,91 @@
+#ifndef CHASHMAP_ANALYZE_H
+#define CHASHMAP_ANALYZE_H
+
+#include <stdio.h>
+#include "chashmap.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * Problems hashmap_analyze_hash() can flag (bits of HashMapHashReport.flags).
+     */
+    enum
+    {
+        HASHMAP_HASH_UNEVEN_BUCKETS = 1 << 0, // Chi-squared far above a random hash
+        HASHMAP_HASH_WEAK_AVALANCHE = 1 << 1, // Input bits that barely affect some output bits
+        HASHMAP_HASH_BIASED_BITS = 1 << 2,    // Output bits that are mostly 0 or mostly 1
+        HASHMAP_HASH_LOW_ENTROPY = 1 << 3,    // Low bits of the bucket index poorly spread
+        HASHMAP_HASH_COLLISIONS = 1 << 4      // More full 64-bit collisions than chance
+    };
+
+    /**
+     * Result of analysing a hash function on a set of distinct keys.
+     */
+    typedef struct
+    {
+        size_t keys;                // Keys analysed
+        size_t capacity;            // Bucket count the index reduction used
+        unsigned index_bits;        // Low hash bits that pick the bucket: ceil(log2(capacity))
+        double chi_squared;         // Of the bucket counts against a uniform spread
+        double chi_squared_z;       // (chi_squared - df) / sqrt(2 df); ~N(0,1) for a good hash
+        size_t max_chain;           // Longest chain the keys would form
+        double mean_chain;          // Mean length of non-empty chains
+        double bit_bias[64];        // Per output bit: fraction of ones - 0.5
+        double worst_bit_bias;      // Largest |bit_bias| among the index bits
+        double avalanche_bias;      // Mean |P(output bit flips) - 0.5| * 2, index bits only
+        double worst_avalanche;     // Largest such value for one (input bit, index bit) pair
+        unsigned worst_input_bit;   // Input bit of worst_avalanche
+        unsigned worst_output_bit;  // Output bit of worst_avalanche
+        unsigned entropy_bits;      // Low index bits measured (up to 8)
+        double low_bit_entropy;     // Shannon entropy of those bits, in bits
+        size_t collisions;          // Keys whose full 64-bit hash repeats an earlier key's
+        double expected_collisions; // For a random 64-bit hash
+        unsigned flags;             // HASHMAP_HASH_* problems found (0 = none)
+    } HashMapHashReport;
+
+    /**
+     * Analyse `hash_func` on sample keys, reducing hashes to bucket indices
+     * the way HashMap does (hash % capacity).
+     *   - Bucket spread: chi-squared of the bucket counts, longest chain.
+     *   - Output bits: bias of each bit over the sample.
+     *   - Avalanche: flipping each input bit of up to 256 keys (first 32
+     *     bytes) and counting, per output bit, how often it changes.
+     * Bias and avalanche are judged on the index bits only; poorly mixed
+     * high bits do not hurt a HashMap (the default hash has some).
+     *   - Low-bit entropy of the bucket index, which is what `%` keeps.
+     *   - Full 64-bit collisions.
+     * Keys must be distinct. Flags are only raised when the sample is large
+     * enough for the measurement to be meaningful.
+     *   @param hash_func  Hash function to test (NULL => the default hash).
+     *   @param keys       Array of `count` key pointers.
+     *   @param key_sizes  Array of `count` key sizes.
+     *   @param capacity   Bucket count to model (0 => what a HashMap holding
+     *                     `count` keys would grow to).
+     *   @param report     Filled in on success.
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmap_analyze_hash(hash_func_t hash_func,
+                             const void *const *keys, const size_t *key_sizes,
+                             size_t count, size_t capacity,
+                             HashMapHashReport *report);
+
+    /**
+     * Run hashmap_analyze_hash() on a map's live keys with its hash function
+     * and capacity.
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmap_analyze_map(const HashMap *map, HashMapHashReport *report);
+
+    /**
+     * Print a human-readable summary of a report to `out`.
+     */
+    void hashmap_print_hash_report(const HashMapHashReport *report, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHASHMAP_ANALYZE_H
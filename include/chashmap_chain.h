@@ -0,0 +1,135 @@
+#ifndef CHASHMAP_CHAIN_H
+#define CHASHMAP_CHAIN_H
+
+/*
+ * The separate-chaining engine shared by HashMap and its variants (HashSet,
+ * HashMultiMap, HashCache, HashTTLMap and CHASHMAP_DEFINE maps): bucket
+ * indexing, the growth rule and relinking on resize. Entry types differ, so
+ * chains are walked through the byte offset of each entry's `next` pointer;
+ * the helpers are inline and callers pass offsetof() constants, so they
+ * compile to the same code as a loop written for one entry type.
+ *
+ * These are building blocks for the library's maps, not a stable API.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "chashmap.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * Hash of the entry at `entry`, for relinking (`ctx` as given to
+     * hashmap_chain_rehash()).
+     */
+    typedef uint64_t (*hashmap_chain_hash_t)(const void *entry, const void *ctx);
+
+    /**
+     * Bucket of `hash` in a table of `capacity` buckets.
+     */
+    static inline size_t hashmap_chain_index(uint64_t hash, size_t capacity)
+    {
+        return (size_t)(hash % capacity);
+    }
+
+    /**
+     * Non-zero once size / capacity has reached the load factor; the next
+     * insert of a new key doubles the table first.
+     */
+    static inline int hashmap_chain_full(size_t size, size_t capacity, float load_factor)
+    {
+        return (float)size / (float)capacity >= load_factor;
+    }
+
+    /**
+     * Replace a capacity of 0 or a load factor <= 0 by the defaults.
+     */
+    static inline void hashmap_chain_defaults(size_t *capacity, float *load_factor)
+    {
+        if (*capacity == 0)
+            *capacity = HASHMAP_DEFAULT_CAPACITY;
+        if (*load_factor <= 0.0f)
+            *load_factor = HASHMAP_DEFAULT_LOAD_FACTOR;
+    }
+
+    /**
+     * The `next` pointer of `entry`, found at `next_offset` bytes.
+     */
+    static inline void **hashmap_chain_next(void *entry, size_t next_offset)
+    {
+        return (void **)((char *)entry + next_offset);
+    }
+
+    /**
+     * Move every entry of `buckets` (`capacity` chains) onto the heads of
+     * `new_buckets` (`new_capacity` chains), walking the old chains in
+     * bucket order.
+     */
+    static inline void hashmap_chain_relink(void **buckets, size_t capacity,
+                                            void **new_buckets, size_t new_capacity,
+                                            size_t next_offset,
+                                            hashmap_chain_hash_t hash, const void *ctx)
+    {
+        for (size_t i = 0; i < capacity; i++)
+        {
+            void *entry = buckets[i];
+            while (entry)
+            {
+                void **next = hashmap_chain_next(entry, next_offset);
+                void *following = *next;
+                size_t index = hashmap_chain_index(hash(entry, ctx), new_capacity);
+                *next = new_buckets[index];
+                new_buckets[index] = entry;
+                entry = following;
+            }
+        }
+    }
+
+    /**
+     * Rehash a bucket array into `new_capacity` buckets.
+     *   @return The new bucket array (the old one is freed), or NULL on
+     *           allocation failure (the old one is left as it was).
+     */
+    static inline void **hashmap_chain_rehash(void **buckets, size_t capacity, size_t new_capacity,
+                                              size_t next_offset,
+                                              hashmap_chain_hash_t hash, const void *ctx)
+    {
+        if (new_capacity < 1)
+            return NULL;
+        void **new_buckets = (void **)calloc(new_capacity, sizeof(void *));
+        if (!new_buckets)
+            return NULL;
+        hashmap_chain_relink(buckets, capacity, new_buckets, new_capacity, next_offset, hash, ctx);
+        free(buckets);
+        return new_buckets;
+    }
+
+    /**
+     * Call `free_entry(entry, ctx)` on every entry and clear the buckets.
+     */
+    static inline void hashmap_chain_clear(void **buckets, size_t capacity, size_t next_offset,
+                                           void (*free_entry)(void *entry, void *ctx), void *ctx)
+    {
+        for (size_t i = 0; i < capacity; i++)
+        {
+            void *entry = buckets[i];
+            while (entry)
+            {
+                void *next = *hashmap_chain_next(entry, next_offset);
+                free_entry(entry, ctx);
+                entry = next;
+            }
+            buckets[i] = NULL;
+        }
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHASHMAP_CHAIN_H
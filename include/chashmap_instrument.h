@@ -0,0 +1,95 @@
+#ifndef CHASHMAP_INSTRUMENT_H
+#define CHASHMAP_INSTRUMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Per-operation counters for hashmap_get(), hashmap_insert() and
+ * hashmap_remove(). They are only collected when the library is compiled
+ * with -DCHASHMAP_INSTRUMENT; otherwise the hooks compile to nothing and
+ * hashmap_counters_read() reports that instrumentation is unavailable.
+ *
+ * Each thread counts into its own block, so instrumented operations never
+ * contend. One in CHASHMAP_INSTRUMENT_SAMPLE operations (per thread) is
+ * timed with the CPU timestamp counter and recorded in a log-linear
+ * histogram: exact below 16 ticks, then 8 slots per power of two.
+ */
+
+/**
+ * Time one in this many operations per thread (a power of two).
+ */
+#ifndef CHASHMAP_INSTRUMENT_SAMPLE
+#define CHASHMAP_INSTRUMENT_SAMPLE 64
+#endif
+
+/**
+ * Slots in the latency histogram: 16 exact values, then 8 per power of two up to 2^64.
+ */
+#define HASHMAP_LATENCY_SLOTS (16 + 60 * 8)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        HASHMAP_OP_GET,
+        HASHMAP_OP_INSERT,
+        HASHMAP_OP_REMOVE,
+        HASHMAP_OP_COUNT
+    } HashMapOp;
+
+    /**
+     * Totals for one kind of operation.
+     *   - hits: get found the key, insert updated an existing key, remove removed one.
+     *   - probes: chain entries examined.
+     *   - allocs: heap allocations made (entries, out-of-line keys and values,
+     *     copies returned by hashmap_get()).
+     */
+    typedef struct
+    {
+        uint64_t calls;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t probes;
+        uint64_t allocs;
+        uint64_t samples;                          // Operations timed
+        uint64_t latency[HASHMAP_LATENCY_SLOTS];   // Timed operations per tick range
+    } HashMapOpCounters;
+
+    typedef struct
+    {
+        HashMapOpCounters ops[HASHMAP_OP_COUNT];
+        double ticks_per_ns; // Timestamp-counter ticks per nanosecond
+    } HashMapCounters;
+
+    /**
+     * Sum the counters of every thread, live or exited.
+     *   @return 0 on success, non-zero if the library was built without
+     *           CHASHMAP_INSTRUMENT (or `out` is NULL).
+     */
+    int hashmap_counters_read(HashMapCounters *out);
+
+    /**
+     * Zero all counters.
+     */
+    void hashmap_counters_reset(void);
+
+    /**
+     * Smallest tick count recorded in latency histogram slot `slot`.
+     */
+    uint64_t hashmap_latency_slot_value(size_t slot);
+
+    /**
+     * Approximate percentile (0-100) of the sampled latencies, in ticks:
+     * the lower bound of the slot that holds it.
+     */
+    uint64_t hashmap_counters_percentile(const HashMapOpCounters *ops, double percentile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHASHMAP_INSTRUMENT_H
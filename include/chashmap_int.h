@@ -0,0 +1,124 @@
+#ifndef CHASHMAP_INT_H
+#define CHASHMAP_INT_H
+
+#include "chashmap.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Multiplier for Fibonacci hashing (2^64 / golden ratio).
+ */
+#define HASHMAP_INT_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+    /**
+     * An entry of a HashMapU64. The key lives in the entry itself;
+     * the value uses the same inline/heap storage as HashMapEntry.
+     */
+    typedef struct HashMapU64Entry
+    {
+        uint64_t key;
+        HashMapData value;
+        size_t value_size;
+        struct HashMapU64Entry *next;
+    } HashMapU64Entry;
+
+    /**
+     * A separate-chaining map specialized for uint64_t keys.
+     * The capacity is always a power of two and the bucket index is taken
+     * from the top bits of `key * HASHMAP_INT_MULTIPLIER`, so lookups do no
+     * division and make no indirect calls.
+     */
+    typedef struct
+    {
+        HashMapU64Entry **buckets; // Array of pointers to entries
+        size_t capacity;           // Number of buckets (power of two)
+        size_t size;               // Number of key-value pairs stored
+        unsigned shift;            // 64 - log2(capacity)
+        float load_factor;         // Max load factor before resizing
+    } HashMapU64;
+
+    /**
+     * Same as HashMapU64Entry, for uint32_t keys.
+     */
+    typedef struct HashMapU32Entry
+    {
+        uint32_t key;
+        HashMapData value;
+        size_t value_size;
+        struct HashMapU32Entry *next;
+    } HashMapU32Entry;
+
+    /**
+     * Same as HashMapU64, for uint32_t keys.
+     */
+    typedef struct
+    {
+        HashMapU32Entry **buckets;
+        size_t capacity;
+        size_t size;
+        unsigned shift;
+        float load_factor;
+    } HashMapU32;
+
+    /**
+     * Initialize a new HashMapU64.
+     *   @param map          Pointer to a HashMapU64 to initialize.
+     *   @param capacity     Initial capacity, rounded up to a power of two (0 => default).
+     *   @param load_factor  Max load factor before resizing (<= 0 => default).
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmap_u64_init(HashMapU64 *map, size_t capacity, float load_factor);
+
+    /**
+     * Free all resources used by the HashMapU64.
+     */
+    void hashmap_u64_destroy(HashMapU64 *map);
+
+    /**
+     * Insert or update a key-value pair.
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmap_u64_insert(HashMapU64 *map, uint64_t key,
+                           const void *val_data, size_t val_size);
+
+    /**
+     * Retrieve a copy of the value associated with a key.
+     *   @param out_val    Will be allocated and filled if found. Caller must free.
+     *   @param out_size   Size of the returned value in bytes.
+     *   @return 1 if found, 0 if not found, < 0 on error.
+     */
+    int hashmap_u64_get(const HashMapU64 *map, uint64_t key,
+                        void **out_val, size_t *out_size);
+
+    /**
+     * Look up a key without copying its value.
+     *   @param out_size   If non-NULL, receives the size of the value.
+     *   @return Pointer to the stored value bytes, or NULL if not found.
+     *           Valid until the key is updated or removed, or the map destroyed.
+     */
+    void *hashmap_u64_find(const HashMapU64 *map, uint64_t key, size_t *out_size);
+
+    /**
+     * Remove a key-value pair from the map.
+     *   @return 1 if removed, 0 if not found, < 0 on error.
+     */
+    int hashmap_u64_remove(HashMapU64 *map, uint64_t key);
+
+    /* uint32_t-keyed counterparts; same semantics as the functions above. */
+    int hashmap_u32_init(HashMapU32 *map, size_t capacity, float load_factor);
+    void hashmap_u32_destroy(HashMapU32 *map);
+    int hashmap_u32_insert(HashMapU32 *map, uint32_t key,
+                           const void *val_data, size_t val_size);
+    int hashmap_u32_get(const HashMapU32 *map, uint32_t key,
+                        void **out_val, size_t *out_size);
+    void *hashmap_u32_find(const HashMapU32 *map, uint32_t key, size_t *out_size);
+    int hashmap_u32_remove(HashMapU32 *map, uint32_t key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHASHMAP_INT_H
@@ -0,0 +1,218 @@
+#ifndef CHASHMAP_TYPED_H
+#define CHASHMAP_TYPED_H
+
+/*
+ * Header-only, type-safe map instantiations.
+ *
+ *   CHASHMAP_DEFINE(name, KeyT, ValT, hash_fn, eq_fn)
+ *
+ * expands to a map type `name` with static inline operations:
+ *
+ *   int   name_init(name *map, size_t capacity, float load_factor);
+ *   void  name_destroy(name *map);
+ *   int   name_insert(name *map, KeyT key, ValT value);   // 0 on success
+ *   ValT *name_get(const name *map, KeyT key);            // NULL if not found
+ *   int   name_remove(name *map, KeyT key);               // 1 removed, 0 not found
+ *   void  name_iter_init(name_iter *it, const name *map);
+ *   int   name_iter_next(name_iter *it, KeyT *key, ValT **value); // 0 when done
+ *
+ * `hash_fn` must be callable as `uint64_t hash_fn(KeyT)` and `eq_fn` as
+ * `int eq_fn(KeyT, KeyT)` (functions or function-like macros). Both are
+ * called directly, so the compiler can inline them.
+ *
+ * The operations are typed wrappers around HashMap's chaining engine
+ * (chashmap_chain.h): the same `hash % capacity` indexing, growth rule and
+ * resize relink, with new entries at the head of the chain. Keys and values
+ * are stored by value inside the entry, so each entry is a single allocation.
+ *
+ * Keys are copied as KeyT values only: for a pointer key such as
+ * `const char *` the map stores the pointer and borrows what it points to.
+ * The caller owns those bytes and must keep them alive and unchanged until
+ * the key is removed or the map destroyed.
+ *
+ * The map must not be modified while iterating over it.
+ */
+
+#include "chashmap.h"
+#include "chashmap_chain.h"
+
+/**
+ * Mix an integer key into a 64-bit hash (multiply + xor-shift).
+ */
+static inline uint64_t chashmap_hash_u64(uint64_t key)
+{
+    uint64_t hash = key * 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 32);
+}
+
+/**
+ * Hash a NUL-terminated string key with the default HashMap hash. The map
+ * stores only the pointer (see above).
+ */
+static inline uint64_t chashmap_hash_str(const char *key)
+{
+    return hashmap_hash_bytes(key, strlen(key));
+}
+
+/**
+ * Equality for NUL-terminated string keys.
+ */
+static inline int chashmap_eq_str(const char *a, const char *b)
+{
+    return strcmp(a, b) == 0;
+}
+
+/**
+ * Equality for integer (or any `==`-comparable) keys.
+ */
+#define CHASHMAP_EQ_INT(a, b) ((a) == (b))
+
+#define CHASHMAP_DEFINE(name, KeyT, ValT, hash_fn, eq_fn)                                         \
+    typedef struct name##_entry                                                                   \
+    {                                                                                             \
+        KeyT key;                                                                                 \
+        ValT value;                                                                               \
+        struct name##_entry *next;                                                                \
+    } name##_entry;                                                                               \
+                                                                                                  \
+    typedef struct                                                                                \
+    {                                                                                             \
+        name##_entry **buckets;                                                                   \
+        size_t capacity;                                                                          \
+        size_t size;                                                                              \
+        float load_factor;                                                                        \
+    } name;                                                                                       \
+                                                                                                  \
+    typedef struct                                                                                \
+    {                                                                                             \
+        const name *map;                                                                          \
+        size_t bucket;                                                                            \
+        name##_entry *entry;                                                                      \
+    } name##_iter;                                                                                \
+                                                                                                  \
+    static inline uint64_t name##_entry_hash(const void *entry, const void *ctx)                  \
+    {                                                                                             \
+        (void)ctx;                                                                                \
+        return (uint64_t)hash_fn(((const name##_entry *)entry)->key);                             \
+    }                                                                                             \
+                                                                                                  \
+    static inline void name##_free_entry(void *entry, void *ctx)                                  \
+    {                                                                                             \
+        (void)ctx;                                                                                \
+        free(entry);                                                                              \
+    }                                                                                             \
+                                                                                                  \
+    static inline name##_entry **name##_find_link(const name *map, size_t index, KeyT key)        \
+    {                                                                                             \
+        name##_entry **link = &map->buckets[index];                                               \
+        while (*link && !eq_fn((*link)->key, key))                                                \
+            link = &(*link)->next;                                                                \
+        return link;                                                                              \
+    }                                                                                             \
+                                                                                                  \
+    static inline int name##_init(name *map, size_t capacity, float load_factor)                  \
+    {                                                                                             \
+        if (!map)                                                                                 \
+            return -1;                                                                            \
+        hashmap_chain_defaults(&capacity, &load_factor);                                          \
+        map->capacity = capacity;                                                                 \
+        map->load_factor = load_factor;                                                           \
+        map->size = 0;                                                                            \
+        map->buckets = (name##_entry **)calloc(map->capacity, sizeof(name##_entry *));            \
+        return map->buckets ? 0 : -1;                                                             \
+    }                                                                                             \
+                                                                                                  \
+    static inline void name##_destroy(name *map)                                                  \
+    {                                                                                             \
+        if (!map || !map->buckets)                                                                \
+            return;                                                                               \
+        hashmap_chain_clear((void **)map->buckets, map->capacity, offsetof(name##_entry, next),   \
+                            name##_free_entry, NULL);                                             \
+        free(map->buckets);                                                                       \
+        map->buckets = NULL;                                                                      \
+        map->capacity = 0;                                                                        \
+        map->size = 0;                                                                            \
+    }                                                                                             \
+                                                                                                  \
+    static inline int name##_resize(name *map, size_t new_capacity)                               \
+    {                                                                                             \
+        name##_entry **buckets = (name##_entry **)hashmap_chain_rehash(                           \
+            (void **)map->buckets, map->capacity, new_capacity, offsetof(name##_entry, next),     \
+            name##_entry_hash, NULL);                                                             \
+        if (!buckets)                                                                             \
+            return -1;                                                                            \
+        map->buckets = buckets;                                                                   \
+        map->capacity = new_capacity;                                                             \
+        return 0;                                                                                 \
+    }                                                                                             \
+                                                                                                  \
+    static inline ValT *name##_get(const name *map, KeyT key)                                     \
+    {                                                                                             \
+        size_t index = hashmap_chain_index(hash_fn(key), map->capacity);                          \
+        name##_entry *entry = *name##_find_link(map, index, key);                                 \
+        return entry ? &entry->value : NULL;                                                      \
+    }                                                                                             \
+                                                                                                  \
+    static inline int name##_insert(name *map, KeyT key, ValT value)                              \
+    {                                                                                             \
+        if (hashmap_chain_full(map->size, map->capacity, map->load_factor))                       \
+        {                                                                                         \
+            if (name##_resize(map, map->capacity * 2) != 0)                                       \
+                fprintf(stderr, "Warning: hashmap resizing failed.\n");                           \
+        }                                                                                         \
+                                                                                                  \
+        size_t index = hashmap_chain_index(hash_fn(key), map->capacity);                          \
+        name##_entry *entry = *name##_find_link(map, index, key);                                 \
+        if (entry)                                                                                \
+        {                                                                                         \
+            entry->value = value;                                                                 \
+            return 0;                                                                             \
+        }                                                                                         \
+                                                                                                  \
+        name##_entry *new_entry = (name##_entry *)malloc(sizeof(name##_entry));                   \
+        if (!new_entry)                                                                           \
+            return -1;                                                                            \
+        new_entry->key = key;                                                                     \
+        new_entry->value = value;                                                                 \
+        new_entry->next = map->buckets[index];                                                    \
+        map->buckets[index] = new_entry;                                                          \
+        map->size++;                                                                              \
+        return 0;                                                                                 \
+    }                                                                                             \
+                                                                                                  \
+    static inline int name##_remove(name *map, KeyT key)                                          \
+    {                                                                                             \
+        size_t index = hashmap_chain_index(hash_fn(key), map->capacity);                          \
+        name##_entry **link = name##_find_link(map, index, key);                                  \
+        name##_entry *entry = *link;                                                              \
+        if (!entry)                                                                               \
+            return 0;                                                                             \
+        *link = entry->next;                                                                      \
+        free(entry);                                                                              \
+        map->size--;                                                                              \
+        return 1;                                                                                 \
+    }                                                                                             \
+                                                                                                  \
+    static inline void name##_iter_init(name##_iter *it, const name *map)                         \
+    {                                                                                             \
+        it->map = map;                                                                            \
+        it->bucket = 0;                                                                           \
+        it->entry = NULL;                                                                         \
+    }                                                                                             \
+                                                                                                  \
+    static inline int name##_iter_next(name##_iter *it, KeyT *key, ValT **value)                  \
+    {                                                                                             \
+        if (it->entry)                                                                            \
+            it->entry = it->entry->next;                                                          \
+        while (!it->entry && it->bucket < it->map->capacity)                                      \
+            it->entry = it->map->buckets[it->bucket++];                                           \
+        if (!it->entry)                                                                           \
+            return 0;                                                                             \
+        if (key)                                                                                  \
+            *key = it->entry->key;                                                                \
+        if (value)                                                                                \
+            *value = &it->entry->value;                                                           \
+        return 1;                                                                                 \
+    }
+
+#endif // CHASHMAP_TYPED_H
@@ -0,0 +1,103 @@
+#ifndef CHASHMULTIMAP_H
+#define CHASHMULTIMAP_H
+
+#include "chashmap.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * One value stored under a key. Values of a key form a singly linked
+     * list in insertion order; the bytes follow the node in one allocation.
+     */
+    typedef struct HashMultiMapValue
+    {
+        struct HashMultiMapValue *next;
+        size_t size;
+        unsigned char data[];
+    } HashMultiMapValue;
+
+    /**
+     * An entry in the multimap’s separate chaining list: one key and its values.
+     */
+    typedef struct HashMultiMapEntry
+    {
+        HashMapData key;
+        size_t key_size;
+        HashMultiMapValue *head;      // First value (oldest)
+        HashMultiMapValue *tail;      // Last value, for O(1) append
+        size_t count;                 // Number of values under this key
+        struct HashMultiMapEntry *next;
+    } HashMultiMapEntry;
+
+    /**
+     * A map from keys to lists of values, using the same chaining, hashing
+     * and resizing as HashMap (the load factor counts distinct keys).
+     */
+    typedef struct
+    {
+        HashMultiMapEntry **buckets; // Array of pointers to entries
+        size_t capacity;             // Number of buckets
+        size_t keys;                 // Number of distinct keys
+        size_t size;                 // Total number of values
+        hash_func_t hash_func;       // Hash function
+        eq_func_t eq_func;           // Equality function
+        float load_factor;           // Max load factor before resizing
+    } HashMultiMap;
+
+    /**
+     * Initialize a new HashMultiMap. Parameters are the same as hashmap_init().
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmultimap_init(HashMultiMap *map,
+                          size_t capacity,
+                          hash_func_t hash_func,
+                          eq_func_t eq_func,
+                          float load_factor);
+
+    /**
+     * Free all resources used by the HashMultiMap.
+     */
+    void hashmultimap_destroy(HashMultiMap *map);
+
+    /**
+     * Append a value to the list of `key`, creating the key if needed.
+     * Existing values are never copied or moved.
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashmultimap_insert(HashMultiMap *map,
+                            const void *key_data, size_t key_size,
+                            const void *val_data, size_t val_size);
+
+    /**
+     * Get all values of a key without copying them.
+     *   @param out_count  If non-NULL, receives the number of values.
+     *   @return The first value (follow `next` for the rest), or NULL if the
+     *           key is absent. Valid until the key is modified or removed.
+     */
+    const HashMultiMapValue *hashmultimap_get_all(const HashMultiMap *map,
+                                                  const void *key_data, size_t key_size,
+                                                  size_t *out_count);
+
+    /**
+     * Remove the first value of `key` whose bytes equal `val_data`.
+     * The key is removed when its last value goes.
+     *   @return 1 if removed, 0 if not found, < 0 on error.
+     */
+    int hashmultimap_remove_one(HashMultiMap *map,
+                                const void *key_data, size_t key_size,
+                                const void *val_data, size_t val_size);
+
+    /**
+     * Remove a key and all of its values.
+     *   @return The number of values removed (0 if not found), < 0 on error.
+     */
+    long hashmultimap_remove_all(HashMultiMap *map, const void *key_data, size_t key_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHASHMULTIMAP_H
@@ -0,0 +1,113 @@
+#ifndef CHASHSET_H
+#define CHASHSET_H
+
+#include "chashmap.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * An entry in the hash set’s separate chaining list. Only the key is
+     * stored; keys up to HASHMAP_INLINE_SIZE bytes live in the entry itself.
+     */
+    typedef struct HashSetEntry
+    {
+        HashMapData key;
+        size_t key_size;
+        struct HashSetEntry *next;
+    } HashSetEntry;
+
+    /**
+     * A set of keys, using the same chaining, hashing and resizing as HashMap.
+     */
+    typedef struct
+    {
+        HashSetEntry **buckets; // Array of pointers to entries
+        size_t capacity;        // Number of buckets
+        size_t size;            // Number of keys stored
+        hash_func_t hash_func;  // Hash function
+        eq_func_t eq_func;      // Equality function
+        float load_factor;      // Max load factor before resizing
+    } HashSet;
+
+    /**
+     * Iterator over a HashSet. The set must not be modified while iterating.
+     */
+    typedef struct
+    {
+        const HashSet *set;
+        size_t bucket;
+        const HashSetEntry *entry;
+    } HashSetIter;
+
+    /**
+     * Initialize a new HashSet. Parameters are the same as hashmap_init().
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashset_init(HashSet *set,
+                     size_t capacity,
+                     hash_func_t hash_func,
+                     eq_func_t eq_func,
+                     float load_factor);
+
+    /**
+     * Free all resources used by the HashSet.
+     */
+    void hashset_destroy(HashSet *set);
+
+    /**
+     * Add a key to the set (the set stores its own copy).
+     *   @return 1 if inserted, 0 if already present, < 0 on error.
+     */
+    int hashset_insert(HashSet *set, const void *key_data, size_t key_size);
+
+    /**
+     * Test whether a key is in the set.
+     *   @return 1 if present, 0 if not, < 0 on error.
+     */
+    int hashset_contains(const HashSet *set, const void *key_data, size_t key_size);
+
+    /**
+     * Remove a key from the set.
+     *   @return 1 if removed, 0 if not found, < 0 on error.
+     */
+    int hashset_remove(HashSet *set, const void *key_data, size_t key_size);
+
+    /**
+     * Add every key of `src` to `dst` (dst = dst ∪ src).
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashset_union(HashSet *dst, const HashSet *src);
+
+    /**
+     * Keep only the keys of `dst` that are also in `src` (dst = dst ∩ src).
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashset_intersect(HashSet *dst, const HashSet *src);
+
+    /**
+     * Remove from `dst` every key that is in `src` (dst = dst \ src).
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashset_difference(HashSet *dst, const HashSet *src);
+
+    /**
+     * Start iterating over `set`.
+     */
+    void hashset_iter_init(HashSetIter *it, const HashSet *set);
+
+    /**
+     * Advance the iterator.
+     *   @param key_data   Receives a pointer to the stored key bytes.
+     *   @param key_size   Receives the key size.
+     *   @return 1 if a key was produced, 0 when iteration is done.
+     */
+    int hashset_iter_next(HashSetIter *it, const void **key_data, size_t *key_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHASHSET_H
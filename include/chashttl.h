@@ -0,0 +1,158 @@
+#ifndef CHASHTTL_H
+#define CHASHTTL_H
+
+#include "chashmap.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Timing wheel geometry: HASHTTL_WHEEL_LEVELS levels of HASHTTL_WHEEL_SLOTS
+ * slots; level L slots each cover HASHTTL_WHEEL_SLOTS^L ticks.
+ */
+#define HASHTTL_WHEEL_BITS 6
+#define HASHTTL_WHEEL_SLOTS (1 << HASHTTL_WHEEL_BITS)
+#define HASHTTL_WHEEL_LEVELS 4
+
+    /**
+     * A clock returning the current time in milliseconds (any fixed origin).
+     */
+    typedef uint64_t (*clock_func_t)(void *ctx);
+
+    /**
+     * Called for each entry removed because its deadline passed. The key and
+     * value bytes are only valid during the call.
+     */
+    typedef void (*expire_func_t)(const void *key_data, size_t key_size,
+                                  const void *val_data, size_t val_size,
+                                  void *ctx);
+
+    /**
+     * An entry of a HashTTLMap: a HashMapEntry plus its deadline and intrusive
+     * links into the timing wheel.
+     */
+    typedef struct HashTTLEntry
+    {
+        HashMapData key;
+        HashMapData value;
+        size_t key_size;
+        size_t value_size;
+        struct HashTTLEntry *next;         // Chain link
+        uint64_t deadline;                 // Expiry time in ms (0 = never)
+        struct HashTTLEntry *wheel_next;   // Next entry in the same wheel slot
+        struct HashTTLEntry **wheel_pprev; // Link pointing at this entry (NULL if not in the wheel)
+    } HashTTLEntry;
+
+    /**
+     * A map whose entries may carry a time-to-live. Expired entries are
+     * dropped lazily when accessed, and a hierarchical timing wheel drops the
+     * rest in O(1) amortized per tick, without scanning the buckets.
+     */
+    typedef struct
+    {
+        HashTTLEntry **buckets;     // Array of pointers to entries
+        size_t capacity;            // Number of buckets
+        size_t size;                // Number of key-value pairs stored
+        hash_func_t hash_func;      // Hash function
+        eq_func_t eq_func;          // Equality function
+        float load_factor;          // Max load factor before resizing
+        uint64_t tick_ms;           // Wheel resolution in ms
+        uint64_t wheel_tick;        // Last tick the wheel has processed
+        size_t wheel_count;         // Entries currently in the wheel
+        HashTTLEntry *wheel[HASHTTL_WHEEL_LEVELS][HASHTTL_WHEEL_SLOTS];
+        clock_func_t clock_func;    // Time source
+        void *clock_ctx;            // Passed to clock_func
+        expire_func_t expire_func;  // Optional expiry callback
+        void *expire_ctx;           // Passed to expire_func
+    } HashTTLMap;
+
+    /**
+     * Initialize a new HashTTLMap.
+     *   @param map        Pointer to a HashTTLMap to initialize.
+     *   @param capacity   Initial capacity (0 => default).
+     *   @param hash_func  Hash function (NULL => default).
+     *   @param eq_func    Equality function (NULL => default).
+     *   @param load_factor Max load factor before resizing (<= 0 => default).
+     *   @param tick_ms    Wheel resolution in milliseconds (0 => 10 ms).
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashttl_init(HashTTLMap *map,
+                     size_t capacity,
+                     hash_func_t hash_func,
+                     eq_func_t eq_func,
+                     float load_factor,
+                     uint64_t tick_ms);
+
+    /**
+     * Free all resources used by the HashTTLMap. The expiry callback is not called.
+     */
+    void hashttl_destroy(HashTTLMap *map);
+
+    /**
+     * Replace the time source (default: CLOCK_MONOTONIC). Call before inserting.
+     */
+    void hashttl_set_clock(HashTTLMap *map, clock_func_t clock_func, void *ctx);
+
+    /**
+     * Set the callback invoked for every expired entry (NULL to disable).
+     */
+    void hashttl_set_expire_callback(HashTTLMap *map, expire_func_t expire_func, void *ctx);
+
+    /**
+     * Insert or update a key-value pair that expires `ttl_ms` from now
+     * (0 = never). Also advances the timing wheel, like hashttl_tick().
+     *   @return 0 on success, non-zero on error.
+     */
+    int hashttl_insert(HashTTLMap *map,
+                       const void *key_data, size_t key_size,
+                       const void *val_data, size_t val_size,
+                       uint64_t ttl_ms);
+
+    /**
+     * Retrieve a copy of a live value. An expired entry is removed instead.
+     *   @param out_val    Will be allocated and filled if found. Caller must free.
+     *   @param out_size   Size of the returned value in bytes.
+     *   @return 1 if found, 0 if not found or expired, < 0 on error.
+     */
+    int hashttl_get(HashTTLMap *map,
+                    const void *key_data, size_t key_size,
+                    void **out_val, size_t *out_size);
+
+    /**
+     * Look up a live value without copying it. An expired entry is removed instead.
+     *   @param out_size   If non-NULL, receives the size of the value.
+     *   @return Pointer to the stored value bytes, or NULL if not found or expired.
+     *           Valid until the next insert, remove or tick on the map.
+     */
+    void *hashttl_find(HashTTLMap *map,
+                       const void *key_data, size_t key_size,
+                       size_t *out_size);
+
+    /**
+     * Give a live entry a new time-to-live (0 = never expires).
+     *   @return 1 if updated, 0 if not found or expired, < 0 on error.
+     */
+    int hashttl_set_ttl(HashTTLMap *map,
+                        const void *key_data, size_t key_size,
+                        uint64_t ttl_ms);
+
+    /**
+     * Remove a key-value pair (the expiry callback is not called).
+     *   @return 1 if removed, 0 if not found, < 0 on error.
+     */
+    int hashttl_remove(HashTTLMap *map, const void *key_data, size_t key_size);
+
+    /**
+     * Advance the timing wheel to the current time, removing every entry
+     * whose deadline has passed. Call periodically (e.g. every tick_ms).
+     *   @return The number of entries expired.
+     */
+    size_t hashttl_tick(HashTTLMap *map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHASHTTL_H
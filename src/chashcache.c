@@ -0,0 +1,710 @@
+#include "../include/chashcache.h"
+#include "chashmap_internal.h"
+
+/*
+ * Queue roles per policy:
+ *   LRU, CLOCK:  QUEUE_MAIN only.
+ *   S3-FIFO:     QUEUE_SMALL (new entries), QUEUE_MAIN.
+ *   W-TinyLFU:   QUEUE_SMALL (window), QUEUE_MAIN (probation), QUEUE_PROTECTED.
+ */
+#define QUEUE_MAIN 0
+#define QUEUE_SMALL 1
+#define QUEUE_PROTECTED 2
+
+#define S3FIFO_SMALL_PERCENT 10   // Share of the limits given to the small queue
+#define S3FIFO_MAX_FREQ 3
+#define TINYLFU_WINDOW_PERCENT 1  // Share of the limits given to the window
+#define TINYLFU_PROTECTED_PERCENT 80
+#define TINYLFU_MAX_COUNT 15      // Saturation of the sketch counters
+#define TINYLFU_SAMPLE_FACTOR 10  // Age the sketch every width * factor adds
+#define CACHE_MIN_TRACKED 64      // Minimum ghost / sketch size
+#define CACHE_BYTES_PER_ENTRY 64  // Entry estimate when only max_bytes is set
+
+/*
+ * The chains run on the shared chaining engine (chashmap_chain.h).
+ */
+
+static const HashChainLayout hashcache_layout = HASH_CHAIN_LAYOUT(HashCacheEntry);
+
+static inline void *hashcache_entry_key(const HashCacheEntry *entry)
+{
+    return hashmap_data_bytes(&entry->key, entry->key_size);
+}
+
+static inline void *hashcache_entry_value(const HashCacheEntry *entry)
+{
+    return hashmap_data_bytes(&entry->value, entry->value_size);
+}
+
+/**
+ * hashmap_chain_hash_t of an entry: the hash stored when it was inserted.
+ */
+static uint64_t hashcache_entry_hash(const void *entry, const void *cache)
+{
+    (void)cache;
+    return ((const HashCacheEntry *)entry)->hash;
+}
+
+/**
+ * Helper to free an entry (and all memory it owns).
+ */
+static void hashcache_free_entry(void *entry, void *ctx)
+{
+    HashCacheEntry *e = (HashCacheEntry *)entry;
+    (void)ctx;
+    hashmap_data_release(&e->key, e->key_size);
+    hashmap_data_release(&e->value, e->value_size);
+    free(e);
+}
+
+/**
+ * Find the chain link pointing at the entry for a key (or at the chain's NULL end).
+ */
+static HashCacheEntry **hashcache_find_link(const HashCache *cache, uint64_t hash,
+                                            const void *key_data, size_t key_size)
+{
+    return (HashCacheEntry **)hashmap_chain_find_link((void **)cache->buckets,
+                                                      hashmap_chain_index(hash, cache->capacity),
+                                                      hashcache_layout, cache->eq_func,
+                                                      key_data, key_size);
+}
+
+/**
+ * Resize (rehash) the cache to a new capacity. Queue links are unaffected.
+ */
+static int hashcache_resize(HashCache *cache, size_t new_capacity)
+{
+    HashCacheEntry **buckets = (HashCacheEntry **)hashmap_chain_rehash(
+        (void **)cache->buckets, cache->capacity, new_capacity, hashcache_layout.next,
+        hashcache_entry_hash, cache);
+    if (!buckets)
+        return -1;
+    cache->buckets = buckets;
+    cache->capacity = new_capacity;
+    return 0;
+}
+
+static size_t hashcache_round_pow2(size_t n)
+{
+    size_t size = 1;
+    while (size < n)
+        size <<= 1;
+    return size;
+}
+
+/*
+ * Queues: newest entry at the head, eviction candidates at the tail.
+ */
+
+static void hashcache_list_unlink(HashCache *cache, HashCacheEntry *entry)
+{
+    HashCacheList *list = &cache->queues[entry->queue];
+    if (entry->list_prev)
+        entry->list_prev->list_next = entry->list_next;
+    else
+        list->head = entry->list_next;
+    if (entry->list_next)
+        entry->list_next->list_prev = entry->list_prev;
+    else
+        list->tail = entry->list_prev;
+    entry->list_prev = NULL;
+    entry->list_next = NULL;
+    list->count--;
+    list->bytes -= entry->key_size + entry->value_size;
+}
+
+static void hashcache_list_push_front(HashCache *cache, HashCacheEntry *entry, unsigned char queue)
+{
+    HashCacheList *list = &cache->queues[queue];
+    entry->queue = queue;
+    entry->list_prev = NULL;
+    entry->list_next = list->head;
+    if (list->head)
+        list->head->list_prev = entry;
+    else
+        list->tail = entry;
+    list->head = entry;
+    list->count++;
+    list->bytes += entry->key_size + entry->value_size;
+}
+
+/**
+ * Move an entry to the head of `queue` (possibly the one it is already in).
+ */
+static void hashcache_list_move_front(HashCache *cache, HashCacheEntry *entry, unsigned char queue)
+{
+    if (entry->queue == queue && cache->queues[queue].head == entry)
+        return;
+    hashcache_list_unlink(cache, entry);
+    hashcache_list_push_front(cache, entry, queue);
+}
+
+/**
+ * Does `list` hold more than `percent` of either limit?
+ */
+static int hashcache_list_exceeds(const HashCache *cache, const HashCacheList *list, size_t percent)
+{
+    return (cache->max_entries > 0 && list->count * 100 > cache->max_entries * percent) ||
+           (cache->max_bytes > 0 && list->bytes * 100 > cache->max_bytes * percent);
+}
+
+static int hashcache_over_limit(const HashCache *cache)
+{
+    return (cache->max_entries > 0 && cache->size > cache->max_entries) ||
+           (cache->max_bytes > 0 && cache->bytes > cache->max_bytes);
+}
+
+/*
+ * S3-FIFO ghost queue: a ring of recently evicted key hashes plus a small
+ * counting table for membership tests. Collisions only cause an entry to
+ * start in the main queue, so the test may be approximate.
+ */
+
+static void hashcache_ghost_add(HashCache *cache, uint64_t hash)
+{
+    size_t mask = cache->ghost_capacity * 2 - 1;
+    size_t slot = cache->ghost_pos % cache->ghost_capacity;
+    if (cache->ghost_pos >= cache->ghost_capacity)
+    {
+        unsigned char *old = &cache->ghost_hits[cache->ghost[slot] & mask];
+        if (*old > 0)
+            (*old)--;
+    }
+    cache->ghost[slot] = hash;
+    unsigned char *count = &cache->ghost_hits[hash & mask];
+    if (*count < 255)
+        (*count)++;
+    cache->ghost_pos++;
+}
+
+static int hashcache_ghost_contains(const HashCache *cache, uint64_t hash)
+{
+    return cache->ghost_hits[hash & (cache->ghost_capacity * 2 - 1)] > 0;
+}
+
+/*
+ * W-TinyLFU frequency sketch: count-min with 4 rows of saturating counters,
+ * halved every TINYLFU_SAMPLE_FACTOR * width increments so old popularity fades.
+ */
+
+static const uint64_t sketch_seeds[4] = {
+    0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL,
+    0x165667B19E3779F9ULL, 0xD6E8FEB86659FD93ULL};
+
+static inline size_t hashcache_sketch_index(const HashCache *cache, uint64_t hash, int row)
+{
+    uint64_t mixed = (hash ^ (hash >> 31)) * sketch_seeds[row];
+    return (size_t)row * cache->sketch_width + (size_t)((mixed >> 32) & (cache->sketch_width - 1));
+}
+
+static void hashcache_sketch_add(HashCache *cache, uint64_t hash)
+{
+    for (int row = 0; row < 4; row++)
+    {
+        unsigned char *counter = &cache->sketch[hashcache_sketch_index(cache, hash, row)];
+        if (*counter < TINYLFU_MAX_COUNT)
+            (*counter)++;
+    }
+
+    if (++cache->sketch_adds >= cache->sketch_width * TINYLFU_SAMPLE_FACTOR)
+    {
+        for (size_t i = 0; i < cache->sketch_width * 4; i++)
+            cache->sketch[i] >>= 1;
+        cache->sketch_adds /= 2;
+    }
+}
+
+static unsigned hashcache_sketch_estimate(const HashCache *cache, uint64_t hash)
+{
+    unsigned estimate = TINYLFU_MAX_COUNT;
+    for (int row = 0; row < 4; row++)
+    {
+        unsigned counter = cache->sketch[hashcache_sketch_index(cache, hash, row)];
+        if (counter < estimate)
+            estimate = counter;
+    }
+    return estimate;
+}
+
+/*
+ * Policy hooks.
+ */
+
+/**
+ * Record an access to a present entry.
+ */
+static void hashcache_on_hit(HashCache *cache, HashCacheEntry *entry, uint64_t hash)
+{
+    switch (cache->policy)
+    {
+    case HASHCACHE_LRU:
+        hashcache_list_move_front(cache, entry, QUEUE_MAIN);
+        break;
+    case HASHCACHE_CLOCK:
+        entry->freq = 1;
+        break;
+    case HASHCACHE_S3FIFO:
+        if (entry->freq < S3FIFO_MAX_FREQ)
+            entry->freq++;
+        break;
+    case HASHCACHE_TINYLFU:
+        hashcache_sketch_add(cache, hash);
+        if (entry->queue == QUEUE_SMALL)
+        {
+            hashcache_list_move_front(cache, entry, QUEUE_SMALL);
+            break;
+        }
+        // Probation hits are promoted; protected overflow is demoted back.
+        hashcache_list_move_front(cache, entry, QUEUE_PROTECTED);
+        while (hashcache_list_exceeds(cache, &cache->queues[QUEUE_PROTECTED], TINYLFU_PROTECTED_PERCENT) &&
+               cache->queues[QUEUE_PROTECTED].tail != entry)
+        {
+            hashcache_list_move_front(cache, cache->queues[QUEUE_PROTECTED].tail, QUEUE_MAIN);
+        }
+        break;
+    }
+}
+
+/**
+ * Place a newly inserted entry in its first queue.
+ */
+static void hashcache_on_insert(HashCache *cache, HashCacheEntry *entry, uint64_t hash)
+{
+    entry->freq = 0;
+    switch (cache->policy)
+    {
+    case HASHCACHE_LRU:
+    case HASHCACHE_CLOCK:
+        hashcache_list_push_front(cache, entry, QUEUE_MAIN);
+        break;
+    case HASHCACHE_S3FIFO:
+        hashcache_list_push_front(cache, entry,
+                                  hashcache_ghost_contains(cache, hash) ? QUEUE_MAIN : QUEUE_SMALL);
+        break;
+    case HASHCACHE_TINYLFU:
+        hashcache_sketch_add(cache, hash);
+        hashcache_list_push_front(cache, entry, QUEUE_SMALL);
+        break;
+    }
+}
+
+/**
+ * Remove `entry` from its chain and its queue, and free it. The chain is
+ * found from the stored hash and walked by identity, without comparing keys.
+ */
+static void hashcache_drop(HashCache *cache, HashCacheEntry *entry)
+{
+    HashCacheEntry **link = &cache->buckets[hashmap_chain_index(entry->hash, cache->capacity)];
+    while (*link != entry)
+        link = &(*link)->next;
+    *link = entry->next;
+    hashcache_list_unlink(cache, entry);
+    cache->size--;
+    cache->bytes -= entry->key_size + entry->value_size;
+    hashcache_free_entry(entry, NULL);
+}
+
+/**
+ * Evict `victim`, calling the eviction callback first.
+ */
+static void hashcache_evict_entry(HashCache *cache, HashCacheEntry *victim)
+{
+    if (cache->evict_func)
+    {
+        cache->evict_func(hashcache_entry_key(victim), victim->key_size,
+                          hashcache_entry_value(victim), victim->value_size,
+                          cache->evict_ctx);
+    }
+    cache->evictions++;
+    hashcache_drop(cache, victim);
+}
+
+/**
+ * CLOCK / S3-FIFO main queue: give referenced entries another round,
+ * evict the first one that has none left.
+ */
+static int hashcache_evict_main_fifo(HashCache *cache)
+{
+    HashCacheList *main_queue = &cache->queues[QUEUE_MAIN];
+    while (main_queue->tail)
+    {
+        HashCacheEntry *tail = main_queue->tail;
+        if (tail->freq > 0)
+        {
+            tail->freq--;
+            hashcache_list_move_front(cache, tail, QUEUE_MAIN);
+            continue;
+        }
+        hashcache_evict_entry(cache, tail);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * S3-FIFO small queue: entries accessed more than once move to main,
+ * the rest are evicted and remembered in the ghost queue.
+ */
+static int hashcache_evict_small_fifo(HashCache *cache)
+{
+    HashCacheList *small = &cache->queues[QUEUE_SMALL];
+    while (small->tail)
+    {
+        HashCacheEntry *tail = small->tail;
+        if (tail->freq > 1)
+        {
+            tail->freq = 0;
+            hashcache_list_move_front(cache, tail, QUEUE_MAIN);
+            continue;
+        }
+        hashcache_ghost_add(cache, tail->hash);
+        hashcache_evict_entry(cache, tail);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * W-TinyLFU: the newest probation entry (typically just out of the window)
+ * is admitted only if the sketch says it is more popular than the probation
+ * victim; otherwise it is the one evicted.
+ */
+static int hashcache_evict_tinylfu(HashCache *cache)
+{
+    HashCacheList *probation = &cache->queues[QUEUE_MAIN];
+    HashCacheEntry *victim = probation->tail;
+    if (!victim)
+        victim = cache->queues[QUEUE_PROTECTED].tail;
+    if (!victim)
+        victim = cache->queues[QUEUE_SMALL].tail;
+    if (!victim)
+        return 0;
+
+    HashCacheEntry *candidate = probation->head;
+    if (candidate && candidate != victim && victim->queue == QUEUE_MAIN)
+    {
+        if (hashcache_sketch_estimate(cache, candidate->hash) <=
+            hashcache_sketch_estimate(cache, victim->hash))
+        {
+            cache->rejected++;
+            hashcache_evict_entry(cache, candidate);
+            return 1;
+        }
+    }
+    hashcache_evict_entry(cache, victim);
+    return 1;
+}
+
+/**
+ * Evict entries according to the policy until the cache is within its limits.
+ */
+static void hashcache_evict(HashCache *cache)
+{
+    if (cache->policy == HASHCACHE_TINYLFU)
+    {
+        // Window overflow becomes admission candidates at the head of probation.
+        HashCacheList *window = &cache->queues[QUEUE_SMALL];
+        while (window->tail && window->count > 1 &&
+               hashcache_list_exceeds(cache, window, TINYLFU_WINDOW_PERCENT))
+        {
+            hashcache_list_move_front(cache, window->tail, QUEUE_MAIN);
+        }
+    }
+
+    while (hashcache_over_limit(cache))
+    {
+        int evicted = 0;
+        switch (cache->policy)
+        {
+        case HASHCACHE_LRU:
+            if (cache->queues[QUEUE_MAIN].tail)
+            {
+                hashcache_evict_entry(cache, cache->queues[QUEUE_MAIN].tail);
+                evicted = 1;
+            }
+            break;
+        case HASHCACHE_CLOCK:
+            evicted = hashcache_evict_main_fifo(cache);
+            break;
+        case HASHCACHE_S3FIFO:
+            if (cache->queues[QUEUE_SMALL].count > 0 &&
+                (hashcache_list_exceeds(cache, &cache->queues[QUEUE_SMALL], S3FIFO_SMALL_PERCENT) ||
+                 cache->queues[QUEUE_MAIN].count == 0))
+            {
+                evicted = hashcache_evict_small_fifo(cache);
+            }
+            if (!evicted)
+                evicted = hashcache_evict_main_fifo(cache);
+            break;
+        case HASHCACHE_TINYLFU:
+            evicted = hashcache_evict_tinylfu(cache);
+            break;
+        }
+        if (!evicted)
+            break;
+    }
+}
+
+int hashcache_init(HashCache *cache,
+                   size_t max_entries,
+                   size_t max_bytes,
+                   hash_func_t hash_func,
+                   eq_func_t eq_func)
+{
+    return hashcache_init_policy(cache, max_entries, max_bytes, hash_func, eq_func, HASHCACHE_LRU);
+}
+
+int hashcache_init_policy(HashCache *cache,
+                          size_t max_entries,
+                          size_t max_bytes,
+                          hash_func_t hash_func,
+                          eq_func_t eq_func,
+                          HashCachePolicy policy)
+{
+    if (!cache || policy < HASHCACHE_LRU || policy > HASHCACHE_TINYLFU)
+        return -1;
+
+    memset(cache, 0, sizeof(*cache));
+
+    // With an entry limit, size the buckets so the cache never needs to resize.
+    size_t capacity = DEFAULT_INITIAL_CAPACITY;
+    if (max_entries > 0)
+    {
+        capacity = (size_t)((double)max_entries / DEFAULT_LOAD_FACTOR) + 1;
+    }
+
+    // Expected number of resident entries, for the ghost queue and sketch.
+    size_t tracked = (max_entries > 0) ? max_entries : max_bytes / CACHE_BYTES_PER_ENTRY;
+    if (tracked < CACHE_MIN_TRACKED)
+        tracked = CACHE_MIN_TRACKED;
+
+    cache->capacity = capacity;
+    cache->max_entries = max_entries;
+    cache->max_bytes = max_bytes;
+    cache->hash_func = (hash_func != NULL) ? hash_func : hashmap_hash_bytes;
+    cache->eq_func = (eq_func != NULL) ? eq_func : hashmap_default_eq;
+    cache->load_factor = DEFAULT_LOAD_FACTOR;
+    cache->policy = policy;
+
+    if (policy == HASHCACHE_S3FIFO)
+    {
+        cache->ghost_capacity = hashcache_round_pow2(tracked);
+        cache->ghost = (uint64_t *)calloc(cache->ghost_capacity, sizeof(uint64_t));
+        cache->ghost_hits = (unsigned char *)calloc(cache->ghost_capacity * 2, 1);
+        if (!cache->ghost || !cache->ghost_hits)
+        {
+            hashcache_destroy(cache);
+            return -1;
+        }
+    }
+    else if (policy == HASHCACHE_TINYLFU)
+    {
+        cache->sketch_width = hashcache_round_pow2(tracked);
+        cache->sketch = (unsigned char *)calloc(cache->sketch_width * 4, 1);
+        if (!cache->sketch)
+        {
+            hashcache_destroy(cache);
+            return -1;
+        }
+    }
+
+    cache->buckets = (HashCacheEntry **)calloc(cache->capacity, sizeof(HashCacheEntry *));
+    if (!cache->buckets)
+    {
+        hashcache_destroy(cache);
+        return -1;
+    }
+    return 0;
+}
+
+void hashcache_destroy(HashCache *cache)
+{
+    if (!cache)
+        return;
+
+    for (int q = 0; q < 3; q++)
+    {
+        HashCacheEntry *entry = cache->queues[q].head;
+        while (entry)
+        {
+            HashCacheEntry *next = entry->list_next;
+            hashcache_free_entry(entry, NULL);
+            entry = next;
+        }
+        cache->queues[q] = (HashCacheList){0};
+    }
+    free(cache->buckets);
+    free(cache->ghost);
+    free(cache->ghost_hits);
+    free(cache->sketch);
+    cache->buckets = NULL;
+    cache->ghost = NULL;
+    cache->ghost_hits = NULL;
+    cache->sketch = NULL;
+    cache->capacity = 0;
+    cache->size = 0;
+    cache->bytes = 0;
+}
+
+void hashcache_set_evict_callback(HashCache *cache, evict_func_t evict_func, void *ctx)
+{
+    if (!cache)
+        return;
+    cache->evict_func = evict_func;
+    cache->evict_ctx = ctx;
+}
+
+int hashcache_insert(HashCache *cache,
+                     const void *key_data, size_t key_size,
+                     const void *val_data, size_t val_size)
+{
+    if (!cache || !key_data || key_size == 0)
+        return -1;
+    if (cache->max_bytes > 0 && key_size + val_size > cache->max_bytes)
+        return -1; // could never fit
+
+    uint64_t hash = cache->hash_func(key_data, key_size);
+    HashCacheEntry *entry = *hashcache_find_link(cache, hash, key_data, key_size);
+    if (entry)
+    {
+        // Key found, update value (queue byte counts follow the new size)
+        HashMapData new_value;
+        if (hashmap_data_store(&new_value, val_data, val_size) != 0)
+            return -1;
+        hashmap_data_release(&entry->value, entry->value_size);
+        cache->bytes = cache->bytes - entry->value_size + val_size;
+        cache->queues[entry->queue].bytes = cache->queues[entry->queue].bytes - entry->value_size + val_size;
+        entry->value = new_value;
+        entry->value_size = val_size;
+        hashcache_on_hit(cache, entry, hash);
+        hashcache_evict(cache);
+        return 0;
+    }
+
+    // Only caches without an entry limit can outgrow their initial buckets.
+    if (hashmap_chain_full(cache->size, cache->capacity, cache->load_factor))
+    {
+        if (hashcache_resize(cache, cache->capacity * 2) != 0)
+        {
+            fprintf(stderr, "Warning: hashcache resizing failed.\n");
+        }
+    }
+
+    entry = (HashCacheEntry *)malloc(sizeof(HashCacheEntry));
+    if (!entry)
+        return -1;
+    if (hashmap_data_store(&entry->key, key_data, key_size) != 0)
+    {
+        free(entry);
+        return -1;
+    }
+    if (hashmap_data_store(&entry->value, val_data, val_size) != 0)
+    {
+        hashmap_data_release(&entry->key, key_size);
+        free(entry);
+        return -1;
+    }
+    entry->key_size = key_size;
+    entry->value_size = val_size;
+    entry->hash = hash;
+
+    size_t index = hashmap_chain_index(hash, cache->capacity);
+    entry->next = cache->buckets[index];
+    cache->buckets[index] = entry;
+    cache->size++;
+    cache->bytes += key_size + val_size;
+    hashcache_on_insert(cache, entry, hash);
+
+    hashcache_evict(cache);
+    return 0;
+}
+
+void *hashcache_find(HashCache *cache,
+                     const void *key_data, size_t key_size,
+                     size_t *out_size)
+{
+    if (!cache || !key_data || key_size == 0)
+        return NULL;
+
+    uint64_t hash = cache->hash_func(key_data, key_size);
+    HashCacheEntry *entry = *hashcache_find_link(cache, hash, key_data, key_size);
+    if (!entry)
+    {
+        cache->misses++;
+        if (cache->policy == HASHCACHE_TINYLFU)
+            hashcache_sketch_add(cache, hash);
+        return NULL;
+    }
+
+    cache->hits++;
+    hashcache_on_hit(cache, entry, hash);
+    if (out_size)
+        *out_size = entry->value_size;
+    return hashcache_entry_value(entry);
+}
+
+int hashcache_get(HashCache *cache,
+                  const void *key_data, size_t key_size,
+                  void **out_val, size_t *out_size)
+{
+    if (!cache || !key_data || key_size == 0)
+        return -1;
+
+    size_t value_size = 0;
+    void *value = hashcache_find(cache, key_data, key_size, &value_size);
+    if (!value)
+        return 0;
+
+    if (out_val && out_size)
+    {
+        *out_val = malloc(value_size);
+        if (!(*out_val))
+        {
+            return -1; // memory error
+        }
+        memcpy(*out_val, value, value_size);
+        *out_size = value_size;
+    }
+    return 1;
+}
+
+int hashcache_remove(HashCache *cache, const void *key_data, size_t key_size)
+{
+    if (!cache || !key_data || key_size == 0)
+        return -1;
+
+    uint64_t hash = cache->hash_func(key_data, key_size);
+    HashCacheEntry **link = hashcache_find_link(cache, hash, key_data, key_size);
+    HashCacheEntry *entry = *link;
+    if (!entry)
+        return 0;
+
+    *link = entry->next;
+    hashcache_list_unlink(cache, entry);
+    cache->size--;
+    cache->bytes -= entry->key_size + entry->value_size;
+    hashcache_free_entry(entry, NULL);
+    return 1;
+}
+
+void hashcache_get_stats(const HashCache *cache, HashCacheStats *stats)
+{
+    if (!cache || !stats)
+        return;
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evictions = cache->evictions;
+    stats->rejected = cache->rejected;
+    uint64_t lookups = cache->hits + cache->misses;
+    stats->hit_ratio = (lookups > 0) ? (double)cache->hits / (double)lookups : 0.0;
+}
+
+void hashcache_reset_stats(HashCache *cache)
+{
+    if (!cache)
+        return;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    cache->rejected = 0;
+}
@@ -0,0 +1,776 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/chashfrozen.h"
+
+/*
+ * Minimal perfect hashing in the style of PTHash:
+ *  - keys are spread over partitions of about FROZEN_PARTITION_KEYS keys,
+ *    which are built independently (and in parallel);
+ *  - a partition of m keys has a table of T = m / FROZEN_ALPHA positions and
+ *    B = FROZEN_C * m / log2(m) buckets, with 60% of the keys going to 30% of
+ *    the buckets so that large buckets are placed while the table is empty;
+ *  - buckets are placed largest first; each one gets the smallest pilot p for
+ *    which pos(key, p) is free for all of its keys;
+ *  - positions >= m are remapped to the positions < m left free, making the
+ *    function minimal.
+ * Pilots are stored in one byte; larger ones are escaped to a sorted table.
+ *
+ * Keys whose hashes are identical cannot be told apart by the function. The
+ * first of them is placed as usual; the others take the positions < m that
+ * the function leaves free and are listed in an overflow table sorted by
+ * hash, which a lookup searches when the key at its position does not match.
+ */
+
+#define FROZEN_PARTITION_KEYS 8192
+#define FROZEN_MAX_PARTITION 65535 // Remap entries are 16-bit positions
+#define FROZEN_ALPHA 0.98
+#define FROZEN_C 4.0
+#define FROZEN_DENSE_KEYS 0x999999999999999AULL // 60% of the hash range
+#define FROZEN_ESCAPE 255
+#define FROZEN_PILOT_BITS 24 // Escapes pack (bucket << 24) | pilot
+#define FROZEN_MAX_PILOT (1u << 20)
+#define FROZEN_MAX_SEEDS 16
+#define FROZEN_DUPLICATE UINT32_MAX // Position of a key whose hash another key has
+
+struct FrozenHashMapPartition
+{
+    uint64_t slot_offset;   // First slot of the partition
+    uint64_t bucket_offset; // First pilot of the partition
+    uint64_t remap_offset;  // First remap entry of the partition
+    uint32_t size;          // Keys (m)
+    uint32_t table_size;    // Positions (T)
+    uint32_t nbuckets;      // Buckets (B)
+    uint32_t seed;          // Seed that made the pilot search succeed
+};
+
+struct FrozenHashMapOverflow
+{
+    uint64_t hash; // Hash shared with the key the function places
+    uint64_t slot; // Slot holding this key
+};
+
+typedef struct
+{
+    uint64_t hash;
+    const HashMapEntry *entry;
+} FreezeKey;
+
+typedef struct
+{
+    uint64_t *items;
+    size_t count;
+    size_t capacity;
+} FreezeEscapes;
+
+typedef struct
+{
+    struct FrozenHashMapOverflow *items;
+    size_t count;
+    size_t capacity;
+} FreezeOverflow;
+
+typedef struct
+{
+    const HashMap *map;
+    FrozenHashMap *frozen;
+    const HashMapEntry **entries; // All entries, in chain order
+    uint64_t *hashes;             // hashes[i] = hash of entries[i]
+    FreezeKey *keys;              // Keys grouped by partition
+    uint64_t *key_offsets;        // npartitions + 1 offsets into keys
+    uint64_t *data_offsets;       // Start of each partition's bytes in data
+    FreezeEscapes *escapes;       // Per-partition escaped pilots
+    FreezeOverflow *overflow;     // Per-partition keys with a duplicate hash
+    size_t max_partition;         // Largest partition size
+    size_t max_buckets;           // Most buckets in one partition
+    size_t max_table;             // Largest partition table
+    size_t nthreads;
+    atomic_size_t next;           // Next partition (or hash chunk) to process
+    atomic_int error;
+} FreezeJob;
+
+static inline uint64_t frozen_mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * Map x onto [0, n) using its high bits (n < 2^32).
+ */
+static inline size_t frozen_range(uint64_t x, size_t n)
+{
+    return (size_t)(((x >> 32) * (uint64_t)n) >> 32);
+}
+
+static inline uint64_t frozen_key_hash(uint64_t hash, uint32_t seed)
+{
+    return frozen_mix(hash ^ ((uint64_t)(seed + 1) * 0x9E3779B97F4A7C15ULL));
+}
+
+static inline size_t frozen_bucket(uint64_t g1, size_t nbuckets)
+{
+    size_t dense = nbuckets * 3 / 10;
+    uint64_t x = g1 * 0x9E3779B97F4A7C15ULL;
+    if (dense == 0)
+        return frozen_range(x, nbuckets);
+    if (g1 < FROZEN_DENSE_KEYS)
+        return frozen_range(x, dense);
+    return dense + frozen_range(x, nbuckets - dense);
+}
+
+static inline size_t frozen_position(uint64_t g2, uint64_t pilot, size_t table_size)
+{
+    return frozen_range(g2 ^ frozen_mix(pilot + 0x632BE59BD9B4E019ULL), table_size);
+}
+
+static size_t frozen_partition_buckets(size_t m)
+{
+    double log2m = 1.0;
+    for (size_t v = m; v > 2; v >>= 1)
+        log2m += 1.0;
+    size_t b = (size_t)(FROZEN_C * (double)m / log2m) + 1;
+    return b;
+}
+
+static size_t frozen_partition_table(size_t m)
+{
+    size_t t = (size_t)((double)m / FROZEN_ALPHA);
+    return t < m ? m : t;
+}
+
+/**
+ * Run fn(job) on the calling thread and job->nthreads - 1 helpers.
+ */
+static void frozen_run(FreezeJob *job, void *(*fn)(void *))
+{
+    pthread_t *threads = NULL;
+    size_t started = 0;
+    if (job->nthreads > 1)
+        threads = (pthread_t *)malloc((job->nthreads - 1) * sizeof(pthread_t));
+    for (size_t i = 0; threads && i + 1 < job->nthreads; i++)
+    {
+        if (pthread_create(&threads[started], NULL, fn, job) != 0)
+            break; // The threads that did start share the work
+        started++;
+    }
+    fn(job);
+    for (size_t i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+}
+
+#define FROZEN_HASH_CHUNK 16384
+
+static void *frozen_hash_worker(void *arg)
+{
+    FreezeJob *job = (FreezeJob *)arg;
+    size_t n = job->map->size;
+    for (;;)
+    {
+        size_t start = atomic_fetch_add(&job->next, FROZEN_HASH_CHUNK);
+        if (start >= n)
+            break;
+        size_t end = start + FROZEN_HASH_CHUNK < n ? start + FROZEN_HASH_CHUNK : n;
+        for (size_t i = start; i < end; i++)
+            job->hashes[i] = job->map->hash_func(hashmap_entry_key(job->entries[i]),
+                                                 job->entries[i]->key_size);
+    }
+    return NULL;
+}
+
+/*
+ * Per-thread scratch space, sized for the largest partition.
+ */
+typedef struct
+{
+    uint64_t *g2;           // Position hash of each key
+    uint32_t *bucket_of;    // Bucket of each key
+    uint32_t *by_bucket;    // Keys grouped by bucket
+    uint32_t *bucket_start; // nbuckets + 1 offsets into by_bucket
+    uint32_t *order;        // Buckets, largest first
+    uint32_t *pos;          // Final position of each key (m + 2 entries)
+    uint64_t *pilot;        // Pilot of each bucket
+    uint64_t *taken;        // Bitmap of used positions
+    size_t bucket_cap;
+    size_t table_cap;
+} FreezeScratch;
+
+static int frozen_scratch_init(FreezeScratch *s, const FreezeJob *job)
+{
+    size_t m = job->max_partition ? job->max_partition : 1;
+    s->bucket_cap = job->max_buckets ? job->max_buckets : 1;
+    s->table_cap = job->max_table;
+    size_t counts = (s->bucket_cap > m ? s->bucket_cap : m) + 1;
+    s->g2 = (uint64_t *)malloc(m * sizeof(uint64_t));
+    s->bucket_of = (uint32_t *)malloc(m * sizeof(uint32_t));
+    s->by_bucket = (uint32_t *)malloc(m * sizeof(uint32_t));
+    s->bucket_start = (uint32_t *)malloc(counts * sizeof(uint32_t));
+    s->order = (uint32_t *)malloc(counts * sizeof(uint32_t));
+    s->pos = (uint32_t *)malloc((counts + 1) * sizeof(uint32_t));
+    s->pilot = (uint64_t *)malloc(s->bucket_cap * sizeof(uint64_t));
+    s->taken = (uint64_t *)malloc((s->table_cap / 64 + 1) * sizeof(uint64_t));
+    return (s->g2 && s->bucket_of && s->by_bucket && s->bucket_start &&
+            s->order && s->pos && s->pilot && s->taken)
+               ? 0
+               : -1;
+}
+
+static void frozen_scratch_free(FreezeScratch *s)
+{
+    free(s->g2);
+    free(s->bucket_of);
+    free(s->by_bucket);
+    free(s->bucket_start);
+    free(s->order);
+    free(s->pos);
+    free(s->pilot);
+    free(s->taken);
+}
+
+#define TAKEN(s, p) ((s)->taken[(p) >> 6] & ((uint64_t)1 << ((p) & 63)))
+#define SET_TAKEN(s, p) ((s)->taken[(p) >> 6] |= ((uint64_t)1 << ((p) & 63)))
+#define CLEAR_TAKEN(s, p) ((s)->taken[(p) >> 6] &= ~((uint64_t)1 << ((p) & 63)))
+
+/**
+ * Search pilots for one seed. Keys whose hash an earlier key of their bucket
+ * has get position FROZEN_DUPLICATE.
+ *   @return 0 on success, 1 if a pilot search gave up.
+ */
+static int frozen_search(FreezeScratch *s, const FreezeKey *keys, size_t m,
+                         size_t nbuckets, size_t table_size, uint32_t seed)
+{
+    memset(s->bucket_start, 0, (nbuckets + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < m; i++)
+    {
+        uint64_t g1 = frozen_key_hash(keys[i].hash, seed);
+        s->g2[i] = frozen_mix(g1);
+        s->bucket_of[i] = (uint32_t)frozen_bucket(g1, nbuckets);
+        s->bucket_start[s->bucket_of[i] + 1]++;
+    }
+
+    // Group keys by bucket, then order buckets by size (counting sorts)
+    size_t max_size = 0;
+    for (size_t b = 0; b < nbuckets; b++)
+    {
+        size_t size = s->bucket_start[b + 1];
+        if (size > max_size)
+            max_size = size;
+        s->bucket_start[b + 1] += s->bucket_start[b];
+    }
+    uint32_t *fill = s->order; // Borrowed until the bucket order is computed
+    memcpy(fill, s->bucket_start, nbuckets * sizeof(uint32_t));
+    for (size_t i = 0; i < m; i++)
+        s->by_bucket[fill[s->bucket_of[i]]++] = (uint32_t)i;
+
+    uint32_t *size_start = s->pos; // Borrowed: max_size + 2 <= m + 1 counters
+    memset(size_start, 0, (max_size + 2) * sizeof(uint32_t));
+    for (size_t b = 0; b < nbuckets; b++)
+        size_start[max_size - (s->bucket_start[b + 1] - s->bucket_start[b]) + 1]++;
+    for (size_t i = 0; i <= max_size; i++)
+        size_start[i + 1] += size_start[i];
+    for (size_t b = 0; b < nbuckets; b++)
+        s->order[size_start[max_size - (s->bucket_start[b + 1] - s->bucket_start[b])]++] = (uint32_t)b;
+
+    memset(s->taken, 0, (table_size / 64 + 1) * sizeof(uint64_t));
+    for (size_t o = 0; o < nbuckets; o++)
+    {
+        size_t b = s->order[o];
+        uint32_t *bk = &s->by_bucket[s->bucket_start[b]];
+        size_t count = s->bucket_start[b + 1] - s->bucket_start[b];
+        s->pilot[b] = 0;
+        if (count == 0)
+            break; // Buckets are sorted, so the rest are empty too
+
+        // g2 is a bijection of the key's hash: equal g2 means equal hashes.
+        // Move the first key of each hash to the front; only those are placed.
+        size_t unique = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t j = 0;
+            while (j < unique && s->g2[bk[j]] != s->g2[bk[i]])
+                j++;
+            if (j < unique)
+            {
+                s->pos[bk[i]] = FROZEN_DUPLICATE;
+                continue;
+            }
+            uint32_t key = bk[i];
+            bk[i] = bk[unique];
+            bk[unique++] = key;
+        }
+        count = unique;
+
+        uint64_t pilot;
+        for (pilot = 0; pilot < FROZEN_MAX_PILOT; pilot++)
+        {
+            size_t placed = 0;
+            for (; placed < count; placed++)
+            {
+                size_t p = frozen_position(s->g2[bk[placed]], pilot, table_size);
+                if (TAKEN(s, p))
+                    break;
+                SET_TAKEN(s, p);
+                s->pos[bk[placed]] = (uint32_t)p;
+            }
+            if (placed == count)
+                break;
+            while (placed--)
+                CLEAR_TAKEN(s, s->pos[bk[placed]]);
+        }
+        if (pilot == FROZEN_MAX_PILOT)
+            return 1;
+        s->pilot[b] = pilot;
+    }
+    // Pilots of empty buckets are never read; zero them for a deterministic build
+    for (size_t o = 0; o < nbuckets; o++)
+        if (s->bucket_start[s->order[o] + 1] == s->bucket_start[s->order[o]])
+            s->pilot[s->order[o]] = 0;
+    return 0;
+}
+
+static int frozen_add_escape(FreezeEscapes *escapes, uint64_t bucket, uint64_t pilot)
+{
+    if (escapes->count == escapes->capacity)
+    {
+        size_t capacity = escapes->capacity ? escapes->capacity * 2 : 8;
+        uint64_t *items = (uint64_t *)realloc(escapes->items, capacity * sizeof(uint64_t));
+        if (!items)
+            return -1;
+        escapes->items = items;
+        escapes->capacity = capacity;
+    }
+    escapes->items[escapes->count++] = (bucket << FROZEN_PILOT_BITS) | pilot;
+    return 0;
+}
+
+static int frozen_add_overflow(FreezeOverflow *overflow, struct FrozenHashMapOverflow item)
+{
+    if (overflow->count == overflow->capacity)
+    {
+        size_t capacity = overflow->capacity ? overflow->capacity * 2 : 8;
+        struct FrozenHashMapOverflow *items = (struct FrozenHashMapOverflow *)realloc(
+            overflow->items, capacity * sizeof(struct FrozenHashMapOverflow));
+        if (!items)
+            return -1;
+        overflow->items = items;
+        overflow->capacity = capacity;
+    }
+    overflow->items[overflow->count++] = item;
+    return 0;
+}
+
+/**
+ * Build one partition: search pilots, then write pilots, remap entries,
+ * slots and key/value bytes.
+ */
+static int frozen_build_partition(FreezeJob *job, FreezeScratch *s, size_t index)
+{
+    FrozenHashMap *frozen = job->frozen;
+    struct FrozenHashMapPartition *part = &frozen->partitions[index];
+    const FreezeKey *keys = &job->keys[job->key_offsets[index]];
+    size_t m = part->size;
+    size_t nbuckets = part->nbuckets;
+    size_t table_size = part->table_size;
+    if (m == 0)
+        return 0;
+
+    int status = 1;
+    uint32_t seed;
+    for (seed = 0; seed < FROZEN_MAX_SEEDS && status == 1; seed++)
+        status = frozen_search(s, keys, m, nbuckets, table_size, seed);
+    if (status != 0)
+        return -1;
+    part->seed = seed - 1;
+
+    for (size_t b = 0; b < nbuckets; b++)
+    {
+        uint8_t stored = (uint8_t)s->pilot[b];
+        if (s->pilot[b] >= FROZEN_ESCAPE)
+        {
+            stored = FROZEN_ESCAPE;
+            if (frozen_add_escape(&job->escapes[index], part->bucket_offset + b, s->pilot[b]) != 0)
+                return -1;
+        }
+        frozen->pilots[part->bucket_offset + b] = stored;
+    }
+
+    // Send positions past m to the free positions below m, in order
+    uint16_t *remap = &frozen->remap[part->remap_offset];
+    memset(remap, 0, (table_size - m) * sizeof(uint16_t));
+    size_t free_pos = 0;
+    for (size_t p = m; p < table_size; p++)
+    {
+        if (!TAKEN(s, p))
+            continue;
+        while (TAKEN(s, free_pos))
+            free_pos++;
+        remap[p - m] = (uint16_t)free_pos++;
+    }
+
+    uint64_t offset = job->data_offsets[index];
+    for (size_t i = 0; i < m; i++)
+    {
+        size_t p = s->pos[i];
+        if (s->pos[i] == FROZEN_DUPLICATE)
+        {
+            // The remaining free positions below m are exactly one per duplicate
+            while (TAKEN(s, free_pos))
+                free_pos++;
+            p = free_pos++;
+            struct FrozenHashMapOverflow item = {keys[i].hash, part->slot_offset + p};
+            if (frozen_add_overflow(&job->overflow[index], item) != 0)
+                return -1;
+        }
+        else if (p >= m)
+        {
+            p = remap[p - m];
+        }
+        const HashMapEntry *entry = keys[i].entry;
+        FrozenHashMapSlot *slot = &frozen->slots[part->slot_offset + p];
+        slot->offset = offset;
+        slot->key_size = (uint32_t)entry->key_size;
+        slot->value_size = (uint32_t)entry->value_size;
+        memcpy(frozen->data + offset, hashmap_entry_key(entry), entry->key_size);
+        offset += entry->key_size;
+        if (entry->value_size)
+            memcpy(frozen->data + offset, hashmap_entry_value(entry), entry->value_size);
+        offset += entry->value_size;
+    }
+    return 0;
+}
+
+static void *frozen_partition_worker(void *arg)
+{
+    FreezeJob *job = (FreezeJob *)arg;
+    FreezeScratch scratch;
+    if (frozen_scratch_init(&scratch, job) != 0)
+    {
+        atomic_store(&job->error, 1);
+        frozen_scratch_free(&scratch);
+        return NULL;
+    }
+    for (;;)
+    {
+        size_t index = atomic_fetch_add(&job->next, 1);
+        if (index >= job->frozen->npartitions || atomic_load(&job->error))
+            break;
+        if (frozen_build_partition(job, &scratch, index) != 0)
+            atomic_store(&job->error, 1);
+    }
+    frozen_scratch_free(&scratch);
+    return NULL;
+}
+
+/**
+ * Collect and hash the entries, then group them by partition and lay out
+ * the partitions' pilots, remap entries, slots and bytes.
+ */
+static int frozen_layout(FreezeJob *job)
+{
+    const HashMap *map = job->map;
+    FrozenHashMap *frozen = job->frozen;
+    size_t n = map->size;
+    size_t np = frozen->npartitions;
+
+    size_t k = 0;
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        for (const HashMapEntry *entry = map->buckets[i]; entry; entry = entry->next)
+        {
+            if (entry->key_size > UINT32_MAX || entry->value_size > UINT32_MAX)
+                return -1;
+            job->entries[k++] = entry;
+        }
+    }
+    atomic_store(&job->next, 0);
+    frozen_run(job, frozen_hash_worker);
+
+    uint64_t *part_of = (uint64_t *)malloc(n * sizeof(uint64_t));
+    uint64_t *fill = (uint64_t *)malloc((np + 1) * sizeof(uint64_t));
+    if (!part_of || !fill)
+    {
+        free(part_of);
+        free(fill);
+        return -1;
+    }
+    memset(job->key_offsets, 0, (np + 1) * sizeof(uint64_t));
+    memset(job->data_offsets, 0, (np + 1) * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++)
+    {
+        part_of[i] = frozen_range(frozen_mix(job->hashes[i]), np);
+        job->key_offsets[part_of[i] + 1]++;
+        job->data_offsets[part_of[i] + 1] += job->entries[i]->key_size + job->entries[i]->value_size;
+    }
+
+    uint64_t buckets = 0, remaps = 0;
+    job->max_partition = job->max_buckets = job->max_table = 0;
+    for (size_t p = 0; p < np; p++)
+    {
+        size_t m = (size_t)job->key_offsets[p + 1];
+        struct FrozenHashMapPartition *part = &frozen->partitions[p];
+        part->slot_offset = job->key_offsets[p];
+        part->bucket_offset = buckets;
+        part->remap_offset = remaps;
+        part->size = (uint32_t)m;
+        part->table_size = (uint32_t)(m ? frozen_partition_table(m) : 0);
+        part->nbuckets = (uint32_t)(m ? frozen_partition_buckets(m) : 0);
+        part->seed = 0;
+        buckets += part->nbuckets;
+        remaps += part->table_size - part->size;
+        if (m > job->max_partition)
+            job->max_partition = m;
+        if (part->nbuckets > job->max_buckets)
+            job->max_buckets = part->nbuckets;
+        if (part->table_size > job->max_table)
+            job->max_table = part->table_size;
+        job->key_offsets[p + 1] += job->key_offsets[p];
+        job->data_offsets[p + 1] += job->data_offsets[p];
+    }
+    if (job->max_partition > FROZEN_MAX_PARTITION)
+    {
+        free(part_of);
+        free(fill);
+        return -1;
+    }
+
+    memcpy(fill, job->key_offsets, (np + 1) * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++)
+    {
+        FreezeKey *key = &job->keys[fill[part_of[i]]++];
+        key->hash = job->hashes[i];
+        key->entry = job->entries[i];
+    }
+    free(part_of);
+    free(fill);
+
+    frozen->pilots = (uint8_t *)malloc(buckets ? buckets : 1);
+    frozen->remap = (uint16_t *)malloc((remaps ? remaps : 1) * sizeof(uint16_t));
+    frozen->data = (unsigned char *)malloc(job->data_offsets[np] ? job->data_offsets[np] : 1);
+    if (!frozen->pilots || !frozen->remap || !frozen->data)
+        return -1;
+    frozen->index_bytes = np * sizeof(struct FrozenHashMapPartition) + buckets +
+                          remaps * sizeof(uint16_t);
+    return 0;
+}
+
+static int frozen_merge_escapes(FreezeJob *job)
+{
+    FrozenHashMap *frozen = job->frozen;
+    size_t total = 0;
+    for (size_t p = 0; p < frozen->npartitions; p++)
+        total += job->escapes[p].count;
+    frozen->escapes = (uint64_t *)malloc((total ? total : 1) * sizeof(uint64_t));
+    if (!frozen->escapes)
+        return -1;
+    // Partitions own increasing bucket ranges, so concatenation keeps the table sorted
+    for (size_t p = 0; p < frozen->npartitions; p++)
+    {
+        if (job->escapes[p].count == 0)
+            continue;
+        memcpy(frozen->escapes + frozen->nescapes, job->escapes[p].items,
+               job->escapes[p].count * sizeof(uint64_t));
+        frozen->nescapes += job->escapes[p].count;
+    }
+    frozen->index_bytes += total * sizeof(uint64_t);
+    return 0;
+}
+
+static int frozen_compare_overflow(const void *a, const void *b)
+{
+    uint64_t x = ((const struct FrozenHashMapOverflow *)a)->hash;
+    uint64_t y = ((const struct FrozenHashMapOverflow *)b)->hash;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Concatenate the partitions' overflow lists and sort them by hash.
+ */
+static int frozen_merge_overflow(FreezeJob *job)
+{
+    FrozenHashMap *frozen = job->frozen;
+    size_t total = 0;
+    for (size_t p = 0; p < frozen->npartitions; p++)
+        total += job->overflow[p].count;
+    if (total == 0)
+        return 0;
+    frozen->overflow = (struct FrozenHashMapOverflow *)malloc(total * sizeof(struct FrozenHashMapOverflow));
+    if (!frozen->overflow)
+        return -1;
+    for (size_t p = 0; p < frozen->npartitions; p++)
+    {
+        memcpy(frozen->overflow + frozen->noverflow, job->overflow[p].items,
+               job->overflow[p].count * sizeof(struct FrozenHashMapOverflow));
+        frozen->noverflow += job->overflow[p].count;
+    }
+    qsort(frozen->overflow, total, sizeof(struct FrozenHashMapOverflow), frozen_compare_overflow);
+    frozen->index_bytes += total * sizeof(struct FrozenHashMapOverflow);
+    return 0;
+}
+
+int hashmap_freeze(const HashMap *map, FrozenHashMap *frozen, unsigned nthreads)
+{
+    if (!map || !map->buckets || !frozen)
+        return -1;
+
+    memset(frozen, 0, sizeof(*frozen));
+    frozen->size = map->size;
+    frozen->hash_func = map->hash_func;
+    frozen->eq_func = map->eq_func;
+    frozen->npartitions = (map->size + FROZEN_PARTITION_KEYS - 1) / FROZEN_PARTITION_KEYS;
+    if (frozen->npartitions == 0)
+        frozen->npartitions = 1;
+
+    if (nthreads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+
+    size_t n = map->size ? map->size : 1;
+    size_t np = frozen->npartitions;
+    FreezeJob job;
+    job.map = map;
+    job.frozen = frozen;
+    job.entries = (const HashMapEntry **)malloc(n * sizeof(HashMapEntry *));
+    job.hashes = (uint64_t *)malloc(n * sizeof(uint64_t));
+    job.keys = (FreezeKey *)malloc(n * sizeof(FreezeKey));
+    job.key_offsets = (uint64_t *)malloc((np + 1) * sizeof(uint64_t));
+    job.data_offsets = (uint64_t *)malloc((np + 1) * sizeof(uint64_t));
+    job.escapes = (FreezeEscapes *)calloc(np, sizeof(FreezeEscapes));
+    job.overflow = (FreezeOverflow *)calloc(np, sizeof(FreezeOverflow));
+    job.max_partition = job.max_buckets = job.max_table = 0;
+    job.nthreads = nthreads;
+    atomic_init(&job.next, 0);
+    atomic_init(&job.error, 0);
+    frozen->slots = (FrozenHashMapSlot *)malloc(n * sizeof(FrozenHashMapSlot));
+    frozen->partitions = (struct FrozenHashMapPartition *)malloc(np * sizeof(struct FrozenHashMapPartition));
+
+    int status = -1;
+    if (job.entries && job.hashes && job.keys && job.key_offsets && job.data_offsets &&
+        job.escapes && job.overflow && frozen->slots && frozen->partitions && frozen_layout(&job) == 0)
+    {
+        if (job.nthreads > np)
+            job.nthreads = np;
+        atomic_store(&job.next, 0);
+        frozen_run(&job, frozen_partition_worker);
+        if (!atomic_load(&job.error) && frozen_merge_escapes(&job) == 0)
+            status = frozen_merge_overflow(&job);
+    }
+
+    free(job.entries);
+    free(job.hashes);
+    free(job.keys);
+    free(job.key_offsets);
+    free(job.data_offsets);
+    for (size_t p = 0; job.escapes && p < np; p++)
+        free(job.escapes[p].items);
+    free(job.escapes);
+    for (size_t p = 0; job.overflow && p < np; p++)
+        free(job.overflow[p].items);
+    free(job.overflow);
+    if (status != 0)
+        hashmap_frozen_destroy(frozen);
+    return status;
+}
+
+void hashmap_frozen_destroy(FrozenHashMap *frozen)
+{
+    if (!frozen)
+        return;
+    free(frozen->slots);
+    free(frozen->data);
+    free(frozen->partitions);
+    free(frozen->pilots);
+    free(frozen->escapes);
+    free(frozen->remap);
+    free(frozen->overflow);
+    memset(frozen, 0, sizeof(*frozen));
+}
+
+static uint64_t frozen_escaped_pilot(const FrozenHashMap *frozen, uint64_t bucket)
+{
+    size_t lo = 0, hi = frozen->nescapes;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((frozen->escapes[mid] >> FROZEN_PILOT_BITS) < bucket)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return frozen->escapes[lo] & (((uint64_t)1 << FROZEN_PILOT_BITS) - 1);
+}
+
+/**
+ * Slot of a key whose hash another key has, or NULL.
+ */
+static const FrozenHashMapSlot *frozen_overflow_find(const FrozenHashMap *frozen, uint64_t hash,
+                                                     const void *key_data, size_t key_size)
+{
+    size_t lo = 0, hi = frozen->noverflow;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (frozen->overflow[mid].hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (; lo < frozen->noverflow && frozen->overflow[lo].hash == hash; lo++)
+    {
+        const FrozenHashMapSlot *slot = &frozen->slots[frozen->overflow[lo].slot];
+        if (slot->key_size == key_size &&
+            frozen->eq_func(frozen->data + slot->offset, key_data, key_size))
+            return slot;
+    }
+    return NULL;
+}
+
+int hashmap_frozen_get(const FrozenHashMap *frozen,
+                       const void *key_data, size_t key_size,
+                       const void **val_out, size_t *val_size)
+{
+    if (!frozen || !frozen->partitions || !key_data || key_size == 0)
+        return -1;
+    if (frozen->size == 0)
+        return 0;
+
+    uint64_t hash = frozen->hash_func(key_data, key_size);
+    const struct FrozenHashMapPartition *part =
+        &frozen->partitions[frozen_range(frozen_mix(hash), frozen->npartitions)];
+    if (part->size == 0)
+        return 0;
+
+    uint64_t g1 = frozen_key_hash(hash, part->seed);
+    uint64_t bucket = part->bucket_offset + frozen_bucket(g1, part->nbuckets);
+    uint64_t pilot = frozen->pilots[bucket];
+    if (pilot == FROZEN_ESCAPE)
+        pilot = frozen_escaped_pilot(frozen, bucket);
+
+    size_t p = frozen_position(frozen_mix(g1), pilot, part->table_size);
+    if (p >= part->size)
+        p = frozen->remap[part->remap_offset + p - part->size];
+
+    const FrozenHashMapSlot *slot = &frozen->slots[part->slot_offset + p];
+    const unsigned char *key = frozen->data + slot->offset;
+    if (slot->key_size != key_size || !frozen->eq_func(key, key_data, key_size))
+    {
+        slot = frozen->noverflow ? frozen_overflow_find(frozen, hash, key_data, key_size) : NULL;
+        if (!slot)
+            return 0;
+        key = frozen->data + slot->offset;
+    }
+    if (val_out)
+        *val_out = key + slot->key_size;
+    if (val_size)
+        *val_size = slot->value_size;
+    return 1;
+}
@@ -0,0 +1,300 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/chashimage.h"
+#include "chashmap_internal.h"
+
+/*
+ * Image layout (version 1, host byte order, every section 8-byte aligned):
+ *   HashMapImageHeader
+ *   uint64 offsets[nbuckets + 1]   record offsets, relative to the record region
+ *   records, grouped by bucket:    uint64 hash, uint32 key size, uint32 value
+ *                                  size, key bytes, value bytes, padding to 8
+ * Bucket b's records are [offsets[b], offsets[b + 1]).
+ */
+
+#define HASHIMAGE_MAGIC "CHMIMAGE"
+#define HASHIMAGE_VERSION 1u
+#define HASHIMAGE_BYTE_ORDER 0x01020304u
+#define HASHIMAGE_RECORD_HEADER 16
+#define HASHIMAGE_HASH_SAMPLE 16 // Stored hashes checked against hash_func on open
+#define HASHIMAGE_MULTIPLIER 0x9E3779B97F4A7C15ULL
+#define HASHIMAGE_BUFFER (1u << 16)
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t count;
+    uint64_t nbuckets;
+    uint64_t offsets_pos;  // File offset of the bucket offset table
+    uint64_t records_pos;  // File offset of the record region
+    uint64_t records_len;  // Length of the record region
+} HashMapImageHeader;
+
+typedef struct
+{
+    uint64_t hash;
+    const HashMapEntry *entry;
+} ImageSlot;
+
+static size_t image_record_size(size_t key_size, size_t value_size)
+{
+    return (HASHIMAGE_RECORD_HEADER + key_size + value_size + 7) & ~(size_t)7;
+}
+
+/**
+ * Bucket of a hash: the top bits of a multiplicative mix, so hash functions
+ * with weak low bits still spread over a power-of-two table.
+ */
+static size_t image_bucket(uint64_t hash, size_t nbuckets)
+{
+    if (nbuckets == 1)
+        return 0;
+    unsigned shift = 64 - (unsigned)__builtin_ctzll(nbuckets);
+    return (size_t)((hash * HASHIMAGE_MULTIPLIER) >> shift);
+}
+
+static int image_write_records(FILE *fp, const ImageSlot *slots, size_t count)
+{
+    static const unsigned char zeros[8] = {0};
+    for (size_t i = 0; i < count; i++)
+    {
+        const HashMapEntry *entry = slots[i].entry;
+        uint32_t sizes[2] = {(uint32_t)entry->key_size, (uint32_t)entry->value_size};
+        size_t written = HASHIMAGE_RECORD_HEADER + entry->key_size + entry->value_size;
+        size_t pad = image_record_size(entry->key_size, entry->value_size) - written;
+        if (fwrite(&slots[i].hash, sizeof(uint64_t), 1, fp) != 1 ||
+            fwrite(sizes, sizeof(sizes), 1, fp) != 1 ||
+            fwrite(hashmap_entry_key(entry), 1, entry->key_size, fp) != entry->key_size)
+            return -1;
+        if (entry->value_size &&
+            fwrite(hashmap_entry_value(entry), 1, entry->value_size, fp) != entry->value_size)
+            return -1;
+        if (pad && fwrite(zeros, 1, pad, fp) != pad)
+            return -1;
+    }
+    return 0;
+}
+
+int hashmap_image_write(const HashMap *map, const char *path)
+{
+    if (!map || !map->buckets || !path)
+        return -1;
+
+    size_t nbuckets = 1;
+    while (nbuckets < map->size)
+        nbuckets <<= 1;
+
+    // Hash every entry once and counting-sort the entries by image bucket
+    ImageSlot *slots = (ImageSlot *)malloc((map->size ? map->size : 1) * sizeof(ImageSlot));
+    uint64_t *offsets = (uint64_t *)calloc(nbuckets + 1, sizeof(uint64_t));
+    size_t *fill = (size_t *)calloc(nbuckets + 1, sizeof(size_t));
+    if (!slots || !offsets || !fill)
+    {
+        free(slots);
+        free(offsets);
+        free(fill);
+        return -1;
+    }
+
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        for (const HashMapEntry *entry = map->buckets[i]; entry; entry = entry->next)
+        {
+            uint64_t hash = map->hash_func(hashmap_entry_key(entry), entry->key_size);
+            size_t b = image_bucket(hash, nbuckets);
+            fill[b + 1]++;
+            offsets[b + 1] += image_record_size(entry->key_size, entry->value_size);
+        }
+    }
+    for (size_t b = 0; b < nbuckets; b++)
+    {
+        fill[b + 1] += fill[b];
+        offsets[b + 1] += offsets[b];
+    }
+    int status = 0;
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        for (const HashMapEntry *entry = map->buckets[i]; entry; entry = entry->next)
+        {
+            if (entry->key_size > UINT32_MAX || entry->value_size > UINT32_MAX)
+                status = -1;
+            uint64_t hash = map->hash_func(hashmap_entry_key(entry), entry->key_size);
+            ImageSlot *slot = &slots[fill[image_bucket(hash, nbuckets)]++];
+            slot->hash = hash;
+            slot->entry = entry;
+        }
+    }
+    free(fill);
+
+    HashMapImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HASHIMAGE_MAGIC, sizeof(header.magic));
+    header.version = HASHIMAGE_VERSION;
+    header.byte_order = HASHIMAGE_BYTE_ORDER;
+    header.count = map->size;
+    header.nbuckets = nbuckets;
+    header.offsets_pos = sizeof(header);
+    header.records_pos = header.offsets_pos + (nbuckets + 1) * sizeof(uint64_t);
+    header.records_len = offsets[nbuckets];
+
+    char *tmp_path = hashmap_temp_path(path);
+    FILE *fp = tmp_path ? fopen(tmp_path, "wb") : NULL;
+    if (status != 0 || !fp)
+    {
+        if (fp)
+        {
+            fclose(fp);
+            remove(tmp_path);
+        }
+        free(tmp_path);
+        free(slots);
+        free(offsets);
+        return -1;
+    }
+    setvbuf(fp, NULL, _IOFBF, HASHIMAGE_BUFFER);
+
+    if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+        fwrite(offsets, sizeof(uint64_t), nbuckets + 1, fp) != nbuckets + 1 ||
+        image_write_records(fp, slots, map->size) != 0)
+        status = -1;
+    status = hashmap_finish_file(fp, tmp_path, path, status);
+
+    free(tmp_path);
+    free(slots);
+    free(offsets);
+    return status;
+}
+
+int hashmap_image_open(HashMapImage *image, const char *path,
+                       hash_func_t hash_func, eq_func_t eq_func)
+{
+    if (!image || !path)
+        return -1;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(HashMapImageHeader))
+    {
+        close(fd);
+        return -1;
+    }
+    size_t length = (size_t)st.st_size;
+    void *base = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file referenced
+    if (base == MAP_FAILED)
+        return -1;
+
+    // Validate the header and that every section lies inside the file
+    const HashMapImageHeader *header = (const HashMapImageHeader *)base;
+    uint64_t n = header->nbuckets;
+    if (memcmp(header->magic, HASHIMAGE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != HASHIMAGE_VERSION ||
+        header->byte_order != HASHIMAGE_BYTE_ORDER ||
+        n == 0 || (n & (n - 1)) != 0 || n > length / sizeof(uint64_t) ||
+        header->offsets_pos != sizeof(HashMapImageHeader) ||
+        header->records_pos != header->offsets_pos + (n + 1) * sizeof(uint64_t) ||
+        header->records_pos > length ||
+        header->records_len > length - header->records_pos)
+    {
+        munmap(base, length);
+        return -1;
+    }
+
+    image->base = (const unsigned char *)base;
+    image->length = length;
+    image->offsets = (const uint64_t *)(image->base + header->offsets_pos);
+    image->records = image->base + header->records_pos;
+    image->nbuckets = (size_t)n;
+    image->size = (size_t)header->count;
+    image->hash_func = (hash_func != NULL) ? hash_func : hashmap_hash_bytes;
+    image->eq_func = (eq_func != NULL) ? eq_func : hashmap_default_eq;
+
+    // Lookups jump around the file; don't let readahead pull in neighbours.
+    // The offset table is checked bucket by bucket in hashmap_image_get(), so
+    // opening stays O(1).
+    madvise(base, length, MADV_RANDOM);
+
+    // Records are placed by the writer's hashes; a different hash_func would miss them
+    const unsigned char *rec = image->records;
+    const unsigned char *end = image->records + header->records_len;
+    for (unsigned i = 0; i < HASHIMAGE_HASH_SAMPLE && rec + HASHIMAGE_RECORD_HEADER <= end; i++)
+    {
+        uint64_t hash;
+        uint32_t key_size, value_size;
+        memcpy(&hash, rec, sizeof(hash));
+        memcpy(&key_size, rec + 8, sizeof(key_size));
+        memcpy(&value_size, rec + 12, sizeof(value_size));
+        size_t rec_size = image_record_size(key_size, value_size);
+        if (rec_size > (size_t)(end - rec) ||
+            image->hash_func(rec + HASHIMAGE_RECORD_HEADER, key_size) != hash)
+        {
+            hashmap_image_close(image);
+            return -1;
+        }
+        rec += rec_size;
+    }
+    return 0;
+}
+
+void hashmap_image_close(HashMapImage *image)
+{
+    if (!image || !image->base)
+        return;
+    munmap((void *)image->base, image->length);
+    image->base = NULL;
+    image->length = 0;
+    image->offsets = NULL;
+    image->records = NULL;
+    image->nbuckets = 0;
+    image->size = 0;
+}
+
+int hashmap_image_get(const HashMapImage *image,
+                      const void *key_data, size_t key_size,
+                      const void **val_out, size_t *val_size)
+{
+    if (!image || !image->base || !key_data || key_size == 0)
+        return -1;
+
+    uint64_t hash = image->hash_func(key_data, key_size);
+    size_t b = image_bucket(hash, image->nbuckets);
+    // The bucket's range must be ordered, aligned and inside the record region
+    uint64_t first = image->offsets[b], last = image->offsets[b + 1];
+    uint64_t records_len = ((const HashMapImageHeader *)image->base)->records_len;
+    if (first > last || last > records_len || ((first | last) & 7) != 0)
+        return -1;
+    const unsigned char *rec = image->records + first;
+    const unsigned char *end = image->records + last;
+    while (rec < end)
+    {
+        // A record that does not fit its bucket means a corrupt image
+        if ((size_t)(end - rec) < HASHIMAGE_RECORD_HEADER)
+            return -1;
+        const uint64_t *rec_hash = (const uint64_t *)rec;
+        const uint32_t *sizes = (const uint32_t *)(rec + 8);
+        size_t rec_size = image_record_size(sizes[0], sizes[1]);
+        if (rec_size > (size_t)(end - rec))
+            return -1;
+        const unsigned char *rec_key = rec + HASHIMAGE_RECORD_HEADER;
+        if (*rec_hash == hash && sizes[0] == key_size &&
+            image->eq_func(rec_key, key_data, key_size))
+        {
+            if (val_out)
+                *val_out = rec_key + key_size;
+            if (val_size)
+                *val_size = sizes[1];
+            return 1;
+        }
+        rec += rec_size;
+    }
+    return 0;
+}
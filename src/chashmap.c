@@ -1,22 +1,20 @@
 #include "../include/chashmap.h"
+#include "chashmap_internal.h"
 #include <assert.h>
 #include <string.h>
-
-#define DEFAULT_INITIAL_CAPACITY 16
-#define DEFAULT_LOAD_FACTOR 0.75f
+#include <time.h>
 
 // Forward declarations
-static uint64_t default_hash(const void *data, size_t size);
-static int default_eq(const void *data1, const void *data2, size_t size);
 static int hashmap_resize(HashMap *map, size_t new_capacity);
 static HashMapEntry *hashmap_create_entry(const void *key, size_t key_size,
                                           const void *val, size_t val_size);
-static void hashmap_free_entry(HashMapEntry *entry);
+static void hashmap_free_entry(HashMap *map, HashMapEntry *entry);
+static void hashmap_release_data(HashMap *map, HashMapData *data, size_t size);
 
 /**
- * Jenkins' one-at-a-time hash (an example).
+ * Jenkins' one-at-a-time hash (an example). Used when no hash_func is given.
  */
-static uint64_t default_hash(const void *data, size_t size)
+uint64_t hashmap_hash_bytes(const void *data, size_t size)
 {
     const unsigned char *key = (const unsigned char *)data;
     uint64_t hash = 0;
@@ -32,10 +30,7 @@ static uint64_t default_hash(const void *data, size_t size)
     return hash;
 }
 
-/**
- * Default equality function: byte-wise comparison.
- */
-static int default_eq(const void *data1, const void *data2, size_t size)
+int hashmap_default_eq(const void *data1, const void *data2, size_t size)
 {
     return memcmp(data1, data2, size) == 0;
 }
@@ -49,20 +44,19 @@ int hashmap_init(HashMap *map,
     if (!map)
         return -1;
 
-    if (capacity == 0)
-    {
-        capacity = DEFAULT_INITIAL_CAPACITY;
-    }
-    if (load_factor <= 0.0f)
-    {
-        load_factor = DEFAULT_LOAD_FACTOR;
-    }
-
+    hashmap_chain_defaults(&capacity, &load_factor);
     map->capacity = capacity;
     map->size = 0;
-    map->hash_func = (hash_func != NULL) ? hash_func : default_hash;
-    map->eq_func = (eq_func != NULL) ? eq_func : default_eq;
+    map->hash_func = (hash_func != NULL) ? hash_func : hashmap_hash_bytes;
+    map->eq_func = (eq_func != NULL) ? eq_func : hashmap_default_eq;
     map->load_factor = load_factor;
+    map->filter = NULL;
+    map->slabs = NULL;
+    map->wal = NULL;
+    map->snapshot = NULL;
+    map->resize_count = 0;
+    map->resize_ns = 0;
+    map->resize_threads = 1;
 
     map->buckets = (HashMapEntry **)calloc(map->capacity, sizeof(HashMapEntry *));
     if (!map->buckets)
@@ -77,17 +71,27 @@ void hashmap_destroy(HashMap *map)
     if (!map || !map->buckets)
         return;
 
+    if (map->snapshot)
+        hashmap_snapshot_wait(map);
+    hashmap_wal_close(map);
+    hashmap_disable_filter(map);
     for (size_t i = 0; i < map->capacity; i++)
     {
         HashMapEntry *entry = map->buckets[i];
         while (entry)
         {
             HashMapEntry *next = entry->next;
-            hashmap_free_entry(entry);
+            hashmap_free_entry(map, entry);
             entry = next;
         }
     }
     free(map->buckets);
+    while (map->slabs)
+    {
+        HashMapSlab *next = map->slabs->next;
+        free(map->slabs);
+        map->slabs = next;
+    }
     map->buckets = NULL;
     map->capacity = 0;
     map->size = 0;
@@ -102,10 +106,10 @@ int hashmap_insert(HashMap *map,
 {
     if (!map || !key_data || key_size == 0)
         return -1;
+    HASHMAP_INSTR_BEGIN();
 
-    // Resize if load factor exceeded
-    float current_load = (float)map->size / (float)map->capacity;
-    if (current_load >= map->load_factor)
+    // Resize if load factor exceeded (not while a snapshot depends on the bucket layout)
+    if (hashmap_chain_full(map->size, map->capacity, map->load_factor) && !map->snapshot)
     {
         int resize_status = hashmap_resize(map, map->capacity * 2);
         if (resize_status != 0)
@@ -116,23 +120,34 @@ int hashmap_insert(HashMap *map,
     }
 
     uint64_t hash_val = map->hash_func(key_data, key_size);
-    size_t index = hash_val % map->capacity;
+    size_t index = hashmap_chain_index(hash_val, map->capacity);
+    if (map->snapshot)
+        hashmap_snapshot_note_write(map, index);
 
     // Check for existing key in the chain
     HashMapEntry *entry = map->buckets[index];
     while (entry)
     {
+        HASHMAP_INSTR_PROBE();
         if (entry->key_size == key_size &&
-            map->eq_func(entry->key, key_data, key_size))
+            map->eq_func(hashmap_entry_key(entry), key_data, key_size))
         {
-            // Key found, update value
-            free(entry->value);
-            entry->value = malloc(val_size);
-            if (!entry->value)
-                return -1;
-            memcpy(entry->value, val_data, val_size);
+            // Key found, update value (store the new copy before dropping the old one)
+            HashMapData new_value;
+            if (hashmap_data_store(&new_value, val_data, val_size) != 0)
+                HASHMAP_INSTR_RETURN(HASHMAP_OP_INSERT, 1, -1);
+            HASHMAP_INSTR_ALLOCS(val_size > HASHMAP_INLINE_SIZE);
+            // Log only once nothing can fail, so the log never holds an update
+            // the map did not apply
+            if (map->wal && hashmap_wal_note_insert(map, key_data, key_size, val_data, val_size) != 0)
+            {
+                hashmap_data_release(&new_value, val_size);
+                HASHMAP_INSTR_RETURN(HASHMAP_OP_INSERT, 1, -1);
+            }
+            hashmap_release_data(map, &entry->value, entry->value_size);
+            entry->value = new_value;
             entry->value_size = val_size;
-            return 0;
+            HASHMAP_INSTR_RETURN(HASHMAP_OP_INSERT, 1, 0);
         }
         entry = entry->next;
     }
@@ -140,13 +155,20 @@ int hashmap_insert(HashMap *map,
     // Not found; insert new entry at head of the chain
     HashMapEntry *new_entry = hashmap_create_entry(key_data, key_size, val_data, val_size);
     if (!new_entry)
-        return -1;
+        HASHMAP_INSTR_RETURN(HASHMAP_OP_INSERT, 0, -1);
+    if (map->wal && hashmap_wal_note_insert(map, key_data, key_size, val_data, val_size) != 0)
+    {
+        hashmap_free_entry(map, new_entry);
+        HASHMAP_INSTR_RETURN(HASHMAP_OP_INSERT, 0, -1);
+    }
 
     new_entry->next = map->buckets[index];
     map->buckets[index] = new_entry;
     map->size++;
+    if (map->filter)
+        hashmap_filter_note_insert(map, hash_val);
 
-    return 0;
+    HASHMAP_INSTR_RETURN(HASHMAP_OP_INSERT, 0, 0);
 }
 
 int hashmap_get(const HashMap *map,
@@ -156,14 +178,18 @@ int hashmap_get(const HashMap *map,
     if (!map || !key_data || key_size == 0)
         return -1;
 
+    HASHMAP_INSTR_BEGIN();
     uint64_t hash_val = map->hash_func(key_data, key_size);
-    size_t index = hash_val % map->capacity;
+    if (map->filter && !hashmap_filter_may_contain(map->filter, hash_val))
+        HASHMAP_INSTR_RETURN(HASHMAP_OP_GET, 0, 0); // certainly absent
+    size_t index = hashmap_chain_index(hash_val, map->capacity);
 
     HashMapEntry *entry = map->buckets[index];
     while (entry)
     {
+        HASHMAP_INSTR_PROBE();
         if (entry->key_size == key_size &&
-            map->eq_func(entry->key, key_data, key_size))
+            map->eq_func(hashmap_entry_key(entry), key_data, key_size))
         {
             // Found the key
             if (out_val && out_size)
@@ -171,17 +197,39 @@ int hashmap_get(const HashMap *map,
                 *out_val = malloc(entry->value_size);
                 if (!(*out_val))
                 {
-                    return -1; // memory error
+                    HASHMAP_INSTR_RETURN(HASHMAP_OP_GET, 1, -1); // memory error
                 }
-                memcpy(*out_val, entry->value, entry->value_size);
+                HASHMAP_INSTR_ALLOCS(1);
+                memcpy(*out_val, hashmap_entry_value(entry), entry->value_size);
                 *out_size = entry->value_size;
             }
-            return 1; // found
+            HASHMAP_INSTR_RETURN(HASHMAP_OP_GET, 1, 1); // found
         }
         entry = entry->next;
     }
 
-    return 0; // not found
+    HASHMAP_INSTR_RETURN(HASHMAP_OP_GET, 0, 0); // not found
+}
+
+/**
+ * Unlink and free the entry at `*link` in chain `index`.
+ *   @return 0 on success, -1 if the WAL record could not be written (the
+ *           entry is then left in place).
+ */
+static int hashmap_remove_link(HashMap *map, size_t index, HashMapEntry **link)
+{
+    HashMapEntry *entry = *link;
+    if (map->wal && hashmap_wal_note_remove(map, hashmap_entry_key(entry), entry->key_size) != 0)
+        return -1;
+    if (map->snapshot)
+        hashmap_snapshot_note_write(map, index);
+
+    *link = entry->next;
+    hashmap_free_entry(map, entry);
+    map->size--;
+    if (map->filter)
+        hashmap_filter_note_remove(map);
+    return 0;
 }
 
 int hashmap_remove(HashMap *map, const void *key_data, size_t key_size)
@@ -189,34 +237,115 @@ int hashmap_remove(HashMap *map, const void *key_data, size_t key_size)
     if (!map || !key_data || key_size == 0)
         return -1;
 
+    HASHMAP_INSTR_BEGIN();
     uint64_t hash_val = map->hash_func(key_data, key_size);
-    size_t index = hash_val % map->capacity;
+    if (map->filter && !hashmap_filter_may_contain(map->filter, hash_val))
+        HASHMAP_INSTR_RETURN(HASHMAP_OP_REMOVE, 0, 0); // certainly absent
+    size_t index = hashmap_chain_index(hash_val, map->capacity);
 
-    HashMapEntry *entry = map->buckets[index];
-    HashMapEntry *prev = NULL;
-
-    while (entry)
+    HashMapEntry **link = &map->buckets[index];
+    while (*link)
     {
+        HASHMAP_INSTR_PROBE();
+        HashMapEntry *entry = *link;
         if (entry->key_size == key_size &&
-            map->eq_func(entry->key, key_data, key_size))
+            map->eq_func(hashmap_entry_key(entry), key_data, key_size))
         {
-            // Remove this entry
-            if (prev)
-            {
-                prev->next = entry->next;
-            }
-            else
-            {
-                map->buckets[index] = entry->next;
-            }
-            hashmap_free_entry(entry);
-            map->size--;
-            return 1; // removed
+            if (hashmap_remove_link(map, index, link) != 0)
+                HASHMAP_INSTR_RETURN(HASHMAP_OP_REMOVE, 1, -1);
+            HASHMAP_INSTR_RETURN(HASHMAP_OP_REMOVE, 1, 1); // removed
         }
-        prev = entry;
+        link = &entry->next;
+    }
+    HASHMAP_INSTR_RETURN(HASHMAP_OP_REMOVE, 0, 0); // not found
+}
+
+HashMapEntry *hashmap_find_hashed(const HashMap *map, uint64_t hash,
+                                  match_func_t match, void *ctx)
+{
+    if (!map || !match)
+        return NULL;
+    if (map->filter && !hashmap_filter_may_contain(map->filter, hash))
+        return NULL;
+
+    HashMapEntry *entry = map->buckets[hashmap_chain_index(hash, map->capacity)];
+    while (entry)
+    {
+        if (match(hashmap_entry_key(entry), entry->key_size, ctx))
+            return entry;
         entry = entry->next;
     }
-    return 0; // not found
+    return NULL;
+}
+
+HashMapEntry *hashmap_insert_hashed(HashMap *map, uint64_t hash,
+                                    match_func_t match, void *ctx,
+                                    const void *key_data, size_t key_size,
+                                    int *inserted)
+{
+    if (!map || !match || !key_data || key_size == 0)
+        return NULL;
+
+    // Same resize policy as hashmap_insert()
+    if (hashmap_chain_full(map->size, map->capacity, map->load_factor) && !map->snapshot)
+    {
+        if (hashmap_resize(map, map->capacity * 2) != 0)
+            fprintf(stderr, "Warning: hashmap resizing failed.\n");
+    }
+
+    size_t index = hashmap_chain_index(hash, map->capacity);
+    for (HashMapEntry *entry = map->buckets[index]; entry; entry = entry->next)
+    {
+        if (match(hashmap_entry_key(entry), entry->key_size, ctx))
+        {
+            if (inserted)
+                *inserted = 0;
+            return entry;
+        }
+    }
+
+    // Not found; link a new entry with an empty value at the head of the chain
+    HashMapEntry *new_entry = hashmap_create_entry(key_data, key_size, NULL, 0);
+    if (!new_entry)
+        return NULL;
+    if (map->wal && hashmap_wal_note_insert(map, key_data, key_size, NULL, 0) != 0)
+    {
+        hashmap_free_entry(map, new_entry);
+        return NULL;
+    }
+    if (map->snapshot)
+        hashmap_snapshot_note_write(map, index);
+
+    new_entry->next = map->buckets[index];
+    map->buckets[index] = new_entry;
+    map->size++;
+    if (map->filter)
+        hashmap_filter_note_insert(map, hash);
+    if (inserted)
+        *inserted = 1;
+    return new_entry;
+}
+
+int hashmap_remove_hashed(HashMap *map, uint64_t hash, match_func_t match, void *ctx)
+{
+    if (!map || !match)
+        return -1;
+    if (map->filter && !hashmap_filter_may_contain(map->filter, hash))
+        return 0;
+
+    size_t index = hashmap_chain_index(hash, map->capacity);
+    for (HashMapEntry **link = &map->buckets[index]; *link; link = &(*link)->next)
+    {
+        if (match(hashmap_entry_key(*link), (*link)->key_size, ctx))
+            return (hashmap_remove_link(map, index, link) == 0) ? 1 : -1;
+    }
+    return 0;
+}
+
+uint64_t hashmap_entry_hash(const void *entry, const void *map)
+{
+    const HashMapEntry *e = (const HashMapEntry *)entry;
+    return ((const HashMap *)map)->hash_func(hashmap_entry_key(e), e->key_size);
 }
 
 /**
@@ -229,6 +358,9 @@ static int hashmap_resize(HashMap *map, size_t new_capacity)
         return -1;
     }
 
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
     // Allocate new buckets
     HashMapEntry **new_buckets = (HashMapEntry **)calloc(new_capacity, sizeof(HashMapEntry *));
     if (!new_buckets)
@@ -236,22 +368,17 @@ static int hashmap_resize(HashMap *map, size_t new_capacity)
         return -1;
     }
 
-    // Rehash all entries
-    for (size_t i = 0; i < map->capacity; i++)
+    // Rehash all entries. A doubling table splits each chain in two, so
+    // threads can relink disjoint bucket ranges.
+    if (map->resize_threads > 1 && new_capacity == map->capacity * 2 &&
+        map->capacity >= HASHMAP_PARALLEL_RESIZE_MIN)
     {
-        HashMapEntry *entry = map->buckets[i];
-        while (entry)
-        {
-            HashMapEntry *next = entry->next;
-            uint64_t hash_val = map->hash_func(entry->key, entry->key_size);
-            size_t new_index = hash_val % new_capacity;
-
-            // Insert into new bucket chain
-            entry->next = new_buckets[new_index];
-            new_buckets[new_index] = entry;
-
-            entry = next;
-        }
+        hashmap_rehash_parallel(map, new_buckets);
+    }
+    else
+    {
+        hashmap_chain_relink((void **)map->buckets, map->capacity, (void **)new_buckets, new_capacity,
+                             offsetof(HashMapEntry, next), hashmap_entry_hash, map);
     }
 
     // Free old bucket array (but not entries!)
@@ -259,11 +386,17 @@ static int hashmap_resize(HashMap *map, size_t new_capacity)
 
     map->buckets = new_buckets;
     map->capacity = new_capacity;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    map->resize_count++;
+    map->resize_ns += (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL +
+                      (uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec;
     return 0;
 }
 
 /**
  * Helper to create a new entry object.
+ * Keys and values up to HASHMAP_INLINE_SIZE bytes need no extra allocation.
  */
 static HashMapEntry *hashmap_create_entry(const void *key, size_t key_size,
                                           const void *val, size_t val_size)
@@ -272,26 +405,23 @@ static HashMapEntry *hashmap_create_entry(const void *key, size_t key_size,
     if (!entry)
         return NULL;
     entry->next = NULL;
+    HASHMAP_INSTR_ALLOCS(1 + (key_size > HASHMAP_INLINE_SIZE) + (val_size > HASHMAP_INLINE_SIZE));
 
-    // Allocate and copy the key
-    entry->key = malloc(key_size);
-    if (!entry->key)
+    // Copy the key (inline or heap)
+    if (hashmap_data_store(&entry->key, key, key_size) != 0)
     {
         free(entry);
         return NULL;
     }
-    memcpy(entry->key, key, key_size);
     entry->key_size = key_size;
 
-    // Allocate and copy the value
-    entry->value = malloc(val_size);
-    if (!entry->value)
+    // Copy the value (inline or heap)
+    if (hashmap_data_store(&entry->value, val, val_size) != 0)
     {
-        free(entry->key);
+        hashmap_data_release(&entry->key, key_size);
         free(entry);
         return NULL;
     }
-    memcpy(entry->value, val, val_size);
     entry->value_size = val_size;
 
     return entry;
@@ -299,13 +429,47 @@ static HashMapEntry *hashmap_create_entry(const void *key, size_t key_size,
 
 /**
  * Helper to free an entry (and all memory it owns).
+ * Entries and bytes that live in a slab are released with the slab.
  */
-static void hashmap_free_entry(HashMapEntry *entry)
+static void hashmap_free_entry(HashMap *map, HashMapEntry *entry)
 {
     if (entry)
     {
-        free(entry->key);
-        free(entry->value);
-        free(entry);
+        hashmap_release_data(map, &entry->key, entry->key_size);
+        hashmap_release_data(map, &entry->value, entry->value_size);
+        if (!hashmap_slab_owns(map, entry))
+            free(entry);
     }
 }
+
+/**
+ * Like hashmap_data_release(), but leaves slab-owned bytes alone.
+ */
+static void hashmap_release_data(HashMap *map, HashMapData *data, size_t size)
+{
+    if (size > HASHMAP_INLINE_SIZE && hashmap_slab_owns(map, data->ptr))
+        return;
+    hashmap_data_release(data, size);
+}
+
+void *hashmap_slab_alloc(HashMap *map, size_t size)
+{
+    HashMapSlab *slab = (HashMapSlab *)malloc(sizeof(HashMapSlab) + size);
+    if (!slab)
+        return NULL;
+    slab->next = map->slabs;
+    slab->size = size;
+    map->slabs = slab;
+    return slab->data;
+}
+
+int hashmap_slab_owns(const HashMap *map, const void *ptr)
+{
+    for (const HashMapSlab *slab = map->slabs; slab; slab = slab->next)
+    {
+        uintptr_t start = (uintptr_t)slab->data;
+        if ((uintptr_t)ptr >= start && (uintptr_t)ptr < start + slab->size)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,289 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/chashmap_analyze.h"
+#include "chashmap_internal.h"
+
+/**
+ * Avalanche test: keys sampled, and input bits flipped per key (the first 32 bytes).
+ */
+#define AVALANCHE_KEYS 256
+#define AVALANCHE_BITS 256
+
+/**
+ * Flips an input bit needs before its worst pair is considered.
+ */
+#define AVALANCHE_MIN_SAMPLES 32
+
+/**
+ * Samples smaller than this never raise flags.
+ */
+#define MIN_FLAG_KEYS 64
+
+/**
+ * Most low index bits the entropy measurement looks at.
+ */
+#define ENTROPY_MAX_BITS 8
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static size_t default_capacity(size_t count)
+{
+    size_t capacity = DEFAULT_INITIAL_CAPACITY;
+    while ((double)count / (double)capacity >= DEFAULT_LOAD_FACTOR)
+        capacity *= 2;
+    return capacity;
+}
+
+/**
+ * Bucket spread: chi-squared, longest and mean chain.
+ */
+static int analyze_buckets(const uint64_t *hashes, size_t count, HashMapHashReport *report)
+{
+    size_t capacity = report->capacity;
+    uint32_t *buckets = (uint32_t *)calloc(capacity, sizeof(uint32_t));
+    if (!buckets)
+        return -1;
+    for (size_t i = 0; i < count; i++)
+        buckets[hashes[i] % capacity]++;
+
+    double expected = (double)count / (double)capacity;
+    double chi2 = 0.0;
+    size_t used = 0;
+    for (size_t b = 0; b < capacity; b++)
+    {
+        double d = (double)buckets[b] - expected;
+        chi2 += d * d / expected;
+        if (buckets[b] > report->max_chain)
+            report->max_chain = buckets[b];
+        if (buckets[b])
+            used++;
+    }
+    double df = (double)(capacity - 1);
+    report->chi_squared = chi2;
+    report->chi_squared_z = df > 0 ? (chi2 - df) / sqrt(2.0 * df) : 0.0;
+    report->mean_chain = used ? (double)count / (double)used : 0.0;
+
+    // Entropy of the low bits of the bucket index
+    unsigned bits = 0;
+    while (bits < ENTROPY_MAX_BITS && ((size_t)1 << (bits + 1)) <= capacity)
+        bits++;
+    size_t bins = (size_t)1 << bits;
+    size_t low[1 << ENTROPY_MAX_BITS] = {0};
+    for (size_t i = 0; i < count; i++)
+        low[(hashes[i] % capacity) & (bins - 1)]++;
+    double entropy = 0.0;
+    for (size_t b = 0; b < bins; b++)
+    {
+        if (low[b])
+        {
+            double p = (double)low[b] / (double)count;
+            entropy -= p * log2(p);
+        }
+    }
+    report->entropy_bits = bits;
+    report->low_bit_entropy = entropy;
+    free(buckets);
+    return 0;
+}
+
+static void analyze_bits(const uint64_t *hashes, size_t count, HashMapHashReport *report)
+{
+    size_t ones[64] = {0};
+    for (size_t i = 0; i < count; i++)
+        for (unsigned bit = 0; bit < 64; bit++)
+            ones[bit] += (hashes[i] >> bit) & 1;
+    for (unsigned bit = 0; bit < 64; bit++)
+    {
+        report->bit_bias[bit] = (double)ones[bit] / (double)count - 0.5;
+        if (bit < report->index_bits && fabs(report->bit_bias[bit]) > report->worst_bit_bias)
+            report->worst_bit_bias = fabs(report->bit_bias[bit]);
+    }
+}
+
+/**
+ * Flip each of the first AVALANCHE_BITS input bits of a sample of keys and
+ * record how often each output bit changes.
+ *   @return Fewest flips behind worst_avalanche (0 if none), or -1 on error.
+ */
+static long analyze_avalanche(hash_func_t hash_func, const void *const *keys,
+                              const size_t *key_sizes, size_t count,
+                              const uint64_t *hashes, HashMapHashReport *report)
+{
+    uint32_t *flips = (uint32_t *)calloc((size_t)AVALANCHE_BITS * 64, sizeof(uint32_t));
+    uint32_t trials[AVALANCHE_BITS] = {0};
+    size_t max_size = 0;
+    for (size_t i = 0; i < count; i++)
+        if (key_sizes[i] > max_size)
+            max_size = key_sizes[i];
+    unsigned char *buf = (unsigned char *)malloc(max_size ? max_size : 1);
+    if (!flips || !buf)
+    {
+        free(flips);
+        free(buf);
+        return -1;
+    }
+
+    size_t step = count > AVALANCHE_KEYS ? count / AVALANCHE_KEYS : 1;
+    for (size_t k = 0; k < count; k += step)
+    {
+        size_t size = key_sizes[k];
+        size_t nbits = size * 8 < AVALANCHE_BITS ? size * 8 : AVALANCHE_BITS;
+        memcpy(buf, keys[k], size);
+        for (size_t bit = 0; bit < nbits; bit++)
+        {
+            buf[bit >> 3] ^= (unsigned char)(1u << (bit & 7));
+            uint64_t diff = hashes[k] ^ hash_func(buf, size);
+            buf[bit >> 3] ^= (unsigned char)(1u << (bit & 7));
+            for (unsigned out = 0; out < 64; out++)
+                flips[bit * 64 + out] += (uint32_t)((diff >> out) & 1);
+            trials[bit]++;
+        }
+    }
+
+    double sum = 0.0;
+    size_t pairs = 0;
+    long worst_trials = 0;
+    for (unsigned bit = 0; bit < AVALANCHE_BITS; bit++)
+    {
+        if (trials[bit] == 0)
+            continue;
+        for (unsigned out = 0; out < report->index_bits; out++)
+        {
+            double bias = fabs((double)flips[bit * 64 + out] / trials[bit] - 0.5) * 2.0;
+            sum += bias;
+            pairs++;
+            if (trials[bit] >= AVALANCHE_MIN_SAMPLES && bias > report->worst_avalanche)
+            {
+                report->worst_avalanche = bias;
+                report->worst_input_bit = bit;
+                report->worst_output_bit = out;
+                worst_trials = trials[bit];
+            }
+        }
+    }
+    report->avalanche_bias = pairs ? sum / (double)pairs : 0.0;
+    free(flips);
+    free(buf);
+    return worst_trials;
+}
+
+int hashmap_analyze_hash(hash_func_t hash_func,
+                         const void *const *keys, const size_t *key_sizes,
+                         size_t count, size_t capacity,
+                         HashMapHashReport *report)
+{
+    if (!keys || !key_sizes || !report || count == 0)
+        return -1;
+    if (!hash_func)
+        hash_func = hashmap_hash_bytes;
+
+    memset(report, 0, sizeof(*report));
+    report->keys = count;
+    report->capacity = capacity ? capacity : default_capacity(count);
+    while (report->index_bits < 64 && ((uint64_t)1 << report->index_bits) < report->capacity)
+        report->index_bits++;
+
+    uint64_t *hashes = (uint64_t *)malloc(count * sizeof(uint64_t));
+    if (!hashes)
+        return -1;
+    for (size_t i = 0; i < count; i++)
+        hashes[i] = hash_func(keys[i], key_sizes[i]);
+
+    long avalanche_trials = analyze_avalanche(hash_func, keys, key_sizes, count, hashes, report);
+    if (avalanche_trials < 0 || analyze_buckets(hashes, count, report) != 0)
+    {
+        free(hashes);
+        return -1;
+    }
+    analyze_bits(hashes, count, report);
+
+    qsort(hashes, count, sizeof(uint64_t), compare_u64);
+    for (size_t i = 1; i < count; i++)
+        if (hashes[i] == hashes[i - 1])
+            report->collisions++;
+    report->expected_collisions = (double)count * (double)(count - 1) / 2.0 / 18446744073709551616.0;
+    free(hashes);
+
+    // Thresholds sit several standard deviations above what a random hash
+    // would show on the same sample.
+    if (count >= MIN_FLAG_KEYS)
+    {
+        double n = (double)count;
+        if (report->chi_squared_z > 6.0)
+            report->flags |= HASHMAP_HASH_UNEVEN_BUCKETS;
+        if (report->worst_bit_bias > 3.0 / sqrt(n) + 0.02)
+            report->flags |= HASHMAP_HASH_BIASED_BITS;
+        // Mean bias against what sampling noise alone gives (~0.8 / sqrt(trials)),
+        // or a pair that almost never (or always) flips
+        if (avalanche_trials > 0 &&
+            (report->avalanche_bias > 1.6 / sqrt((double)avalanche_trials) + 0.05 ||
+             report->worst_avalanche > 0.9))
+            report->flags |= HASHMAP_HASH_WEAK_AVALANCHE;
+        size_t bins = (size_t)1 << report->entropy_bits;
+        double deficit = (double)(bins - 1) / (2.0 * n * log(2.0)); // Expected shortfall of a random hash
+        if (report->entropy_bits > 0 && n >= 16.0 * (double)bins &&
+            report->low_bit_entropy < 0.95 * report->entropy_bits - deficit)
+            report->flags |= HASHMAP_HASH_LOW_ENTROPY;
+    }
+    double e = report->expected_collisions;
+    if ((double)report->collisions > e + 3.0 * sqrt(e) + 0.5)
+        report->flags |= HASHMAP_HASH_COLLISIONS;
+    return 0;
+}
+
+int hashmap_analyze_map(const HashMap *map, HashMapHashReport *report)
+{
+    if (!map || !map->buckets || !report || map->size == 0)
+        return -1;
+
+    const void **keys = (const void **)malloc(map->size * sizeof(void *));
+    size_t *key_sizes = (size_t *)malloc(map->size * sizeof(size_t));
+    if (!keys || !key_sizes)
+    {
+        free(keys);
+        free(key_sizes);
+        return -1;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        for (const HashMapEntry *entry = map->buckets[i]; entry; entry = entry->next)
+        {
+            keys[n] = hashmap_entry_key(entry);
+            key_sizes[n] = entry->key_size;
+            n++;
+        }
+    }
+    int status = hashmap_analyze_hash(map->hash_func, keys, key_sizes, n, map->capacity, report);
+    free(keys);
+    free(key_sizes);
+    return status;
+}
+
+void hashmap_print_hash_report(const HashMapHashReport *report, FILE *out)
+{
+    if (!report || !out)
+        return;
+    fprintf(out, "keys %zu, buckets %zu (%u index bits)\n", report->keys, report->capacity,
+            report->index_bits);
+    fprintf(out, "  chi-squared %.1f (z = %.2f)%s\n", report->chi_squared, report->chi_squared_z,
+            report->flags & HASHMAP_HASH_UNEVEN_BUCKETS ? "  <-- uneven buckets" : "");
+    fprintf(out, "  chains: longest %zu, mean %.2f\n", report->max_chain, report->mean_chain);
+    fprintf(out, "  worst index bit bias %.3f%s\n", report->worst_bit_bias,
+            report->flags & HASHMAP_HASH_BIASED_BITS ? "  <-- biased bits" : "");
+    fprintf(out, "  avalanche: mean bias %.3f, worst %.3f (input bit %u -> output bit %u)%s\n",
+            report->avalanche_bias, report->worst_avalanche, report->worst_input_bit,
+            report->worst_output_bit,
+            report->flags & HASHMAP_HASH_WEAK_AVALANCHE ? "  <-- weak avalanche" : "");
+    fprintf(out, "  low %u index bits: entropy %.3f bits%s\n", report->entropy_bits,
+            report->low_bit_entropy,
+            report->flags & HASHMAP_HASH_LOW_ENTROPY ? "  <-- low entropy" : "");
+    fprintf(out, "  64-bit collisions %zu (expected %.2g)%s\n", report->collisions,
+            report->expected_collisions,
+            report->flags & HASHMAP_HASH_COLLISIONS ? "  <-- collisions" : "");
+}
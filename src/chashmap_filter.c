@@ -0,0 +1,132 @@
+#include "../include/chashmap.h"
+#include "chashmap_internal.h"
+
+#define DEFAULT_BITS_PER_KEY 10
+#define MAX_BITS_PER_KEY 7 // One 64-bit mix yields 7 bit positions of 9 bits
+
+/**
+ * Bits set per key: bits_per_key * ln 2, within [1, MAX_BITS_PER_KEY].
+ */
+static unsigned hashmap_filter_k(unsigned bits_per_key)
+{
+    unsigned k = (unsigned)((double)bits_per_key * 0.693 + 0.5);
+    if (k < 1)
+        k = 1;
+    if (k > MAX_BITS_PER_KEY)
+        k = MAX_BITS_PER_KEY;
+    return k;
+}
+
+static void hashmap_filter_add(struct HashMapFilter *filter, uint64_t hash)
+{
+    uint64_t mixed = hashmap_filter_mix(hash);
+    uint64_t *block = hashmap_filter_block(filter, mixed);
+    uint64_t bits = mixed * 0x9E3779B97F4A7C15ULL;
+    for (unsigned i = 0; i < filter->k; i++, bits >>= 9)
+    {
+        unsigned bit = (unsigned)(bits & 511);
+        block[bit >> 6] |= (uint64_t)1 << (bit & 63);
+    }
+    filter->keys++;
+}
+
+/**
+ * Replace the filter's bit array with one sized for the map's load
+ * (the larger of its current size and its next resize threshold) and
+ * re-add every key.
+ */
+int hashmap_filter_rebuild(HashMap *map)
+{
+    struct HashMapFilter *filter = map->filter;
+    size_t max_keys = (size_t)((float)map->capacity * map->load_factor);
+    if (max_keys < map->size * 2)
+        max_keys = map->size * 2;
+    if (max_keys < DEFAULT_INITIAL_CAPACITY)
+        max_keys = DEFAULT_INITIAL_CAPACITY;
+
+    size_t bits = max_keys * filter->bits_per_key;
+    size_t nblocks = (bits + 511) / 512;
+    uint64_t *blocks = (uint64_t *)aligned_alloc(64, nblocks * 64);
+    if (!blocks)
+        return -1;
+    memset(blocks, 0, nblocks * 64);
+
+    free(filter->blocks);
+    filter->blocks = blocks;
+    filter->nblocks = nblocks;
+    filter->max_keys = max_keys;
+    filter->keys = 0;
+    filter->removed = 0;
+
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        for (HashMapEntry *entry = map->buckets[i]; entry; entry = entry->next)
+        {
+            hashmap_filter_add(filter, map->hash_func(hashmap_entry_key(entry), entry->key_size));
+        }
+    }
+    return 0;
+}
+
+/**
+ * Record a new key; rebuild larger once the filter's sizing is exceeded.
+ */
+void hashmap_filter_note_insert(HashMap *map, uint64_t hash)
+{
+    struct HashMapFilter *filter = map->filter;
+    if (filter->keys + 1 > filter->max_keys)
+    {
+        if (hashmap_filter_rebuild(map) == 0)
+            return; // the rebuild already covered the new key
+        fprintf(stderr, "Warning: hashmap filter rebuild failed.\n");
+    }
+    hashmap_filter_add(filter, hash);
+}
+
+/**
+ * Record a removal. Bloom filters cannot clear bits, so removed keys keep
+ * causing false positives until a rebuild, done once they reach a quarter
+ * of the keys the filter was sized for.
+ */
+void hashmap_filter_note_remove(HashMap *map)
+{
+    struct HashMapFilter *filter = map->filter;
+    if (++filter->removed > filter->max_keys / 4)
+    {
+        if (hashmap_filter_rebuild(map) != 0)
+            fprintf(stderr, "Warning: hashmap filter rebuild failed.\n");
+    }
+}
+
+int hashmap_enable_filter(HashMap *map, unsigned bits_per_key)
+{
+    if (!map || !map->buckets)
+        return -1;
+
+    if (bits_per_key == 0)
+        bits_per_key = DEFAULT_BITS_PER_KEY;
+
+    hashmap_disable_filter(map);
+    struct HashMapFilter *filter = (struct HashMapFilter *)calloc(1, sizeof(struct HashMapFilter));
+    if (!filter)
+        return -1;
+    filter->bits_per_key = bits_per_key;
+    filter->k = hashmap_filter_k(bits_per_key);
+
+    map->filter = filter;
+    if (hashmap_filter_rebuild(map) != 0)
+    {
+        hashmap_disable_filter(map);
+        return -1;
+    }
+    return 0;
+}
+
+void hashmap_disable_filter(HashMap *map)
+{
+    if (!map || !map->filter)
+        return;
+    free(map->filter->blocks);
+    free(map->filter);
+    map->filter = NULL;
+}
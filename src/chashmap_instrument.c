@@ -0,0 +1,191 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/chashmap_instrument.h"
+#include "chashmap_internal.h"
+
+uint64_t hashmap_latency_slot_value(size_t slot)
+{
+    if (slot < 16)
+        return slot;
+    unsigned e = 4 + (unsigned)((slot - 16) / 8);
+    return ((uint64_t)8 | ((slot - 16) % 8)) << (e - 3);
+}
+
+uint64_t hashmap_counters_percentile(const HashMapOpCounters *ops, double percentile)
+{
+    if (!ops || ops->samples == 0)
+        return 0;
+    uint64_t rank = (uint64_t)((double)ops->samples * percentile / 100.0);
+    if (rank >= ops->samples)
+        rank = ops->samples - 1;
+    uint64_t seen = 0;
+    for (size_t slot = 0; slot < HASHMAP_LATENCY_SLOTS; slot++)
+    {
+        seen += ops->latency[slot];
+        if (seen > rank)
+            return hashmap_latency_slot_value(slot);
+    }
+    return hashmap_latency_slot_value(HASHMAP_LATENCY_SLOTS - 1);
+}
+
+#ifdef CHASHMAP_INSTRUMENT
+
+_Thread_local HashMapInstrThread *hashmap_instr_tls = NULL;
+
+static pthread_mutex_t instr_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t instr_once = PTHREAD_ONCE_INIT;
+static pthread_key_t instr_key;
+static HashMapInstrThread *instr_threads = NULL; // Live threads
+static HashMapInstrThread instr_retired;          // Sum of exited threads
+
+static void instr_merge(HashMapInstrThread *dst, const HashMapInstrThread *src)
+{
+    for (int op = 0; op < HASHMAP_OP_COUNT; op++)
+    {
+        const HashMapInstrOp *s = &src->ops[op];
+        HashMapInstrOp *d = &dst->ops[op];
+        hashmap_instr_add(&d->calls, atomic_load_explicit(&s->calls, memory_order_relaxed));
+        hashmap_instr_add(&d->hits, atomic_load_explicit(&s->hits, memory_order_relaxed));
+        hashmap_instr_add(&d->misses, atomic_load_explicit(&s->misses, memory_order_relaxed));
+        hashmap_instr_add(&d->probes, atomic_load_explicit(&s->probes, memory_order_relaxed));
+        hashmap_instr_add(&d->allocs, atomic_load_explicit(&s->allocs, memory_order_relaxed));
+        hashmap_instr_add(&d->samples, atomic_load_explicit(&s->samples, memory_order_relaxed));
+        for (size_t i = 0; i < HASHMAP_LATENCY_SLOTS; i++)
+            hashmap_instr_add(&d->latency[i], atomic_load_explicit(&s->latency[i], memory_order_relaxed));
+    }
+}
+
+/**
+ * Thread exit: fold the thread's counters into the retired totals.
+ */
+static void instr_thread_exit(void *arg)
+{
+    HashMapInstrThread *t = (HashMapInstrThread *)arg;
+    pthread_mutex_lock(&instr_lock);
+    instr_merge(&instr_retired, t);
+    if (t->prev)
+        t->prev->next = t->next;
+    else
+        instr_threads = t->next;
+    if (t->next)
+        t->next->prev = t->prev;
+    pthread_mutex_unlock(&instr_lock);
+    hashmap_instr_tls = NULL;
+    free(t);
+}
+
+static void instr_init_key(void)
+{
+    pthread_key_create(&instr_key, instr_thread_exit);
+}
+
+HashMapInstrThread *hashmap_instr_thread_init(void)
+{
+    pthread_once(&instr_once, instr_init_key);
+    HashMapInstrThread *t = (HashMapInstrThread *)calloc(1, sizeof(HashMapInstrThread));
+    if (!t)
+        return NULL;
+    pthread_mutex_lock(&instr_lock);
+    t->next = instr_threads;
+    if (instr_threads)
+        instr_threads->prev = t;
+    instr_threads = t;
+    pthread_mutex_unlock(&instr_lock);
+    pthread_setspecific(instr_key, t);
+    hashmap_instr_tls = t;
+    return t;
+}
+
+/**
+ * Timestamp-counter ticks per nanosecond, measured once over ~10 ms.
+ */
+static double instr_ticks_per_ns(void)
+{
+    static double ratio = 0.0;
+    if (ratio == 0.0)
+    {
+        struct timespec a, b, pause = {0, 10000000L};
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        uint64_t t0 = hashmap_instr_ticks();
+        nanosleep(&pause, NULL);
+        uint64_t t1 = hashmap_instr_ticks();
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        double ns = (double)(b.tv_sec - a.tv_sec) * 1e9 + (double)(b.tv_nsec - a.tv_nsec);
+        ratio = ns > 0 ? (double)(t1 - t0) / ns : 1.0;
+    }
+    return ratio;
+}
+
+int hashmap_counters_read(HashMapCounters *out)
+{
+    if (!out)
+        return -1;
+    HashMapInstrThread *sum = (HashMapInstrThread *)calloc(1, sizeof(HashMapInstrThread));
+    if (!sum)
+        return -1;
+
+    pthread_mutex_lock(&instr_lock);
+    instr_merge(sum, &instr_retired);
+    for (const HashMapInstrThread *t = instr_threads; t; t = t->next)
+        instr_merge(sum, t);
+    double ratio = instr_ticks_per_ns();
+    pthread_mutex_unlock(&instr_lock);
+
+    for (int op = 0; op < HASHMAP_OP_COUNT; op++)
+    {
+        const HashMapInstrOp *s = &sum->ops[op];
+        HashMapOpCounters *d = &out->ops[op];
+        d->calls = atomic_load(&s->calls);
+        d->hits = atomic_load(&s->hits);
+        d->misses = atomic_load(&s->misses);
+        d->probes = atomic_load(&s->probes);
+        d->allocs = atomic_load(&s->allocs);
+        d->samples = atomic_load(&s->samples);
+        for (size_t i = 0; i < HASHMAP_LATENCY_SLOTS; i++)
+            d->latency[i] = atomic_load(&s->latency[i]);
+    }
+    out->ticks_per_ns = ratio;
+    free(sum);
+    return 0;
+}
+
+static void instr_zero(HashMapInstrThread *t)
+{
+    for (int op = 0; op < HASHMAP_OP_COUNT; op++)
+    {
+        HashMapInstrOp *c = &t->ops[op];
+        atomic_store_explicit(&c->calls, 0, memory_order_relaxed);
+        atomic_store_explicit(&c->hits, 0, memory_order_relaxed);
+        atomic_store_explicit(&c->misses, 0, memory_order_relaxed);
+        atomic_store_explicit(&c->probes, 0, memory_order_relaxed);
+        atomic_store_explicit(&c->allocs, 0, memory_order_relaxed);
+        atomic_store_explicit(&c->samples, 0, memory_order_relaxed);
+        for (size_t i = 0; i < HASHMAP_LATENCY_SLOTS; i++)
+            atomic_store_explicit(&c->latency[i], 0, memory_order_relaxed);
+    }
+}
+
+void hashmap_counters_reset(void)
+{
+    pthread_mutex_lock(&instr_lock);
+    instr_zero(&instr_retired);
+    for (HashMapInstrThread *t = instr_threads; t; t = t->next)
+        instr_zero(t);
+    pthread_mutex_unlock(&instr_lock);
+}
+
+#else
+
+int hashmap_counters_read(HashMapCounters *out)
+{
+    (void)out;
+    return -1; // Built without CHASHMAP_INSTRUMENT
+}
+
+void hashmap_counters_reset(void)
+{
+}
+
+#endif // CHASHMAP_INSTRUMENT
@@ -0,0 +1,203 @@
+#include "../include/chashmap_int.h"
+#include "chashmap_internal.h"
+
+/*
+ * HashMapU64 and HashMapU32 share one implementation, instantiated below by
+ * HASHMAP_INT_IMPL for each key type. Compared with the generic HashMap:
+ *   - the key is compared as an integer, not via eq_func + key_size;
+ *   - the bucket index is the top bits of key * HASHMAP_INT_MULTIPLIER
+ *     (Fibonacci hashing), so there is no hash_func call and no modulo.
+ */
+
+/**
+ * Smallest power of two >= n, at least 2 (keeps the shift below 64).
+ */
+static size_t hashmap_int_round_pow2(size_t n)
+{
+    size_t capacity = 2;
+    while (capacity < n)
+        capacity <<= 1;
+    return capacity;
+}
+
+/**
+ * log2 of a power of two.
+ */
+static unsigned hashmap_int_log2(size_t capacity)
+{
+    unsigned bits = 0;
+    while (((size_t)1 << bits) < capacity)
+        bits++;
+    return bits;
+}
+
+#define HASHMAP_INT_INDEX(key, shift) \
+    ((size_t)(((uint64_t)(key) * HASHMAP_INT_MULTIPLIER) >> (shift)))
+
+#define HASHMAP_INT_IMPL(prefix, MapT, EntryT, KeyT)                                  \
+    static int prefix##_resize(MapT *map, size_t new_capacity)                        \
+    {                                                                                 \
+        EntryT **new_buckets = (EntryT **)calloc(new_capacity, sizeof(EntryT *));     \
+        if (!new_buckets)                                                             \
+            return -1;                                                                \
+        unsigned new_shift = 64 - hashmap_int_log2(new_capacity);                     \
+                                                                                      \
+        for (size_t i = 0; i < map->capacity; i++)                                    \
+        {                                                                             \
+            EntryT *entry = map->buckets[i];                                          \
+            while (entry)                                                             \
+            {                                                                         \
+                EntryT *next = entry->next;                                           \
+                size_t new_index = HASHMAP_INT_INDEX(entry->key, new_shift);          \
+                entry->next = new_buckets[new_index];                                 \
+                new_buckets[new_index] = entry;                                       \
+                entry = next;                                                         \
+            }                                                                         \
+        }                                                                             \
+                                                                                      \
+        free(map->buckets);                                                           \
+        map->buckets = new_buckets;                                                   \
+        map->capacity = new_capacity;                                                 \
+        map->shift = new_shift;                                                       \
+        return 0;                                                                     \
+    }                                                                                 \
+                                                                                      \
+    int prefix##_init(MapT *map, size_t capacity, float load_factor)                  \
+    {                                                                                 \
+        if (!map)                                                                     \
+            return -1;                                                                \
+        if (capacity == 0)                                                            \
+            capacity = DEFAULT_INITIAL_CAPACITY;                                      \
+        if (load_factor <= 0.0f)                                                      \
+            load_factor = DEFAULT_LOAD_FACTOR;                                        \
+                                                                                      \
+        map->capacity = hashmap_int_round_pow2(capacity);                             \
+        map->shift = 64 - hashmap_int_log2(map->capacity);                            \
+        map->size = 0;                                                                \
+        map->load_factor = load_factor;                                               \
+        map->buckets = (EntryT **)calloc(map->capacity, sizeof(EntryT *));            \
+        if (!map->buckets)                                                            \
+            return -1;                                                                \
+        return 0;                                                                     \
+    }                                                                                 \
+                                                                                      \
+    void prefix##_destroy(MapT *map)                                                  \
+    {                                                                                 \
+        if (!map || !map->buckets)                                                    \
+            return;                                                                   \
+        for (size_t i = 0; i < map->capacity; i++)                                    \
+        {                                                                             \
+            EntryT *entry = map->buckets[i];                                          \
+            while (entry)                                                             \
+            {                                                                         \
+                EntryT *next = entry->next;                                           \
+                hashmap_data_release(&entry->value, entry->value_size);               \
+                free(entry);                                                          \
+                entry = next;                                                         \
+            }                                                                         \
+        }                                                                             \
+        free(map->buckets);                                                           \
+        map->buckets = NULL;                                                          \
+        map->capacity = 0;                                                            \
+        map->size = 0;                                                                \
+        map->load_factor = 0;                                                         \
+    }                                                                                 \
+                                                                                      \
+    int prefix##_insert(MapT *map, KeyT key, const void *val_data, size_t val_size)   \
+    {                                                                                 \
+        if (!map || (!val_data && val_size > 0))                                      \
+            return -1;                                                                \
+                                                                                      \
+        if ((float)map->size >= (float)map->capacity * map->load_factor)              \
+        {                                                                             \
+            if (prefix##_resize(map, map->capacity * 2) != 0)                         \
+                fprintf(stderr, "Warning: hashmap resizing failed.\n");               \
+        }                                                                             \
+                                                                                      \
+        size_t index = HASHMAP_INT_INDEX(key, map->shift);                            \
+        for (EntryT *entry = map->buckets[index]; entry; entry = entry->next)         \
+        {                                                                             \
+            if (entry->key == key)                                                    \
+            {                                                                         \
+                HashMapData new_value;                                                \
+                if (hashmap_data_store(&new_value, val_data, val_size) != 0)          \
+                    return -1;                                                        \
+                hashmap_data_release(&entry->value, entry->value_size);               \
+                entry->value = new_value;                                             \
+                entry->value_size = val_size;                                         \
+                return 0;                                                             \
+            }                                                                         \
+        }                                                                             \
+                                                                                      \
+        EntryT *new_entry = (EntryT *)malloc(sizeof(EntryT));                         \
+        if (!new_entry)                                                               \
+            return -1;                                                                \
+        if (hashmap_data_store(&new_entry->value, val_data, val_size) != 0)           \
+        {                                                                             \
+            free(new_entry);                                                          \
+            return -1;                                                                \
+        }                                                                             \
+        new_entry->key = key;                                                         \
+        new_entry->value_size = val_size;                                             \
+        new_entry->next = map->buckets[index];                                        \
+        map->buckets[index] = new_entry;                                              \
+        map->size++;                                                                  \
+        return 0;                                                                     \
+    }                                                                                 \
+                                                                                      \
+    void *prefix##_find(const MapT *map, KeyT key, size_t *out_size)                  \
+    {                                                                                 \
+        if (!map)                                                                     \
+            return NULL;                                                              \
+        EntryT *entry = map->buckets[HASHMAP_INT_INDEX(key, map->shift)];             \
+        while (entry && entry->key != key)                                            \
+            entry = entry->next;                                                      \
+        if (!entry)                                                                   \
+            return NULL;                                                              \
+        if (out_size)                                                                 \
+            *out_size = entry->value_size;                                            \
+        return hashmap_data_bytes(&entry->value, entry->value_size);                  \
+    }                                                                                 \
+                                                                                      \
+    int prefix##_get(const MapT *map, KeyT key, void **out_val, size_t *out_size)     \
+    {                                                                                 \
+        if (!map)                                                                     \
+            return -1;                                                                \
+        size_t value_size = 0;                                                        \
+        void *value = prefix##_find(map, key, &value_size);                           \
+        if (!value)                                                                   \
+            return 0;                                                                 \
+        if (out_val && out_size)                                                      \
+        {                                                                             \
+            *out_val = malloc(value_size);                                            \
+            if (!(*out_val))                                                          \
+                return -1;                                                            \
+            memcpy(*out_val, value, value_size);                                      \
+            *out_size = value_size;                                                   \
+        }                                                                             \
+        return 1;                                                                     \
+    }                                                                                 \
+                                                                                      \
+    int prefix##_remove(MapT *map, KeyT key)                                          \
+    {                                                                                 \
+        if (!map)                                                                     \
+            return -1;                                                                \
+        EntryT **link = &map->buckets[HASHMAP_INT_INDEX(key, map->shift)];            \
+        while (*link)                                                                 \
+        {                                                                             \
+            EntryT *entry = *link;                                                    \
+            if (entry->key == key)                                                    \
+            {                                                                         \
+                *link = entry->next;                                                  \
+                hashmap_data_release(&entry->value, entry->value_size);               \
+                free(entry);                                                          \
+                map->size--;                                                          \
+                return 1;                                                             \
+            }                                                                         \
+            link = &entry->next;                                                      \
+        }                                                                             \
+        return 0;                                                                     \
+    }
+
+HASHMAP_INT_IMPL(hashmap_u64, HashMapU64, HashMapU64Entry, uint64_t)
+HASHMAP_INT_IMPL(hashmap_u32, HashMapU32, HashMapU32Entry, uint32_t)
@@ -0,0 +1,366 @@
+#ifndef CHASHMAP_INTERNAL_H
+#define CHASHMAP_INTERNAL_H
+
+/*
+ * Helpers shared by the library's translation units. Not part of the public API.
+ */
+
+#include "../include/chashmap.h"
+#include "../include/chashmap_chain.h"
+
+#define DEFAULT_INITIAL_CAPACITY HASHMAP_DEFAULT_CAPACITY
+#define DEFAULT_LOAD_FACTOR HASHMAP_DEFAULT_LOAD_FACTOR
+
+/**
+ * Default equality function: byte-wise comparison.
+ */
+int hashmap_default_eq(const void *data1, const void *data2, size_t size);
+
+/**
+ * hashmap_chain_hash_t of a HashMapEntry; `map` is its HashMap.
+ */
+uint64_t hashmap_entry_hash(const void *entry, const void *map);
+
+/*
+ * Byte-keyed chains (HashMap, HashSet, HashMultiMap, HashCache, HashTTLMap).
+ * Their entries all hold a `HashMapData key`, a `size_t key_size` and a
+ * `next` link, at the offsets a HashChainLayout records.
+ */
+
+typedef struct
+{
+    size_t key;      // offsetof(entry, key)
+    size_t key_size; // offsetof(entry, key_size)
+    size_t next;     // offsetof(entry, next)
+} HashChainLayout;
+
+#define HASH_CHAIN_LAYOUT(EntryT) \
+    {offsetof(EntryT, key), offsetof(EntryT, key_size), offsetof(EntryT, next)}
+
+/**
+ * Key bytes of a byte-keyed entry; its size is stored in `*key_size`.
+ */
+static inline const void *hashmap_chain_key(HashChainLayout layout, const void *entry, size_t *key_size)
+{
+    const char *base = (const char *)entry;
+    *key_size = *(const size_t *)(base + layout.key_size);
+    return hashmap_data_bytes((const HashMapData *)(base + layout.key), *key_size);
+}
+
+/**
+ * Find the link pointing at the entry for a key in chain `index` (or at the
+ * chain's NULL end).
+ */
+static inline void **hashmap_chain_find_link(void **buckets, size_t index, HashChainLayout layout,
+                                             eq_func_t eq_func, const void *key_data, size_t key_size)
+{
+    void **link = &buckets[index];
+    while (*link)
+    {
+        size_t size;
+        const void *key = hashmap_chain_key(layout, *link, &size);
+        if (size == key_size && eq_func(key, key_data, key_size))
+            break;
+        link = hashmap_chain_next(*link, layout.next);
+    }
+    return link;
+}
+
+/**
+ * Copy `size` bytes from `src` into `data`, inline if they fit.
+ *   @return 0 on success, -1 on allocation failure.
+ */
+static inline int hashmap_data_store(HashMapData *data, const void *src, size_t size)
+{
+    if (size <= HASHMAP_INLINE_SIZE)
+    {
+        if (size > 0)
+            memcpy(data->bytes, src, size);
+        return 0;
+    }
+
+    data->ptr = malloc(size);
+    if (!data->ptr)
+        return -1;
+    memcpy(data->ptr, src, size);
+    return 0;
+}
+
+/**
+ * Free the heap copy behind `data`, if any.
+ */
+static inline void hashmap_data_release(HashMapData *data, size_t size)
+{
+    if (size > HASHMAP_INLINE_SIZE)
+    {
+        free(data->ptr);
+        data->ptr = NULL;
+    }
+}
+
+/*
+ * Slabs: one allocation holding many entries or key/value bytes
+ * (bulk loading). Slab-owned memory is only freed by hashmap_destroy().
+ */
+
+typedef struct HashMapSlab
+{
+    struct HashMapSlab *next;
+    size_t size;
+    _Alignas(max_align_t) unsigned char data[];
+} HashMapSlab;
+
+/**
+ * Allocate `size` bytes owned by `map` until hashmap_destroy().
+ *   @return The bytes, or NULL on allocation failure.
+ */
+void *hashmap_slab_alloc(HashMap *map, size_t size);
+
+/**
+ * Non-zero if `ptr` points into one of `map`'s slabs.
+ */
+int hashmap_slab_owns(const HashMap *map, const void *ptr);
+
+/*
+ * Membership filter (src/chashmap_filter.c): a blocked Bloom filter where
+ * each key sets HashMapFilter.k bits inside one 512-bit, cache-line-sized block.
+ */
+
+#define HASHMAP_FILTER_BLOCK_WORDS 8
+
+struct HashMapFilter
+{
+    uint64_t *blocks;      // nblocks * HASHMAP_FILTER_BLOCK_WORDS words
+    size_t nblocks;        // Number of blocks
+    unsigned k;            // Bits set per key
+    unsigned bits_per_key; // Requested density
+    size_t max_keys;       // Keys the filter was sized for
+    size_t keys;           // Keys added since the last build
+    size_t removed;        // Keys removed since the last build (their bits stay set)
+};
+
+/**
+ * Remix the map hash so that weak user hashes still spread over the filter.
+ */
+static inline uint64_t hashmap_filter_mix(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static inline uint64_t *hashmap_filter_block(const struct HashMapFilter *filter, uint64_t mixed)
+{
+    size_t block = (size_t)(((mixed >> 32) * (uint64_t)filter->nblocks) >> 32);
+    return &filter->blocks[block * HASHMAP_FILTER_BLOCK_WORDS];
+}
+
+/**
+ * 0 if the key with this hash is certainly absent, 1 if it may be present.
+ */
+static inline int hashmap_filter_may_contain(const struct HashMapFilter *filter, uint64_t hash)
+{
+    uint64_t mixed = hashmap_filter_mix(hash);
+    const uint64_t *block = hashmap_filter_block(filter, mixed);
+    uint64_t bits = mixed * 0x9E3779B97F4A7C15ULL;
+    for (unsigned i = 0; i < filter->k; i++, bits >>= 9)
+    {
+        unsigned bit = (unsigned)(bits & 511);
+        if (!(block[bit >> 6] & ((uint64_t)1 << (bit & 63))))
+            return 0;
+    }
+    return 1;
+}
+
+void hashmap_filter_note_insert(HashMap *map, uint64_t hash);
+void hashmap_filter_note_remove(HashMap *map);
+int hashmap_filter_rebuild(HashMap *map);
+
+/*
+ * Write-ahead log (src/chashmap_wal.c). hashmap_insert() and hashmap_remove()
+ * append their operation before applying it; a non-zero return fails the call.
+ */
+
+int hashmap_wal_note_insert(HashMap *map, const void *key, size_t key_size,
+                            const void *val, size_t val_size);
+int hashmap_wal_note_remove(HashMap *map, const void *key, size_t key_size);
+
+/*
+ * Online snapshot (src/chashmap_io.c). Must be called before bucket `index`
+ * is changed while map->snapshot is set.
+ */
+
+void hashmap_snapshot_note_write(HashMap *map, size_t index);
+
+/*
+ * Atomic file replacement (src/chashmap_io.c), used by every writer of a
+ * whole file: write to hashmap_temp_path(path), then hashmap_finish_file().
+ */
+
+/**
+ * "path" + ".tmp", or NULL on allocation failure. Caller frees.
+ */
+char *hashmap_temp_path(const char *path);
+
+/**
+ * Sync and close `fp` (open on `tmp_path`), then rename it over `path` and
+ * sync the directory if `status` is 0 and everything succeeded, or remove
+ * it otherwise.
+ *   @return 0 on success, -1 on failure.
+ */
+int hashmap_finish_file(FILE *fp, const char *tmp_path, const char *path, int status);
+
+/*
+ * Parallel rehash (src/chashmap_parallel.c). hashmap_resize() uses it when a
+ * table of at least HASHMAP_PARALLEL_RESIZE_MIN buckets doubles and
+ * map->resize_threads > 1.
+ */
+
+#define HASHMAP_PARALLEL_RESIZE_MIN 65536
+
+/**
+ * Relink every entry of `map` into `new_buckets` (2 * map->capacity buckets,
+ * all NULL), on up to map->resize_threads threads.
+ */
+void hashmap_rehash_parallel(HashMap *map, HashMapEntry **new_buckets);
+
+/*
+ * Instrumentation hooks (src/chashmap_instrument.c). With CHASHMAP_INSTRUMENT
+ * undefined they expand to nothing, or to a plain return.
+ *   HASHMAP_INSTR_BEGIN()                 start an operation (declares a local)
+ *   HASHMAP_INSTR_PROBE()                 one chain entry examined
+ *   HASHMAP_INSTR_ALLOCS(n)               n heap allocations made
+ *   HASHMAP_INSTR_RETURN(op, hit, value)  record the operation and return value
+ */
+
+#ifdef CHASHMAP_INSTRUMENT
+
+#include <stdatomic.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "../include/chashmap_instrument.h"
+
+typedef struct
+{
+    _Atomic uint64_t calls;
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+    _Atomic uint64_t probes;
+    _Atomic uint64_t allocs;
+    _Atomic uint64_t samples;
+    _Atomic uint64_t latency[HASHMAP_LATENCY_SLOTS];
+} HashMapInstrOp;
+
+/**
+ * One thread's counters. Only the owning thread writes them (with relaxed
+ * load/store pairs, which compile to plain adds); readers sum them.
+ */
+typedef struct HashMapInstrThread
+{
+    HashMapInstrOp ops[HASHMAP_OP_COUNT];
+    uint64_t pending_probes; // Probes of the operation in progress
+    uint64_t pending_allocs; // Allocations of the operation in progress
+    unsigned countdown;      // Sampling phase
+    struct HashMapInstrThread *next;
+    struct HashMapInstrThread *prev;
+} HashMapInstrThread;
+
+extern _Thread_local HashMapInstrThread *hashmap_instr_tls;
+
+/**
+ * Register the calling thread's counters. Returns NULL on allocation failure.
+ */
+HashMapInstrThread *hashmap_instr_thread_init(void);
+
+static inline uint64_t hashmap_instr_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline size_t hashmap_latency_slot(uint64_t ticks)
+{
+    if (ticks < 16)
+        return (size_t)ticks;
+    unsigned e = 63 - (unsigned)__builtin_clzll(ticks);
+    return 16 + (size_t)(e - 4) * 8 + (size_t)((ticks >> (e - 3)) & 7);
+}
+
+static inline void hashmap_instr_add(_Atomic uint64_t *counter, uint64_t n)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+/**
+ * Start an operation; returns its start time if it is sampled, else 0.
+ */
+static inline uint64_t hashmap_instr_begin(void)
+{
+    HashMapInstrThread *t = hashmap_instr_tls ? hashmap_instr_tls : hashmap_instr_thread_init();
+    if (!t)
+        return 0;
+    t->pending_probes = 0;
+    t->pending_allocs = 0;
+    if (++t->countdown & (CHASHMAP_INSTRUMENT_SAMPLE - 1))
+        return 0;
+    return hashmap_instr_ticks();
+}
+
+static inline void hashmap_instr_end(HashMapOp op, uint64_t start, int hit)
+{
+    HashMapInstrThread *t = hashmap_instr_tls;
+    if (!t)
+        return;
+    HashMapInstrOp *c = &t->ops[op];
+    if (start)
+    {
+        hashmap_instr_add(&c->latency[hashmap_latency_slot(hashmap_instr_ticks() - start)], 1);
+        hashmap_instr_add(&c->samples, 1);
+    }
+    hashmap_instr_add(&c->calls, 1);
+    hashmap_instr_add(hit ? &c->hits : &c->misses, 1);
+    hashmap_instr_add(&c->probes, t->pending_probes);
+    hashmap_instr_add(&c->allocs, t->pending_allocs);
+}
+
+#define HASHMAP_INSTR_BEGIN() uint64_t hashmap_instr_start_ = hashmap_instr_begin()
+#define HASHMAP_INSTR_PROBE()                    \
+    do                                           \
+    {                                            \
+        if (hashmap_instr_tls)                   \
+            hashmap_instr_tls->pending_probes++; \
+    } while (0)
+#define HASHMAP_INSTR_ALLOCS(n)                       \
+    do                                                \
+    {                                                 \
+        if (hashmap_instr_tls)                        \
+            hashmap_instr_tls->pending_allocs += (n); \
+    } while (0)
+#define HASHMAP_INSTR_RETURN(op, hit, value)                  \
+    do                                                        \
+    {                                                         \
+        hashmap_instr_end((op), hashmap_instr_start_, (hit)); \
+        return (value);                                       \
+    } while (0)
+
+#else
+
+#define HASHMAP_INSTR_BEGIN() ((void)0)
+#define HASHMAP_INSTR_PROBE() ((void)0)
+#define HASHMAP_INSTR_ALLOCS(n) ((void)0)
+#define HASHMAP_INSTR_RETURN(op, hit, value) return (value)
+
+#endif // CHASHMAP_INSTRUMENT
+
+#endif // CHASHMAP_INTERNAL_H
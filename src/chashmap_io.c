@@ -0,0 +1,545 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/chashmap.h"
+#include "chashmap_internal.h"
+
+/*
+ * File layout (version 1, host byte order):
+ *   HashMapFileHeader
+ *   count records of: uint64 hash, LEB128 key size, LEB128 value size,
+ *                     key bytes, value bytes
+ * The header carries the total out-of-line key and value bytes so the loader
+ * can size its slabs before reading any record.
+ */
+
+#define HASHMAP_FILE_MAGIC "CHASHMAP"
+#define HASHMAP_FILE_VERSION 1u
+#define HASHMAP_FILE_BYTE_ORDER 0x01020304u
+#define HASHMAP_FILE_BUFFER (1u << 16)
+#define HASHMAP_HASH_SAMPLE 16 // Stored hashes checked against hash_func on load
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t count;
+    uint64_t capacity;
+    float load_factor;
+    uint32_t reserved;
+    uint64_t key_bytes;   // Sum of key sizes above HASHMAP_INLINE_SIZE
+    uint64_t value_bytes; // Sum of value sizes above HASHMAP_INLINE_SIZE
+} HashMapFileHeader;
+
+static int write_varint(FILE *fp, uint64_t v)
+{
+    unsigned char buf[10];
+    size_t n = 0;
+    do
+    {
+        unsigned char byte = (unsigned char)(v & 0x7F);
+        v >>= 7;
+        buf[n++] = byte | (v ? 0x80 : 0);
+    } while (v);
+    return fwrite(buf, 1, n, fp) == n ? 0 : -1;
+}
+
+static int read_varint(FILE *fp, uint64_t *out)
+{
+    uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7)
+    {
+        int c = getc(fp);
+        if (c == EOF)
+            return -1;
+        v |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80))
+        {
+            *out = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int write_entry(FILE *fp, const HashMap *map, const HashMapEntry *entry)
+{
+    const void *key = hashmap_entry_key(entry);
+    uint64_t hash = map->hash_func(key, entry->key_size);
+    if (fwrite(&hash, sizeof(hash), 1, fp) != 1 ||
+        write_varint(fp, entry->key_size) != 0 ||
+        write_varint(fp, entry->value_size) != 0)
+        return -1;
+    if (fwrite(key, 1, entry->key_size, fp) != entry->key_size)
+        return -1;
+    if (entry->value_size &&
+        fwrite(hashmap_entry_value(entry), 1, entry->value_size, fp) != entry->value_size)
+        return -1;
+    return 0;
+}
+
+static void init_header(HashMapFileHeader *header, const HashMap *map)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, HASHMAP_FILE_MAGIC, sizeof(header->magic));
+    header->version = HASHMAP_FILE_VERSION;
+    header->byte_order = HASHMAP_FILE_BYTE_ORDER;
+    header->count = map->size;
+    header->capacity = map->capacity;
+    header->load_factor = map->load_factor;
+}
+
+static void count_entry_bytes(HashMapFileHeader *header, const HashMapEntry *entry)
+{
+    if (entry->key_size > HASHMAP_INLINE_SIZE)
+        header->key_bytes += entry->key_size;
+    if (entry->value_size > HASHMAP_INLINE_SIZE)
+        header->value_bytes += entry->value_size;
+}
+
+char *hashmap_temp_path(const char *path)
+{
+    size_t path_len = strlen(path);
+    char *tmp_path = (char *)malloc(path_len + 5);
+    if (tmp_path)
+    {
+        memcpy(tmp_path, path, path_len);
+        memcpy(tmp_path + path_len, ".tmp", 5);
+    }
+    return tmp_path;
+}
+
+/**
+ * fsync the directory holding `path`, making a rename into it durable.
+ */
+static int sync_parent_dir(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    size_t len = slash ? (size_t)(slash - path) : 1;
+    if (slash == path)
+        len = 1; // the root directory
+    char *dir = (char *)malloc(len + 1);
+    if (!dir)
+        return -1;
+    memcpy(dir, slash ? path : ".", len);
+    dir[len] = '\0';
+
+    int status = -1;
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0)
+    {
+        status = (fsync(fd) == 0) ? 0 : -1;
+        close(fd);
+    }
+    free(dir);
+    return status;
+}
+
+int hashmap_finish_file(FILE *fp, const char *tmp_path, const char *path, int status)
+{
+    // Make the data durable before it replaces the old file
+    if (status == 0 && (fflush(fp) != 0 || fsync(fileno(fp)) != 0))
+        status = -1;
+    if (fclose(fp) != 0)
+        status = -1;
+    if (status == 0 && rename(tmp_path, path) != 0)
+        status = -1;
+    if (status != 0)
+    {
+        remove(tmp_path);
+        return status;
+    }
+    // ... and the rename durable before callers rely on it (e.g. a WAL
+    // checkpoint truncating the log the new file replaces)
+    return sync_parent_dir(path);
+}
+
+int hashmap_save(const HashMap *map, const char *path)
+{
+    if (!map || !map->buckets || !path)
+        return -1;
+
+    HashMapFileHeader header;
+    init_header(&header, map);
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        for (const HashMapEntry *entry = map->buckets[i]; entry; entry = entry->next)
+            count_entry_bytes(&header, entry);
+    }
+
+    char *tmp_path = hashmap_temp_path(path);
+    if (!tmp_path)
+        return -1;
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp)
+    {
+        free(tmp_path);
+        return -1;
+    }
+    setvbuf(fp, NULL, _IOFBF, HASHMAP_FILE_BUFFER);
+
+    int status = fwrite(&header, sizeof(header), 1, fp) == 1 ? 0 : -1;
+    for (size_t i = 0; i < map->capacity && status == 0; i++)
+    {
+        for (const HashMapEntry *entry = map->buckets[i]; entry && status == 0; entry = entry->next)
+            status = write_entry(fp, map, entry);
+    }
+
+    status = hashmap_finish_file(fp, tmp_path, path, status);
+    free(tmp_path);
+    return status;
+}
+
+/**
+ * Read `size` bytes of a key or value into `data`, taking out-of-line
+ * storage from `*pool` (which holds `*left` bytes).
+ */
+static int read_data(FILE *fp, HashMapData *data, size_t size,
+                     unsigned char **pool, uint64_t *left)
+{
+    unsigned char *dst = data->bytes;
+    if (size > HASHMAP_INLINE_SIZE)
+    {
+        if (size > *left)
+            return -1; // More bytes than the header announced
+        dst = *pool;
+        data->ptr = dst;
+        *pool += size;
+        *left -= size;
+    }
+    return fread(dst, 1, size, fp) == size ? 0 : -1;
+}
+
+/**
+ * Rebuild every chain from hash_func; used when the stored hashes are stale.
+ */
+static void relink_all(HashMap *map, HashMapEntry *entries, size_t count)
+{
+    memset(map->buckets, 0, map->capacity * sizeof(HashMapEntry *));
+    for (size_t i = 0; i < count; i++)
+    {
+        HashMapEntry *entry = &entries[i];
+        uint64_t hash = map->hash_func(hashmap_entry_key(entry), entry->key_size);
+        size_t index = hashmap_chain_index(hash, map->capacity);
+        entry->next = map->buckets[index];
+        map->buckets[index] = entry;
+    }
+}
+
+static int load_entries(HashMap *map, FILE *fp, const HashMapFileHeader *header)
+{
+    size_t count = (size_t)header->count;
+    if (count == 0)
+        return 0;
+
+    HashMapEntry *entries = (HashMapEntry *)hashmap_slab_alloc(map, count * sizeof(HashMapEntry));
+    if (!entries)
+        return -1;
+
+    unsigned char *key_pool = NULL;
+    unsigned char *value_pool = NULL;
+    uint64_t key_left = header->key_bytes;
+    uint64_t value_left = header->value_bytes;
+    if (key_left + value_left > 0)
+    {
+        key_pool = (unsigned char *)hashmap_slab_alloc(map, (size_t)(key_left + value_left));
+        if (!key_pool)
+            return -1;
+        value_pool = key_pool + key_left;
+    }
+
+    int stale = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        HashMapEntry *entry = &entries[i];
+        uint64_t hash, key_size, value_size;
+        if (fread(&hash, sizeof(hash), 1, fp) != 1 ||
+            read_varint(fp, &key_size) != 0 || read_varint(fp, &value_size) != 0 ||
+            key_size == 0)
+            return -1;
+
+        entry->key_size = (size_t)key_size;
+        entry->value_size = (size_t)value_size;
+        if (read_data(fp, &entry->key, entry->key_size, &key_pool, &key_left) != 0 ||
+            read_data(fp, &entry->value, entry->value_size, &value_pool, &value_left) != 0)
+            return -1;
+
+        // A file saved with another hash function would put keys in the wrong chains
+        if (i < HASHMAP_HASH_SAMPLE && !stale &&
+            map->hash_func(hashmap_entry_key(entry), entry->key_size) != hash)
+            stale = 1;
+
+        size_t index = hashmap_chain_index(hash, map->capacity);
+        entry->next = map->buckets[index];
+        map->buckets[index] = entry;
+        map->size++;
+    }
+
+    if (stale)
+        relink_all(map, entries, count);
+    return 0;
+}
+
+int hashmap_load(HashMap *map, const char *path,
+                 hash_func_t hash_func, eq_func_t eq_func)
+{
+    if (!map || !path)
+        return -1;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+    setvbuf(fp, NULL, _IOFBF, HASHMAP_FILE_BUFFER);
+
+    HashMapFileHeader header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, HASHMAP_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != HASHMAP_FILE_VERSION ||
+        header.byte_order != HASHMAP_FILE_BYTE_ORDER ||
+        header.count > SIZE_MAX / sizeof(HashMapEntry) ||
+        header.key_bytes + header.value_bytes > SIZE_MAX / 2)
+    {
+        fclose(fp);
+        return -1;
+    }
+
+    // Presize so that no insert into the loaded map triggers an early resize
+    float load_factor = header.load_factor > 0.0f ? header.load_factor : DEFAULT_LOAD_FACTOR;
+    size_t capacity = (size_t)header.capacity;
+    size_t needed = (size_t)((double)header.count / load_factor) + 1;
+    if (capacity < needed)
+        capacity = needed;
+
+    if (hashmap_init(map, capacity, hash_func, eq_func, load_factor) != 0)
+    {
+        fclose(fp);
+        return -1;
+    }
+
+    int status = load_entries(map, fp, &header);
+    fclose(fp);
+    if (status != 0)
+    {
+        // Entries linked so far live in the slabs, so destroy frees everything
+        hashmap_destroy(map);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Online snapshots. The snapshot is a hashmap_save() file of the map as it
+ * was when hashmap_snapshot_begin() ran. A background thread copies buckets
+ * into a buffer and streams it to disk. A writer that is about to change a
+ * bucket the thread has not reached yet copies that bucket first, so each
+ * bucket is captured exactly once, before its first change. Resizing is
+ * deferred until the snapshot ends, which keeps bucket indices stable.
+ */
+
+#define SNAPSHOT_FLUSH_BYTES (1u << 20)
+
+struct HashMapSnapshot
+{
+    HashMap *map;
+    pthread_t thread;
+    int has_thread;
+    pthread_mutex_t lock;
+    atomic_uchar *copied;     // copied[i] != 0 once bucket i is in `buf`
+    size_t capacity;          // Bucket count when the snapshot began
+    unsigned char *buf;       // Encoded records not yet written
+    size_t len, cap;
+    HashMapFileHeader header; // Byte totals are filled in as buckets are copied
+    FILE *fp;
+    char *path;
+    char *tmp_path;
+    int error;
+    int status;               // Result of the snapshot, once the thread is done
+};
+
+static size_t encode_varint(unsigned char *out, uint64_t v)
+{
+    size_t n = 0;
+    do
+    {
+        unsigned char byte = (unsigned char)(v & 0x7F);
+        v >>= 7;
+        out[n++] = byte | (v ? 0x80 : 0);
+    } while (v);
+    return n;
+}
+
+/**
+ * Append the records of bucket `index` to the snapshot buffer and mark it
+ * copied. Called with snapshot->lock held.
+ */
+static void snapshot_copy_bucket(struct HashMapSnapshot *snap, size_t index)
+{
+    const HashMap *map = snap->map;
+    for (const HashMapEntry *entry = map->buckets[index]; entry && !snap->error; entry = entry->next)
+    {
+        size_t need = sizeof(uint64_t) + 20 + entry->key_size + entry->value_size;
+        if (snap->len + need > snap->cap)
+        {
+            size_t cap = snap->cap ? snap->cap : SNAPSHOT_FLUSH_BYTES;
+            while (cap < snap->len + need)
+                cap *= 2;
+            unsigned char *buf = (unsigned char *)realloc(snap->buf, cap);
+            if (!buf)
+            {
+                snap->error = 1;
+                break;
+            }
+            snap->buf = buf;
+            snap->cap = cap;
+        }
+
+        const void *key = hashmap_entry_key(entry);
+        uint64_t hash = map->hash_func(key, entry->key_size);
+        unsigned char *out = snap->buf + snap->len;
+        memcpy(out, &hash, sizeof(hash));
+        out += sizeof(hash);
+        out += encode_varint(out, entry->key_size);
+        out += encode_varint(out, entry->value_size);
+        memcpy(out, key, entry->key_size);
+        out += entry->key_size;
+        if (entry->value_size)
+            memcpy(out, hashmap_entry_value(entry), entry->value_size);
+        out += entry->value_size;
+        snap->len = (size_t)(out - snap->buf);
+        count_entry_bytes(&snap->header, entry);
+    }
+    atomic_store_explicit(&snap->copied[index], 1, memory_order_release);
+}
+
+/**
+ * Write out the buffered records. Called with snapshot->lock held; the
+ * lock is dropped during the write so writers are not blocked by I/O.
+ */
+static void snapshot_drain(struct HashMapSnapshot *snap, unsigned char **spare, size_t *spare_cap)
+{
+    unsigned char *data = snap->buf;
+    size_t len = snap->len;
+    size_t cap = snap->cap;
+    snap->buf = *spare;
+    snap->cap = *spare_cap;
+    snap->len = 0;
+    pthread_mutex_unlock(&snap->lock);
+
+    int failed = len && fwrite(data, 1, len, snap->fp) != len;
+
+    pthread_mutex_lock(&snap->lock);
+    if (failed)
+        snap->error = 1;
+    *spare = data;
+    *spare_cap = cap;
+}
+
+static void *snapshot_thread(void *arg)
+{
+    struct HashMapSnapshot *snap = (struct HashMapSnapshot *)arg;
+    unsigned char *spare = NULL;
+    size_t spare_cap = 0;
+
+    pthread_mutex_lock(&snap->lock);
+    for (size_t i = 0; i < snap->capacity && !snap->error; i++)
+    {
+        if (!atomic_load_explicit(&snap->copied[i], memory_order_relaxed))
+            snapshot_copy_bucket(snap, i);
+        if (snap->len >= SNAPSHOT_FLUSH_BYTES)
+            snapshot_drain(snap, &spare, &spare_cap);
+    }
+    snapshot_drain(snap, &spare, &spare_cap);
+    int status = snap->error ? -1 : 0;
+    HashMapFileHeader header = snap->header;
+    pthread_mutex_unlock(&snap->lock);
+    free(spare);
+
+    // Every bucket is copied now, so the byte totals in the header are final
+    if (status == 0 && (fseek(snap->fp, 0, SEEK_SET) != 0 ||
+                        fwrite(&header, sizeof(header), 1, snap->fp) != 1))
+        status = -1;
+    snap->status = hashmap_finish_file(snap->fp, snap->tmp_path, snap->path, status);
+    snap->fp = NULL;
+    return NULL;
+}
+
+int hashmap_snapshot_begin(HashMap *map, const char *path)
+{
+    if (!map || !map->buckets || !path || map->snapshot)
+        return -1;
+
+    struct HashMapSnapshot *snap = (struct HashMapSnapshot *)calloc(1, sizeof(struct HashMapSnapshot));
+    if (!snap)
+        return -1;
+    snap->map = map;
+    snap->capacity = map->capacity;
+    snap->copied = (atomic_uchar *)calloc(map->capacity, sizeof(atomic_uchar));
+    snap->path = (char *)malloc(strlen(path) + 1);
+    snap->tmp_path = hashmap_temp_path(path);
+    if (snap->copied && snap->path && snap->tmp_path)
+    {
+        strcpy(snap->path, path);
+        snap->fp = fopen(snap->tmp_path, "wb");
+    }
+    init_header(&snap->header, map);
+
+    // The header is rewritten with the byte totals at the end
+    if (!snap->fp || fwrite(&snap->header, sizeof(snap->header), 1, snap->fp) != 1 ||
+        pthread_mutex_init(&snap->lock, NULL) != 0)
+    {
+        if (snap->fp)
+        {
+            fclose(snap->fp);
+            remove(snap->tmp_path);
+        }
+        free(snap->copied);
+        free(snap->path);
+        free(snap->tmp_path);
+        free(snap);
+        return -1;
+    }
+    setvbuf(snap->fp, NULL, _IOFBF, HASHMAP_FILE_BUFFER);
+
+    map->snapshot = snap;
+    if (pthread_create(&snap->thread, NULL, snapshot_thread, snap) == 0)
+        snap->has_thread = 1;
+    else
+        snapshot_thread(snap); // No thread: take the snapshot synchronously instead
+    return 0;
+}
+
+void hashmap_snapshot_note_write(HashMap *map, size_t index)
+{
+    struct HashMapSnapshot *snap = map->snapshot;
+    if (index >= snap->capacity ||
+        atomic_load_explicit(&snap->copied[index], memory_order_acquire))
+        return;
+    pthread_mutex_lock(&snap->lock);
+    if (!atomic_load_explicit(&snap->copied[index], memory_order_relaxed))
+        snapshot_copy_bucket(snap, index);
+    pthread_mutex_unlock(&snap->lock);
+}
+
+int hashmap_snapshot_wait(HashMap *map)
+{
+    if (!map || !map->snapshot)
+        return -1;
+    struct HashMapSnapshot *snap = map->snapshot;
+    if (snap->has_thread)
+        pthread_join(snap->thread, NULL);
+    int status = snap->status;
+
+    pthread_mutex_destroy(&snap->lock);
+    free(snap->copied);
+    free(snap->buf);
+    free(snap->path);
+    free(snap->tmp_path);
+    free(snap);
+    map->snapshot = NULL;
+    return status;
+}
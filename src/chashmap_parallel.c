@@ -0,0 +1,562 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/chashmap.h"
+#include "chashmap_internal.h"
+
+/*
+ * Multithreaded bulk building (hashmap_build_bulk) and rehashing (see below).
+ *
+ * The build runs in phases, each one split into tasks that the threads take
+ * from a shared counter:
+ *  1. hash every key (chunks of BULK_CHUNK pairs);
+ *  2. count, per input slice, how many pairs fall in each partition, where a
+ *     partition is a contiguous range of buckets;
+ *  3. scatter pair indices by partition, keeping input order within each;
+ *  4. per partition, find repeated keys: the first occurrence makes the
+ *     entry, the last one gives its value;
+ *  5. per partition, copy keys and values into a shared slab and link the
+ *     entries into their buckets. No other partition touches those buckets.
+ * The bucket count is the one serial inserts would reach. It is first worked
+ * out as if all keys were distinct; if repeats make it smaller, the distinct
+ * keys are scattered again for the smaller table.
+ */
+
+#define BULK_MIN_PARALLEL 65536 // Smaller inputs go through hashmap_insert()
+#define BULK_CHUNK 16384
+#define BULK_SLICES_PER_THREAD 2
+#define BULK_PARTITIONS_PER_THREAD 16
+#define BULK_NONE UINT32_MAX
+
+typedef struct
+{
+    HashMap *map;
+    const void *const *keys;
+    const size_t *key_sizes;
+    const void *const *vals;
+    const size_t *val_sizes;
+    size_t n;
+    uint64_t *hashes;         // hashes[i] = hash of keys[i]
+    uint32_t *winner;         // First occurrence: pair holding its value; repeats: BULK_NONE
+    uint32_t *order;          // Pair indices grouped by partition
+    size_t *counts;           // nslices * npartitions histogram, then scatter cursors
+    size_t *part_start;       // npartitions + 1 offsets into order
+    size_t nslices;
+    size_t npartitions;
+    size_t capacity;          // Bucket count the partitions divide
+    int distinct_only;        // Scatter only first occurrences
+    size_t table_size;        // Per-thread dedupe table (power of two)
+    HashMapEntry **buckets;
+    HashMapEntry *entries;    // Slab space for all entries
+    unsigned char *pool;      // Slab space for out-of-line keys and values
+    atomic_size_t entry_next; // Entries handed out so far
+    atomic_size_t pool_next;  // Pool bytes handed out so far
+    atomic_size_t distinct;   // Distinct keys
+    atomic_size_t pool_bytes; // Out-of-line bytes the distinct keys need
+    size_t nthreads;
+    atomic_size_t next;       // Next task of the current phase
+    atomic_int error;
+} BulkJob;
+
+typedef void (*bulk_task_t)(BulkJob *job, size_t task, uint32_t *table);
+
+typedef struct
+{
+    BulkJob *job;
+    bulk_task_t task;
+    size_t ntasks;
+} BulkPhase;
+
+static void *bulk_worker(void *arg)
+{
+    BulkPhase *phase = (BulkPhase *)arg;
+    BulkJob *job = phase->job;
+    uint32_t *table = NULL;
+    if (job->table_size)
+    {
+        table = (uint32_t *)malloc(job->table_size * sizeof(uint32_t));
+        if (!table)
+        {
+            atomic_store(&job->error, 1);
+            return NULL;
+        }
+    }
+    for (;;)
+    {
+        size_t task = atomic_fetch_add(&job->next, 1);
+        if (task >= phase->ntasks || atomic_load(&job->error))
+            break;
+        phase->task(job, task, table);
+    }
+    free(table);
+    return NULL;
+}
+
+/**
+ * Run tasks [0, ntasks) on the calling thread and job->nthreads - 1 helpers.
+ */
+static void bulk_run(BulkJob *job, bulk_task_t task, size_t ntasks)
+{
+    BulkPhase phase = {job, task, ntasks};
+    pthread_t *threads = NULL;
+    size_t started = 0;
+    atomic_store(&job->next, 0);
+    if (job->nthreads > 1)
+        threads = (pthread_t *)malloc((job->nthreads - 1) * sizeof(pthread_t));
+    for (size_t i = 0; threads && i + 1 < job->nthreads && i + 1 < ntasks; i++)
+    {
+        if (pthread_create(&threads[started], NULL, bulk_worker, &phase) != 0)
+            break; // The threads that did start share the work
+        started++;
+    }
+    bulk_worker(&phase);
+    for (size_t i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+}
+
+/**
+ * Smallest size at which hashmap_insert() grows a table of `capacity` buckets.
+ */
+static size_t bulk_grow_size(size_t capacity, float load_factor)
+{
+    size_t size = (size_t)((double)load_factor * (double)capacity);
+    while (size > 0 && (float)(size - 1) / (float)capacity >= load_factor)
+        size--;
+    while ((float)size / (float)capacity < load_factor)
+        size++;
+    return size;
+}
+
+/**
+ * Bucket count after hashmap_insert() of the n pairs into the empty map.
+ * Every call checks the load before inserting, repeats included; `winner`
+ * tells repeats apart (NULL: all keys distinct).
+ */
+static size_t bulk_capacity(const HashMap *map, size_t n, const uint32_t *winner)
+{
+    size_t capacity = map->capacity;
+    size_t grow = bulk_grow_size(capacity, map->load_factor);
+    if (!winner)
+    {
+        // Call i sees size i: jump from one growth to the next
+        for (size_t i = 0;;)
+        {
+            if (i < grow)
+                i = grow;
+            if (i >= n)
+                return capacity;
+            capacity *= 2;
+            grow = bulk_grow_size(capacity, map->load_factor);
+            i++;
+        }
+    }
+    size_t size = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (size >= grow)
+        {
+            capacity *= 2;
+            grow = bulk_grow_size(capacity, map->load_factor);
+        }
+        size += winner[i] != BULK_NONE;
+    }
+    return capacity;
+}
+
+static inline size_t bulk_partition(const BulkJob *job, uint64_t hash)
+{
+    return (size_t)((hash % job->capacity) * job->npartitions / job->capacity);
+}
+
+static inline int bulk_scattered(const BulkJob *job, size_t i)
+{
+    return !job->distinct_only || job->winner[i] != BULK_NONE;
+}
+
+static void bulk_slice(const BulkJob *job, size_t slice, size_t *start, size_t *end)
+{
+    *start = job->n * slice / job->nslices;
+    *end = job->n * (slice + 1) / job->nslices;
+}
+
+static void bulk_hash_task(BulkJob *job, size_t chunk, uint32_t *table)
+{
+    (void)table;
+    size_t start = chunk * BULK_CHUNK;
+    size_t end = start + BULK_CHUNK < job->n ? start + BULK_CHUNK : job->n;
+    for (size_t i = start; i < end; i++)
+    {
+        if (!job->keys[i] || job->key_sizes[i] == 0 || (!job->vals[i] && job->val_sizes[i] > 0))
+        {
+            atomic_store(&job->error, 1);
+            return;
+        }
+        job->hashes[i] = job->map->hash_func(job->keys[i], job->key_sizes[i]);
+    }
+}
+
+static void bulk_count_task(BulkJob *job, size_t slice, uint32_t *table)
+{
+    (void)table;
+    size_t start, end;
+    size_t *counts = &job->counts[slice * job->npartitions];
+    bulk_slice(job, slice, &start, &end);
+    memset(counts, 0, job->npartitions * sizeof(size_t));
+    for (size_t i = start; i < end; i++)
+    {
+        if (bulk_scattered(job, i))
+            counts[bulk_partition(job, job->hashes[i])]++;
+    }
+}
+
+static void bulk_scatter_task(BulkJob *job, size_t slice, uint32_t *table)
+{
+    (void)table;
+    size_t start, end;
+    size_t *cursor = &job->counts[slice * job->npartitions];
+    bulk_slice(job, slice, &start, &end);
+    for (size_t i = start; i < end; i++)
+    {
+        if (bulk_scattered(job, i))
+            job->order[cursor[bulk_partition(job, job->hashes[i])]++] = (uint32_t)i;
+    }
+}
+
+/**
+ * Group the pairs by partition of a `capacity`-bucket table. Slices are
+ * contiguous and their cursors ordered, so each group stays in input order.
+ *   @return The size of the largest partition.
+ */
+static size_t bulk_scatter(BulkJob *job, size_t capacity, int distinct_only)
+{
+    job->capacity = capacity;
+    job->distinct_only = distinct_only;
+    bulk_run(job, bulk_count_task, job->nslices);
+
+    size_t offset = 0, largest = 0;
+    for (size_t p = 0; p < job->npartitions; p++)
+    {
+        job->part_start[p] = offset;
+        for (size_t s = 0; s < job->nslices; s++)
+        {
+            size_t count = job->counts[s * job->npartitions + p];
+            job->counts[s * job->npartitions + p] = offset;
+            offset += count;
+        }
+        if (offset - job->part_start[p] > largest)
+            largest = offset - job->part_start[p];
+    }
+    job->part_start[job->npartitions] = offset;
+
+    bulk_run(job, bulk_scatter_task, job->nslices);
+    return largest;
+}
+
+static inline size_t bulk_out_of_line(size_t size)
+{
+    return size > HASHMAP_INLINE_SIZE ? size : 0;
+}
+
+/**
+ * Mark repeated keys of one partition, using `table` (job->table_size slots
+ * of pair index + 1) as an open-addressing set of the keys seen so far.
+ */
+static void bulk_dedupe_task(BulkJob *job, size_t p, uint32_t *table)
+{
+    size_t mask = job->table_size - 1;
+    size_t distinct = 0, bytes = 0;
+    memset(table, 0, job->table_size * sizeof(uint32_t));
+    for (size_t k = job->part_start[p]; k < job->part_start[p + 1]; k++)
+    {
+        uint32_t i = job->order[k];
+        uint64_t hash = job->hashes[i];
+        size_t slot = (size_t)hashmap_filter_mix(hash) & mask;
+        for (;; slot = (slot + 1) & mask)
+        {
+            if (table[slot] == 0)
+            {
+                table[slot] = i + 1;
+                job->winner[i] = i;
+                distinct++;
+                break;
+            }
+            uint32_t first = table[slot] - 1;
+            if (job->hashes[first] == hash && job->key_sizes[first] == job->key_sizes[i] &&
+                job->map->eq_func(job->keys[first], job->keys[i], job->key_sizes[i]))
+            {
+                job->winner[first] = i;
+                job->winner[i] = BULK_NONE;
+                break;
+            }
+        }
+    }
+    for (size_t k = job->part_start[p]; k < job->part_start[p + 1]; k++)
+    {
+        uint32_t i = job->order[k];
+        if (job->winner[i] != BULK_NONE)
+            bytes += bulk_out_of_line(job->key_sizes[i]) + bulk_out_of_line(job->val_sizes[job->winner[i]]);
+    }
+    atomic_fetch_add(&job->distinct, distinct);
+    atomic_fetch_add(&job->pool_bytes, bytes);
+}
+
+static unsigned char *bulk_copy(HashMapData *data, const void *src, size_t size, unsigned char *pool)
+{
+    unsigned char *dst = data->bytes;
+    if (size > HASHMAP_INLINE_SIZE)
+    {
+        data->ptr = pool;
+        dst = pool;
+        pool += size;
+    }
+    if (size > 0)
+        memcpy(dst, src, size);
+    return pool;
+}
+
+/**
+ * Create and link the entries of one partition. Entries are pushed on their
+ * chains in input order, as hashmap_insert() would.
+ */
+static void bulk_link_task(BulkJob *job, size_t p, uint32_t *table)
+{
+    (void)table;
+    size_t count = 0, bytes = 0;
+    for (size_t k = job->part_start[p]; k < job->part_start[p + 1]; k++)
+    {
+        uint32_t i = job->order[k];
+        if (job->winner[i] == BULK_NONE)
+            continue;
+        count++;
+        bytes += bulk_out_of_line(job->key_sizes[i]) + bulk_out_of_line(job->val_sizes[job->winner[i]]);
+    }
+    HashMapEntry *entry = &job->entries[atomic_fetch_add(&job->entry_next, count)];
+    unsigned char *pool = job->pool + atomic_fetch_add(&job->pool_next, bytes);
+
+    for (size_t k = job->part_start[p]; k < job->part_start[p + 1]; k++)
+    {
+        uint32_t i = job->order[k];
+        uint32_t w = job->winner[i];
+        if (w == BULK_NONE)
+            continue;
+        entry->key_size = job->key_sizes[i];
+        entry->value_size = job->val_sizes[w];
+        pool = bulk_copy(&entry->key, job->keys[i], entry->key_size, pool);
+        pool = bulk_copy(&entry->value, job->vals[w], entry->value_size, pool);
+        size_t index = job->hashes[i] % job->capacity;
+        entry->next = job->buckets[index];
+        job->buckets[index] = entry;
+        entry++;
+    }
+}
+
+static int bulk_valid(const void *const *keys, const size_t *key_sizes,
+                      const void *const *vals, const size_t *val_sizes, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!keys[i] || key_sizes[i] == 0 || (!vals[i] && val_sizes[i] > 0))
+            return 0;
+    }
+    return 1;
+}
+
+static int bulk_build(BulkJob *job)
+{
+    HashMap *map = job->map;
+    size_t n = job->n;
+    bulk_run(job, bulk_hash_task, (n + BULK_CHUNK - 1) / BULK_CHUNK);
+    if (atomic_load(&job->error))
+        return -1;
+
+    // Partition for the table all-distinct keys would need, then find repeats
+    size_t capacity = bulk_capacity(map, n, NULL);
+    size_t largest = bulk_scatter(job, capacity, 0);
+    job->table_size = 2;
+    while (job->table_size < largest * 2)
+        job->table_size *= 2;
+    bulk_run(job, bulk_dedupe_task, job->npartitions);
+    job->table_size = 0;
+    if (atomic_load(&job->error))
+        return -1;
+
+    size_t distinct = atomic_load(&job->distinct);
+    if (distinct < n)
+    {
+        size_t final_capacity = bulk_capacity(map, n, job->winner);
+        if (final_capacity != capacity)
+            bulk_scatter(job, final_capacity, 1);
+    }
+
+    job->buckets = map->buckets;
+    if (job->capacity != map->capacity)
+    {
+        job->buckets = (HashMapEntry **)calloc(job->capacity, sizeof(HashMapEntry *));
+        if (!job->buckets)
+            return -1;
+    }
+    size_t pool_bytes = atomic_load(&job->pool_bytes);
+    unsigned char *slab = (unsigned char *)hashmap_slab_alloc(map, distinct * sizeof(HashMapEntry) + pool_bytes);
+    if (!slab)
+    {
+        if (job->buckets != map->buckets)
+            free(job->buckets);
+        return -1;
+    }
+    job->entries = (HashMapEntry *)slab;
+    job->pool = slab + distinct * sizeof(HashMapEntry);
+    bulk_run(job, bulk_link_task, job->npartitions);
+
+    if (job->buckets != map->buckets)
+    {
+        free(map->buckets);
+        map->buckets = job->buckets;
+        map->capacity = job->capacity;
+    }
+    map->size = distinct;
+    if (map->filter && hashmap_filter_rebuild(map) != 0)
+        fprintf(stderr, "Warning: hashmap filter rebuild failed.\n");
+    return 0;
+}
+
+int hashmap_build_bulk(HashMap *map,
+                       const void *const *keys, const size_t *key_sizes,
+                       const void *const *vals, const size_t *val_sizes,
+                       size_t n, unsigned nthreads)
+{
+    if (!map || !map->buckets || (n > 0 && (!keys || !key_sizes || !vals || !val_sizes)))
+        return -1;
+
+    if (nthreads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    if (nthreads > n / BULK_CHUNK)
+        nthreads = n >= BULK_CHUNK ? (unsigned)(n / BULK_CHUNK) : 1;
+
+    if (map->size > 0 || map->wal || map->snapshot || n < BULK_MIN_PARALLEL || n >= BULK_NONE)
+    {
+        if (!bulk_valid(keys, key_sizes, vals, val_sizes, n))
+            return -1;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (hashmap_insert(map, keys[i], key_sizes[i], vals[i], val_sizes[i]) != 0)
+                return -1;
+        }
+        return 0;
+    }
+
+    BulkJob job;
+    memset(&job, 0, sizeof(job));
+    job.map = map;
+    job.keys = keys;
+    job.key_sizes = key_sizes;
+    job.vals = vals;
+    job.val_sizes = val_sizes;
+    job.n = n;
+    job.nthreads = nthreads;
+    job.nslices = (size_t)nthreads * BULK_SLICES_PER_THREAD;
+    job.npartitions = (size_t)nthreads * BULK_PARTITIONS_PER_THREAD;
+    atomic_init(&job.entry_next, 0);
+    atomic_init(&job.pool_next, 0);
+    atomic_init(&job.distinct, 0);
+    atomic_init(&job.pool_bytes, 0);
+    atomic_init(&job.next, 0);
+    atomic_init(&job.error, 0);
+    job.hashes = (uint64_t *)malloc(n * sizeof(uint64_t));
+    job.winner = (uint32_t *)malloc(n * sizeof(uint32_t));
+    job.order = (uint32_t *)malloc(n * sizeof(uint32_t));
+    job.counts = (size_t *)malloc(job.nslices * job.npartitions * sizeof(size_t));
+    job.part_start = (size_t *)malloc((job.npartitions + 1) * sizeof(size_t));
+
+    int status = -1;
+    if (job.hashes && job.winner && job.order && job.counts && job.part_start)
+        status = bulk_build(&job);
+
+    free(job.hashes);
+    free(job.winner);
+    free(job.order);
+    free(job.counts);
+    free(job.part_start);
+    return status;
+}
+
+/*
+ * Parallel rehash for hashmap_resize(). When the table doubles from c to 2c
+ * buckets, the entries of old bucket i go to new bucket i or i + c, so a
+ * thread that owns a range of old buckets also owns their new buckets.
+ * Chains are walked and pushed in the same order as the serial loop, which
+ * makes the result identical to a serial resize.
+ */
+
+#define REHASH_CHUNK 16384 // Old buckets per task
+
+typedef struct
+{
+    HashMap *map;
+    HashMapEntry **new_buckets;
+    size_t nchunks;
+    atomic_size_t next; // Next chunk of old buckets
+} RehashJob;
+
+static void *rehash_worker(void *arg)
+{
+    RehashJob *job = (RehashJob *)arg;
+    HashMap *map = job->map;
+    size_t new_capacity = map->capacity * 2;
+    for (;;)
+    {
+        size_t chunk = atomic_fetch_add(&job->next, 1);
+        if (chunk >= job->nchunks)
+            break;
+        size_t start = chunk * REHASH_CHUNK;
+        size_t end = start + REHASH_CHUNK < map->capacity ? start + REHASH_CHUNK : map->capacity;
+        hashmap_chain_relink((void **)map->buckets + start, end - start,
+                             (void **)job->new_buckets, new_capacity,
+                             offsetof(HashMapEntry, next), hashmap_entry_hash, map);
+    }
+    return NULL;
+}
+
+void hashmap_rehash_parallel(HashMap *map, HashMapEntry **new_buckets)
+{
+    RehashJob job;
+    job.map = map;
+    job.new_buckets = new_buckets;
+    job.nchunks = (map->capacity + REHASH_CHUNK - 1) / REHASH_CHUNK;
+    atomic_init(&job.next, 0);
+
+    size_t nthreads = map->resize_threads < job.nchunks ? map->resize_threads : job.nchunks;
+    pthread_t *threads = NULL;
+    size_t started = 0;
+    if (nthreads > 1)
+        threads = (pthread_t *)malloc((nthreads - 1) * sizeof(pthread_t));
+    for (size_t i = 0; threads && i + 1 < nthreads; i++)
+    {
+        if (pthread_create(&threads[started], NULL, rehash_worker, &job) != 0)
+            break; // The threads that did start share the work
+        started++;
+    }
+    rehash_worker(&job);
+    for (size_t i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+}
+
+int hashmap_set_resize_threads(HashMap *map, unsigned nthreads)
+{
+    if (!map)
+        return -1;
+    if (nthreads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    map->resize_threads = nthreads;
+    return 0;
+}
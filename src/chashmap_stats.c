@@ -0,0 +1,46 @@
+#include <string.h>
+#include "../include/chashmap.h"
+#include "chashmap_internal.h"
+
+int hashmap_stats(const HashMap *map, HashMapStats *stats)
+{
+    if (!map || !map->buckets || !stats)
+        return -1;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->size = map->size;
+    stats->capacity = map->capacity;
+    stats->load = (double)map->size / (double)map->capacity;
+    stats->resize_count = map->resize_count;
+    stats->resize_ns = map->resize_ns;
+
+    size_t used = 0;
+    for (size_t i = 0; i < map->capacity; i++)
+    {
+        size_t chain = 0;
+        for (const HashMapEntry *entry = map->buckets[i]; entry; entry = entry->next)
+        {
+            chain++;
+            if (entry->key_size > HASHMAP_INLINE_SIZE)
+                stats->key_bytes += entry->key_size;
+            if (entry->value_size > HASHMAP_INLINE_SIZE)
+                stats->value_bytes += entry->value_size;
+        }
+        stats->chain_histogram[chain < HASHMAP_STATS_CHAINS ? chain : HASHMAP_STATS_CHAINS - 1]++;
+        if (chain > stats->max_chain)
+            stats->max_chain = chain;
+        if (chain)
+            used++;
+    }
+    stats->mean_chain = used ? (double)map->size / (double)used : 0.0;
+    stats->empty_fraction = (double)(map->capacity - used) / (double)map->capacity;
+
+    stats->bucket_bytes = map->capacity * sizeof(HashMapEntry *);
+    stats->entry_bytes = map->size * sizeof(HashMapEntry);
+    if (map->filter)
+        stats->filter_bytes = sizeof(struct HashMapFilter) +
+                              map->filter->nblocks * HASHMAP_FILTER_BLOCK_WORDS * sizeof(uint64_t);
+    stats->total_bytes = sizeof(HashMap) + stats->bucket_bytes + stats->entry_bytes +
+                         stats->key_bytes + stats->value_bytes + stats->filter_bytes;
+    return 0;
+}
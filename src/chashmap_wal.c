@@ -0,0 +1,417 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/chashmap.h"
+#include "chashmap_internal.h"
+
+/*
+ * Log layout: a 16-byte header (magic + version), then records of
+ *   uint32 crc, uint8 op, uint32 key size, uint32 value size, key, value
+ * in host byte order. The CRC-32C covers everything after the crc field. A
+ * torn or corrupt tail (from a crash mid-write) ends the replay and is cut off.
+ */
+
+#define WAL_MAGIC "CHMAPWAL"
+#define WAL_VERSION 1u
+#define WAL_HEADER_SIZE 16
+#define WAL_RECORD_HEADER 13
+#define WAL_OP_INSERT 1
+#define WAL_OP_REMOVE 2
+#define WAL_CHECKPOINT_SUFFIX ".ckpt"
+
+struct HashMapWal
+{
+    int fd;                 // Log file, opened for appending
+    off_t synced;           // Length of the log known to be on disk
+    char *checkpoint_path;  // Where hashmap_wal_checkpoint() writes
+    unsigned char *buf;     // Records not yet written
+    size_t len, cap;
+    unsigned char *spare;   // Buffer being written by a flush
+    size_t spare_cap;
+    size_t pending_ops;     // Records in buf
+    unsigned sync_ms;       // Group-commit interval (0 => no flusher thread)
+    unsigned sync_ops;      // Group-commit batch size (0 => every op)
+    pthread_mutex_t lock;
+    pthread_cond_t wake;    // Wakes the flusher thread
+    pthread_cond_t flushed; // Signalled when a flush finishes
+    pthread_t flusher;
+    int has_flusher;
+    int flushing;
+    int stop;
+    int error;              // Sticky: set once a write or sync fails
+};
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void wal_crc_init(void)
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t wal_crc(const unsigned char *data, size_t size)
+{
+    pthread_once(&crc_once, wal_crc_init);
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+        c = crc_table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+static int wal_write_all(int fd, const unsigned char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = write(fd, data, size);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * Write and fdatasync everything appended so far. Called with wal->lock
+ * held; the lock is dropped during I/O so appends can continue. If the write
+ * or the sync fails, the log is cut back to its last synced length so that
+ * recovery cannot replay part of the failed batch.
+ */
+static int wal_flush_locked(struct HashMapWal *wal)
+{
+    while (wal->flushing)
+        pthread_cond_wait(&wal->flushed, &wal->lock);
+    if (wal->len == 0 || wal->error)
+        return wal->error ? -1 : 0;
+
+    // Swap buffers: appends go to the other one while this one is written
+    unsigned char *data = wal->buf;
+    size_t len = wal->len;
+    size_t cap = wal->cap;
+    wal->buf = wal->spare;
+    wal->cap = wal->spare_cap;
+    wal->len = 0;
+    wal->pending_ops = 0;
+    wal->flushing = 1;
+    pthread_mutex_unlock(&wal->lock);
+
+    int status = wal_write_all(wal->fd, data, len);
+    if (status == 0 && fdatasync(wal->fd) != 0)
+        status = -1;
+    if (status == 0)
+        wal->synced += (off_t)len;
+    else if (ftruncate(wal->fd, wal->synced) == 0)
+        fdatasync(wal->fd);
+
+    pthread_mutex_lock(&wal->lock);
+    wal->spare = data;
+    wal->spare_cap = cap;
+    wal->flushing = 0;
+    if (status != 0)
+        wal->error = 1;
+    pthread_cond_broadcast(&wal->flushed);
+    return status;
+}
+
+static void *wal_flusher(void *arg)
+{
+    struct HashMapWal *wal = (struct HashMapWal *)arg;
+    pthread_mutex_lock(&wal->lock);
+    while (!wal->stop)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += wal->sync_ms / 1000;
+        deadline.tv_nsec += (long)(wal->sync_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&wal->wake, &wal->lock, &deadline);
+        if (wal->len > 0)
+            wal_flush_locked(wal);
+    }
+    pthread_mutex_unlock(&wal->lock);
+    return NULL;
+}
+
+static int wal_append(HashMap *map, unsigned char op,
+                      const void *key, size_t key_size,
+                      const void *val, size_t val_size)
+{
+    struct HashMapWal *wal = map->wal;
+    if (key_size > UINT32_MAX || val_size > UINT32_MAX)
+        return -1;
+
+    pthread_mutex_lock(&wal->lock);
+    size_t need = WAL_RECORD_HEADER + key_size + val_size;
+    if (wal->error)
+    {
+        pthread_mutex_unlock(&wal->lock);
+        return -1;
+    }
+    if (wal->len + need > wal->cap)
+    {
+        size_t cap = wal->cap ? wal->cap : 4096;
+        while (cap < wal->len + need)
+            cap *= 2;
+        unsigned char *buf = (unsigned char *)realloc(wal->buf, cap);
+        if (!buf)
+        {
+            pthread_mutex_unlock(&wal->lock);
+            return -1;
+        }
+        wal->buf = buf;
+        wal->cap = cap;
+    }
+
+    unsigned char *rec = wal->buf + wal->len;
+    uint32_t sizes[2] = {(uint32_t)key_size, (uint32_t)val_size};
+    rec[4] = op;
+    memcpy(rec + 5, sizes, sizeof(sizes));
+    memcpy(rec + WAL_RECORD_HEADER, key, key_size);
+    if (val_size)
+        memcpy(rec + WAL_RECORD_HEADER + key_size, val, val_size);
+    uint32_t crc = wal_crc(rec + 4, need - 4);
+    memcpy(rec, &crc, sizeof(crc));
+    wal->len += need;
+    wal->pending_ops++;
+
+    int status = 0;
+    if (wal->pending_ops >= wal->sync_ops)
+    {
+        if (wal->has_flusher)
+            pthread_cond_signal(&wal->wake);
+        else
+            status = wal_flush_locked(wal);
+    }
+    pthread_mutex_unlock(&wal->lock);
+    return status;
+}
+
+int hashmap_wal_note_insert(HashMap *map, const void *key, size_t key_size,
+                            const void *val, size_t val_size)
+{
+    return wal_append(map, WAL_OP_INSERT, key, key_size, val, val_size);
+}
+
+int hashmap_wal_note_remove(HashMap *map, const void *key, size_t key_size)
+{
+    return wal_append(map, WAL_OP_REMOVE, key, key_size, NULL, 0);
+}
+
+/**
+ * Apply the records of a mapped log to `map`. `*valid` receives the length of
+ * the valid prefix of the log, or 0 if the header is bad.
+ *   @return 0 on success, -1 if a valid record could not be applied.
+ */
+static int wal_replay(HashMap *map, const unsigned char *log, size_t size, size_t *valid)
+{
+    *valid = 0;
+    if (size < WAL_HEADER_SIZE || memcmp(log, WAL_MAGIC, 8) != 0)
+        return 0;
+    uint32_t version;
+    memcpy(&version, log + 8, sizeof(version));
+    if (version != WAL_VERSION)
+        return 0;
+
+    size_t pos = WAL_HEADER_SIZE;
+    while (size - pos >= WAL_RECORD_HEADER)
+    {
+        const unsigned char *rec = log + pos;
+        uint32_t crc, sizes[2];
+        memcpy(&crc, rec, sizeof(crc));
+        memcpy(sizes, rec + 5, sizeof(sizes));
+        size_t need = WAL_RECORD_HEADER + (size_t)sizes[0] + sizes[1];
+        if (need > size - pos || sizes[0] == 0 || wal_crc(rec + 4, need - 4) != crc)
+            break; // Torn or corrupt tail
+
+        // A record that passed its CRC is committed; failing to apply it must
+        // not cut it (or anything after it) off the log.
+        const unsigned char *key = rec + WAL_RECORD_HEADER;
+        int status = (rec[4] == WAL_OP_INSERT)
+                         ? hashmap_insert(map, key, sizes[0], key + sizes[0], sizes[1])
+                         : (rec[4] == WAL_OP_REMOVE ? hashmap_remove(map, key, sizes[0]) : -1);
+        if (status < 0)
+            return -1;
+        pos += need;
+    }
+    *valid = pos;
+    return 0;
+}
+
+/**
+ * Rebuild `map` from the log file `fd` and cut any torn tail off the file.
+ * The file is left untouched if a record cannot be applied.
+ *   @param synced  Receives the length of the log after recovery.
+ */
+static int wal_recover(HashMap *map, int fd, off_t *synced)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return -1;
+    size_t size = (size_t)st.st_size;
+    size_t valid = 0;
+    if (size > 0)
+    {
+        void *log = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (log == MAP_FAILED)
+            return -1;
+        int status = wal_replay(map, (const unsigned char *)log, size, &valid);
+        munmap(log, size);
+        if (status != 0)
+            return -1;
+        if (valid == 0 && size >= WAL_HEADER_SIZE)
+            return -1; // Not a log written by this library
+    }
+
+    if (valid == 0)
+    {
+        unsigned char header[WAL_HEADER_SIZE] = {0};
+        uint32_t version = WAL_VERSION;
+        memcpy(header, WAL_MAGIC, 8);
+        memcpy(header + 8, &version, sizeof(version));
+        if (ftruncate(fd, 0) != 0 || wal_write_all(fd, header, sizeof(header)) != 0)
+            return -1;
+        valid = WAL_HEADER_SIZE;
+    }
+    else if (valid < size && ftruncate(fd, (off_t)valid) != 0)
+    {
+        return -1;
+    }
+    *synced = (off_t)valid;
+    return fdatasync(fd);
+}
+
+int hashmap_wal_open(HashMap *map, const char *path,
+                     hash_func_t hash_func, eq_func_t eq_func,
+                     unsigned sync_ms, unsigned sync_ops)
+{
+    if (!map || !path)
+        return -1;
+
+    size_t path_len = strlen(path);
+    char *checkpoint_path = (char *)malloc(path_len + sizeof(WAL_CHECKPOINT_SUFFIX));
+    if (!checkpoint_path)
+        return -1;
+    memcpy(checkpoint_path, path, path_len);
+    memcpy(checkpoint_path + path_len, WAL_CHECKPOINT_SUFFIX, sizeof(WAL_CHECKPOINT_SUFFIX));
+
+    // Start from the last checkpoint, if there is one
+    int status = (access(checkpoint_path, F_OK) == 0)
+                     ? hashmap_load(map, checkpoint_path, hash_func, eq_func)
+                     : hashmap_init(map, 0, hash_func, eq_func, 0.0f);
+    if (status != 0)
+    {
+        free(checkpoint_path);
+        return -1;
+    }
+
+    struct HashMapWal *wal = (struct HashMapWal *)calloc(1, sizeof(struct HashMapWal));
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    off_t synced = 0;
+    if (!wal || fd < 0 || wal_recover(map, fd, &synced) != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        free(wal);
+        free(checkpoint_path);
+        hashmap_destroy(map);
+        return -1;
+    }
+
+    wal->fd = fd;
+    wal->synced = synced;
+    wal->checkpoint_path = checkpoint_path;
+    wal->sync_ms = sync_ms;
+    wal->sync_ops = sync_ops ? sync_ops : 1;
+    pthread_mutex_init(&wal->lock, NULL);
+    pthread_cond_init(&wal->wake, NULL);
+    pthread_cond_init(&wal->flushed, NULL);
+    if (sync_ms > 0 && pthread_create(&wal->flusher, NULL, wal_flusher, wal) == 0)
+        wal->has_flusher = 1;
+    map->wal = wal;
+    return 0;
+}
+
+int hashmap_wal_sync(HashMap *map)
+{
+    if (!map || !map->wal)
+        return -1;
+    struct HashMapWal *wal = map->wal;
+    pthread_mutex_lock(&wal->lock);
+    int status = wal_flush_locked(wal);
+    pthread_mutex_unlock(&wal->lock);
+    return status;
+}
+
+int hashmap_wal_checkpoint(HashMap *map)
+{
+    if (!map || !map->wal)
+        return -1;
+    struct HashMapWal *wal = map->wal;
+    pthread_mutex_lock(&wal->lock);
+    // The checkpoint must be durable before the log records it replaces are dropped:
+    // hashmap_save() syncs the file and, after the rename, its directory. A crash
+    // in between replays the whole log onto the new checkpoint, which yields the
+    // same map.
+    int status = wal_flush_locked(wal);
+    if (status == 0)
+        status = hashmap_save(map, wal->checkpoint_path);
+    if (status == 0 && (ftruncate(wal->fd, WAL_HEADER_SIZE) != 0 || fdatasync(wal->fd) != 0))
+        status = -1;
+    if (status == 0)
+        wal->synced = WAL_HEADER_SIZE;
+    if (status != 0)
+        wal->error = 1;
+    pthread_mutex_unlock(&wal->lock);
+    return status;
+}
+
+int hashmap_wal_close(HashMap *map)
+{
+    if (!map || !map->wal)
+        return 0;
+    struct HashMapWal *wal = map->wal;
+
+    pthread_mutex_lock(&wal->lock);
+    wal->stop = 1;
+    pthread_cond_signal(&wal->wake);
+    pthread_mutex_unlock(&wal->lock);
+    if (wal->has_flusher)
+        pthread_join(wal->flusher, NULL);
+
+    pthread_mutex_lock(&wal->lock);
+    int status = wal_flush_locked(wal);
+    pthread_mutex_unlock(&wal->lock);
+    if (close(wal->fd) != 0)
+        status = -1;
+
+    pthread_mutex_destroy(&wal->lock);
+    pthread_cond_destroy(&wal->wake);
+    pthread_cond_destroy(&wal->flushed);
+    free(wal->buf);
+    free(wal->spare);
+    free(wal->checkpoint_path);
+    free(wal);
+    map->wal = NULL;
+    return status;
+}
@@ -0,0 +1,242 @@
+#include "../include/chashmultimap.h"
+#include "chashmap_internal.h"
+
+/*
+ * HashMultiMap runs on the shared chaining engine (chashmap_chain.h); only
+ * the per-key value list is specific to this file.
+ */
+
+static const HashChainLayout hashmultimap_layout = HASH_CHAIN_LAYOUT(HashMultiMapEntry);
+
+static inline const void *hashmultimap_entry_key(const HashMultiMapEntry *entry)
+{
+    return hashmap_data_bytes(&entry->key, entry->key_size);
+}
+
+static uint64_t hashmultimap_entry_hash(const void *entry, const void *map)
+{
+    const HashMultiMapEntry *e = (const HashMultiMapEntry *)entry;
+    return ((const HashMultiMap *)map)->hash_func(hashmultimap_entry_key(e), e->key_size);
+}
+
+/**
+ * Helper to free an entry, its key copy and all of its values.
+ */
+static void hashmultimap_free_entry(void *entry, void *ctx)
+{
+    HashMultiMapEntry *e = (HashMultiMapEntry *)entry;
+    (void)ctx;
+    HashMultiMapValue *value = e->head;
+    while (value)
+    {
+        HashMultiMapValue *next = value->next;
+        free(value);
+        value = next;
+    }
+    hashmap_data_release(&e->key, e->key_size);
+    free(e);
+}
+
+/**
+ * Find the link pointing at the entry for a key with hash `hash` (or at the chain's NULL end).
+ */
+static HashMultiMapEntry **hashmultimap_find_link(const HashMultiMap *map, uint64_t hash,
+                                                  const void *key_data, size_t key_size)
+{
+    return (HashMultiMapEntry **)hashmap_chain_find_link((void **)map->buckets,
+                                                         hashmap_chain_index(hash, map->capacity),
+                                                         hashmultimap_layout, map->eq_func,
+                                                         key_data, key_size);
+}
+
+/**
+ * Resize (rehash) the multimap to a new capacity.
+ */
+static int hashmultimap_resize(HashMultiMap *map, size_t new_capacity)
+{
+    HashMultiMapEntry **buckets = (HashMultiMapEntry **)hashmap_chain_rehash(
+        (void **)map->buckets, map->capacity, new_capacity, hashmultimap_layout.next,
+        hashmultimap_entry_hash, map);
+    if (!buckets)
+        return -1;
+    map->buckets = buckets;
+    map->capacity = new_capacity;
+    return 0;
+}
+
+int hashmultimap_init(HashMultiMap *map,
+                      size_t capacity,
+                      hash_func_t hash_func,
+                      eq_func_t eq_func,
+                      float load_factor)
+{
+    if (!map)
+        return -1;
+
+    hashmap_chain_defaults(&capacity, &load_factor);
+    map->capacity = capacity;
+    map->keys = 0;
+    map->size = 0;
+    map->hash_func = (hash_func != NULL) ? hash_func : hashmap_hash_bytes;
+    map->eq_func = (eq_func != NULL) ? eq_func : hashmap_default_eq;
+    map->load_factor = load_factor;
+
+    map->buckets = (HashMultiMapEntry **)calloc(map->capacity, sizeof(HashMultiMapEntry *));
+    if (!map->buckets)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+void hashmultimap_destroy(HashMultiMap *map)
+{
+    if (!map || !map->buckets)
+        return;
+
+    hashmap_chain_clear((void **)map->buckets, map->capacity, hashmultimap_layout.next,
+                        hashmultimap_free_entry, NULL);
+    free(map->buckets);
+    map->buckets = NULL;
+    map->capacity = 0;
+    map->keys = 0;
+    map->size = 0;
+    map->hash_func = NULL;
+    map->eq_func = NULL;
+    map->load_factor = 0;
+}
+
+int hashmultimap_insert(HashMultiMap *map,
+                        const void *key_data, size_t key_size,
+                        const void *val_data, size_t val_size)
+{
+    if (!map || !key_data || key_size == 0 || (!val_data && val_size > 0))
+        return -1;
+
+    HashMultiMapValue *value = (HashMultiMapValue *)malloc(sizeof(HashMultiMapValue) + val_size);
+    if (!value)
+        return -1;
+    value->next = NULL;
+    value->size = val_size;
+    if (val_size > 0)
+        memcpy(value->data, val_data, val_size);
+
+    // Hash once: the lookup, the resize check and the link all use it
+    uint64_t hash = map->hash_func(key_data, key_size);
+    HashMultiMapEntry **link = hashmultimap_find_link(map, hash, key_data, key_size);
+    HashMultiMapEntry *entry = *link;
+    if (entry)
+    {
+        // Existing key: O(1) append
+        entry->tail->next = value;
+        entry->tail = value;
+        entry->count++;
+        map->size++;
+        return 0;
+    }
+
+    // New key; resize first if the load factor is exceeded
+    if (hashmap_chain_full(map->keys, map->capacity, map->load_factor))
+    {
+        if (hashmultimap_resize(map, map->capacity * 2) != 0)
+        {
+            fprintf(stderr, "Warning: hashmultimap resizing failed.\n");
+        }
+    }
+
+    entry = (HashMultiMapEntry *)malloc(sizeof(HashMultiMapEntry));
+    if (!entry || hashmap_data_store(&entry->key, key_data, key_size) != 0)
+    {
+        free(entry);
+        free(value);
+        return -1;
+    }
+    entry->key_size = key_size;
+    entry->head = value;
+    entry->tail = value;
+    entry->count = 1;
+
+    size_t index = hashmap_chain_index(hash, map->capacity);
+    entry->next = map->buckets[index];
+    map->buckets[index] = entry;
+    map->keys++;
+    map->size++;
+    return 0;
+}
+
+const HashMultiMapValue *hashmultimap_get_all(const HashMultiMap *map,
+                                              const void *key_data, size_t key_size,
+                                              size_t *out_count)
+{
+    if (out_count)
+        *out_count = 0;
+    if (!map || !key_data || key_size == 0)
+        return NULL;
+
+    uint64_t hash = map->hash_func(key_data, key_size);
+    HashMultiMapEntry *entry = *hashmultimap_find_link(map, hash, key_data, key_size);
+    if (!entry)
+        return NULL;
+    if (out_count)
+        *out_count = entry->count;
+    return entry->head;
+}
+
+int hashmultimap_remove_one(HashMultiMap *map,
+                            const void *key_data, size_t key_size,
+                            const void *val_data, size_t val_size)
+{
+    if (!map || !key_data || key_size == 0 || (!val_data && val_size > 0))
+        return -1;
+
+    uint64_t hash = map->hash_func(key_data, key_size);
+    HashMultiMapEntry **link = hashmultimap_find_link(map, hash, key_data, key_size);
+    HashMultiMapEntry *entry = *link;
+    if (!entry)
+        return 0;
+
+    HashMultiMapValue *prev = NULL;
+    for (HashMultiMapValue *value = entry->head; value; prev = value, value = value->next)
+    {
+        if (value->size != val_size || (val_size > 0 && memcmp(value->data, val_data, val_size) != 0))
+            continue;
+
+        if (prev)
+            prev->next = value->next;
+        else
+            entry->head = value->next;
+        if (entry->tail == value)
+            entry->tail = prev;
+        free(value);
+        entry->count--;
+        map->size--;
+
+        if (entry->count == 0)
+        {
+            *link = entry->next;
+            hashmultimap_free_entry(entry, NULL);
+            map->keys--;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+long hashmultimap_remove_all(HashMultiMap *map, const void *key_data, size_t key_size)
+{
+    if (!map || !key_data || key_size == 0)
+        return -1;
+
+    uint64_t hash = map->hash_func(key_data, key_size);
+    HashMultiMapEntry **link = hashmultimap_find_link(map, hash, key_data, key_size);
+    HashMultiMapEntry *entry = *link;
+    if (!entry)
+        return 0;
+
+    long removed = (long)entry->count;
+    *link = entry->next;
+    map->size -= entry->count;
+    map->keys--;
+    hashmultimap_free_entry(entry, NULL);
+    return removed;
+}
@@ -0,0 +1,245 @@
+#include "../include/chashset.h"
+#include "chashmap_internal.h"
+
+/*
+ * HashSet runs on the shared chaining engine (chashmap_chain.h); only the
+ * keys-only entry layout is specific to this file.
+ */
+
+static const HashChainLayout hashset_layout = HASH_CHAIN_LAYOUT(HashSetEntry);
+
+static inline const void *hashset_entry_key(const HashSetEntry *entry)
+{
+    return hashmap_data_bytes(&entry->key, entry->key_size);
+}
+
+static uint64_t hashset_entry_hash(const void *entry, const void *set)
+{
+    const HashSetEntry *e = (const HashSetEntry *)entry;
+    return ((const HashSet *)set)->hash_func(hashset_entry_key(e), e->key_size);
+}
+
+/**
+ * Free an entry and its key copy.
+ */
+static void hashset_free_entry(void *entry, void *ctx)
+{
+    HashSetEntry *e = (HashSetEntry *)entry;
+    (void)ctx;
+    hashmap_data_release(&e->key, e->key_size);
+    free(e);
+}
+
+/**
+ * Find the link pointing at the entry for a key in chain `index` (or at the chain's NULL end).
+ */
+static HashSetEntry **hashset_find_link(const HashSet *set, size_t index,
+                                        const void *key_data, size_t key_size)
+{
+    return (HashSetEntry **)hashmap_chain_find_link((void **)set->buckets, index, hashset_layout,
+                                                    set->eq_func, key_data, key_size);
+}
+
+/**
+ * Resize (rehash) the set to a new capacity.
+ */
+static int hashset_resize(HashSet *set, size_t new_capacity)
+{
+    HashSetEntry **buckets = (HashSetEntry **)hashmap_chain_rehash(
+        (void **)set->buckets, set->capacity, new_capacity, hashset_layout.next, hashset_entry_hash, set);
+    if (!buckets)
+        return -1;
+    set->buckets = buckets;
+    set->capacity = new_capacity;
+    return 0;
+}
+
+int hashset_init(HashSet *set,
+                 size_t capacity,
+                 hash_func_t hash_func,
+                 eq_func_t eq_func,
+                 float load_factor)
+{
+    if (!set)
+        return -1;
+
+    hashmap_chain_defaults(&capacity, &load_factor);
+    set->capacity = capacity;
+    set->size = 0;
+    set->hash_func = (hash_func != NULL) ? hash_func : hashmap_hash_bytes;
+    set->eq_func = (eq_func != NULL) ? eq_func : hashmap_default_eq;
+    set->load_factor = load_factor;
+
+    set->buckets = (HashSetEntry **)calloc(set->capacity, sizeof(HashSetEntry *));
+    if (!set->buckets)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+void hashset_destroy(HashSet *set)
+{
+    if (!set || !set->buckets)
+        return;
+
+    hashmap_chain_clear((void **)set->buckets, set->capacity, hashset_layout.next, hashset_free_entry, NULL);
+    free(set->buckets);
+    set->buckets = NULL;
+    set->capacity = 0;
+    set->size = 0;
+    set->hash_func = NULL;
+    set->eq_func = NULL;
+    set->load_factor = 0;
+}
+
+int hashset_insert(HashSet *set, const void *key_data, size_t key_size)
+{
+    if (!set || !key_data || key_size == 0)
+        return -1;
+
+    // Resize if load factor exceeded
+    if (hashmap_chain_full(set->size, set->capacity, set->load_factor))
+    {
+        if (hashset_resize(set, set->capacity * 2) != 0)
+        {
+            fprintf(stderr, "Warning: hashset resizing failed.\n");
+        }
+    }
+
+    size_t index = hashmap_chain_index(set->hash_func(key_data, key_size), set->capacity);
+    if (*hashset_find_link(set, index, key_data, key_size))
+        return 0; // already present
+
+    HashSetEntry *new_entry = (HashSetEntry *)malloc(sizeof(HashSetEntry));
+    if (!new_entry)
+        return -1;
+    if (hashmap_data_store(&new_entry->key, key_data, key_size) != 0)
+    {
+        free(new_entry);
+        return -1;
+    }
+    new_entry->key_size = key_size;
+    new_entry->next = set->buckets[index];
+    set->buckets[index] = new_entry;
+    set->size++;
+    return 1;
+}
+
+int hashset_contains(const HashSet *set, const void *key_data, size_t key_size)
+{
+    if (!set || !key_data || key_size == 0)
+        return -1;
+
+    size_t index = hashmap_chain_index(set->hash_func(key_data, key_size), set->capacity);
+    return *hashset_find_link(set, index, key_data, key_size) ? 1 : 0;
+}
+
+int hashset_remove(HashSet *set, const void *key_data, size_t key_size)
+{
+    if (!set || !key_data || key_size == 0)
+        return -1;
+
+    size_t index = hashmap_chain_index(set->hash_func(key_data, key_size), set->capacity);
+    HashSetEntry **link = hashset_find_link(set, index, key_data, key_size);
+    HashSetEntry *entry = *link;
+    if (!entry)
+        return 0;
+    *link = entry->next;
+    hashset_free_entry(entry, NULL);
+    set->size--;
+    return 1;
+}
+
+int hashset_union(HashSet *dst, const HashSet *src)
+{
+    if (!dst || !src)
+        return -1;
+    if (dst == src)
+        return 0;
+
+    for (size_t i = 0; i < src->capacity; i++)
+    {
+        for (HashSetEntry *entry = src->buckets[i]; entry; entry = entry->next)
+        {
+            if (hashset_insert(dst, hashset_entry_key(entry), entry->key_size) < 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Remove every entry of `dst` whose membership in `src` equals `drop_if_present`.
+ */
+static int hashset_filter(HashSet *dst, const HashSet *src, int drop_if_present)
+{
+    for (size_t i = 0; i < dst->capacity; i++)
+    {
+        HashSetEntry **link = &dst->buckets[i];
+        while (*link)
+        {
+            HashSetEntry *entry = *link;
+            int present = hashset_contains(src, hashset_entry_key(entry), entry->key_size);
+            if (present < 0)
+                return -1;
+            if (present == drop_if_present)
+            {
+                *link = entry->next;
+                hashset_free_entry(entry, NULL);
+                dst->size--;
+            }
+            else
+            {
+                link = &entry->next;
+            }
+        }
+    }
+    return 0;
+}
+
+int hashset_intersect(HashSet *dst, const HashSet *src)
+{
+    if (!dst || !src)
+        return -1;
+    if (dst == src)
+        return 0;
+    return hashset_filter(dst, src, 0);
+}
+
+int hashset_difference(HashSet *dst, const HashSet *src)
+{
+    if (!dst || !src)
+        return -1;
+    if (dst == src)
+    {
+        // Everything goes; keep the bucket array.
+        hashmap_chain_clear((void **)dst->buckets, dst->capacity, hashset_layout.next, hashset_free_entry, NULL);
+        dst->size = 0;
+        return 0;
+    }
+    return hashset_filter(dst, src, 1);
+}
+
+void hashset_iter_init(HashSetIter *it, const HashSet *set)
+{
+    it->set = set;
+    it->bucket = 0;
+    it->entry = NULL;
+}
+
+int hashset_iter_next(HashSetIter *it, const void **key_data, size_t *key_size)
+{
+    if (it->entry)
+        it->entry = it->entry->next;
+    while (!it->entry && it->bucket < it->set->capacity)
+        it->entry = it->set->buckets[it->bucket++];
+    if (!it->entry)
+        return 0;
+
+    if (key_data)
+        *key_data = hashset_entry_key(it->entry);
+    if (key_size)
+        *key_size = it->entry->key_size;
+    return 1;
+}
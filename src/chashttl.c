@@ -0,0 +1,459 @@
+#include "../include/chashttl.h"
+#include "chashmap_internal.h"
+#include <time.h>
+
+#define DEFAULT_TICK_MS 10
+
+#define WHEEL_MASK (HASHTTL_WHEEL_SLOTS - 1)
+// Ticks covered by the whole wheel; later deadlines wait in the top level.
+#define WHEEL_SPAN ((uint64_t)1 << (HASHTTL_WHEEL_BITS * HASHTTL_WHEEL_LEVELS))
+
+/*
+ * The chains run on the shared chaining engine (chashmap_chain.h).
+ */
+
+static const HashChainLayout hashttl_layout = HASH_CHAIN_LAYOUT(HashTTLEntry);
+
+/**
+ * Default clock: CLOCK_MONOTONIC in milliseconds.
+ */
+static uint64_t hashttl_monotonic_ms(void *ctx)
+{
+    (void)ctx;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static inline void *hashttl_entry_key(const HashTTLEntry *entry)
+{
+    return hashmap_data_bytes(&entry->key, entry->key_size);
+}
+
+static inline void *hashttl_entry_value(const HashTTLEntry *entry)
+{
+    return hashmap_data_bytes(&entry->value, entry->value_size);
+}
+
+static inline uint64_t hashttl_now(const HashTTLMap *map)
+{
+    return map->clock_func(map->clock_ctx);
+}
+
+static inline int hashttl_expired(const HashTTLEntry *entry, uint64_t now)
+{
+    return entry->deadline != 0 && entry->deadline <= now;
+}
+
+static uint64_t hashttl_entry_hash(const void *entry, const void *map)
+{
+    const HashTTLEntry *e = (const HashTTLEntry *)entry;
+    return ((const HashTTLMap *)map)->hash_func(hashttl_entry_key(e), e->key_size);
+}
+
+/**
+ * Helper to free an entry (and all memory it owns).
+ */
+static void hashttl_free_entry(void *entry, void *ctx)
+{
+    HashTTLEntry *e = (HashTTLEntry *)entry;
+    (void)ctx;
+    hashmap_data_release(&e->key, e->key_size);
+    hashmap_data_release(&e->value, e->value_size);
+    free(e);
+}
+
+/**
+ * Find the chain link pointing at the entry for a key with hash `hash` (or at the chain's NULL end).
+ */
+static HashTTLEntry **hashttl_find_link(const HashTTLMap *map, uint64_t hash,
+                                        const void *key_data, size_t key_size)
+{
+    return (HashTTLEntry **)hashmap_chain_find_link((void **)map->buckets,
+                                                    hashmap_chain_index(hash, map->capacity),
+                                                    hashttl_layout, map->eq_func, key_data, key_size);
+}
+
+/**
+ * Resize (rehash) the map to a new capacity. Wheel links are unaffected.
+ */
+static int hashttl_resize(HashTTLMap *map, size_t new_capacity)
+{
+    HashTTLEntry **buckets = (HashTTLEntry **)hashmap_chain_rehash(
+        (void **)map->buckets, map->capacity, new_capacity, hashttl_layout.next, hashttl_entry_hash, map);
+    if (!buckets)
+        return -1;
+    map->buckets = buckets;
+    map->capacity = new_capacity;
+    return 0;
+}
+
+/*
+ * Timing wheel. Level L slot s holds entries whose expiry tick, shifted right
+ * by L * HASHTTL_WHEEL_BITS, is s (mod HASHTTL_WHEEL_SLOTS). When level L-1
+ * wraps around, the matching level L slot is cascaded: its entries are
+ * re-added relative to the current tick, moving them down a level. Each entry
+ * therefore moves at most HASHTTL_WHEEL_LEVELS times.
+ *
+ * hashttl_advance() cascades a tick's upper slots before it expires the tick's
+ * level 0 slot, so while cascading the current tick is still open; otherwise
+ * it has been processed and the earliest tick an entry can fire on is the next.
+ */
+
+static void hashttl_wheel_unlink(HashTTLMap *map, HashTTLEntry *entry)
+{
+    if (!entry->wheel_pprev)
+        return;
+    *entry->wheel_pprev = entry->wheel_next;
+    if (entry->wheel_next)
+        entry->wheel_next->wheel_pprev = entry->wheel_pprev;
+    entry->wheel_next = NULL;
+    entry->wheel_pprev = NULL;
+    map->wheel_count--;
+}
+
+/**
+ * Add an entry to the wheel slot of its deadline; `first_open_tick` is the
+ * earliest tick whose level 0 slot is still to be processed.
+ */
+static void hashttl_wheel_add(HashTTLMap *map, HashTTLEntry *entry, uint64_t first_open_tick)
+{
+    uint64_t expire_tick = (entry->deadline + map->tick_ms - 1) / map->tick_ms;
+    uint64_t now_tick = map->wheel_tick;
+    if (expire_tick < first_open_tick)
+        expire_tick = first_open_tick; // overdue: expire on the first tick still to come
+    if (expire_tick - now_tick >= WHEEL_SPAN)
+        expire_tick = now_tick + WHEEL_SPAN - 1; // re-added when cascaded
+
+    uint64_t delta = expire_tick - now_tick;
+    int level = 0;
+    while (level < HASHTTL_WHEEL_LEVELS - 1 &&
+           delta >= ((uint64_t)1 << (HASHTTL_WHEEL_BITS * (level + 1))))
+    {
+        level++;
+    }
+    size_t slot = (size_t)(expire_tick >> (HASHTTL_WHEEL_BITS * level)) & WHEEL_MASK;
+
+    HashTTLEntry **head = &map->wheel[level][slot];
+    entry->wheel_next = *head;
+    if (*head)
+        (*head)->wheel_pprev = &entry->wheel_next;
+    entry->wheel_pprev = head;
+    *head = entry;
+    map->wheel_count++;
+}
+
+/**
+ * (Re)schedule an entry according to its deadline.
+ */
+static void hashttl_schedule(HashTTLMap *map, HashTTLEntry *entry)
+{
+    hashttl_wheel_unlink(map, entry);
+    if (entry->deadline != 0)
+        hashttl_wheel_add(map, entry, map->wheel_tick + 1);
+}
+
+/**
+ * Remove `entry` (found at `link`) from the map and the wheel, and free it.
+ */
+static void hashttl_unlink_entry(HashTTLMap *map, HashTTLEntry **link, HashTTLEntry *entry, int expired)
+{
+    *link = entry->next;
+    hashttl_wheel_unlink(map, entry);
+    map->size--;
+    if (expired && map->expire_func)
+    {
+        map->expire_func(hashttl_entry_key(entry), entry->key_size,
+                         hashttl_entry_value(entry), entry->value_size,
+                         map->expire_ctx);
+    }
+    hashttl_free_entry(entry, NULL);
+}
+
+static void hashttl_cascade(HashTTLMap *map, int level, size_t slot)
+{
+    HashTTLEntry *entry = map->wheel[level][slot];
+    map->wheel[level][slot] = NULL;
+    while (entry)
+    {
+        HashTTLEntry *next = entry->wheel_next;
+        entry->wheel_pprev = NULL;
+        entry->wheel_next = NULL;
+        map->wheel_count--;
+        hashttl_wheel_add(map, entry, map->wheel_tick);
+        entry = next;
+    }
+}
+
+/**
+ * Lowest wheel level holding any entry (HASHTTL_WHEEL_LEVELS if none).
+ */
+static int hashttl_wheel_lowest_level(const HashTTLMap *map)
+{
+    for (int level = 0; level < HASHTTL_WHEEL_LEVELS; level++)
+    {
+        for (size_t slot = 0; slot < HASHTTL_WHEEL_SLOTS; slot++)
+        {
+            if (map->wheel[level][slot])
+                return level;
+        }
+    }
+    return HASHTTL_WHEEL_LEVELS;
+}
+
+/**
+ * Process ticks up to `target_tick`, expiring due entries.
+ */
+static size_t hashttl_advance(HashTTLMap *map, uint64_t target_tick)
+{
+    size_t expired = 0;
+    while (map->wheel_tick < target_tick)
+    {
+        if (map->wheel_count == 0)
+        {
+            map->wheel_tick = target_tick; // nothing scheduled; jump ahead
+            break;
+        }
+
+        // With levels below `lowest` empty, nothing happens until its next boundary.
+        int lowest = hashttl_wheel_lowest_level(map);
+        if (lowest > 0)
+        {
+            uint64_t skip_to = map->wheel_tick | ((((uint64_t)1) << (HASHTTL_WHEEL_BITS * lowest)) - 1);
+            if (skip_to >= target_tick)
+            {
+                map->wheel_tick = target_tick;
+                break;
+            }
+            map->wheel_tick = skip_to;
+        }
+
+        uint64_t tick = ++map->wheel_tick;
+        for (int level = 1; level < HASHTTL_WHEEL_LEVELS; level++)
+        {
+            if ((tick & (((uint64_t)1 << (HASHTTL_WHEEL_BITS * level)) - 1)) != 0)
+                break;
+            hashttl_cascade(map, level, (size_t)(tick >> (HASHTTL_WHEEL_BITS * level)) & WHEEL_MASK);
+        }
+
+        HashTTLEntry **slot = &map->wheel[0][tick & WHEEL_MASK];
+        while (*slot)
+        {
+            HashTTLEntry *entry = *slot;
+            HashTTLEntry **link = hashttl_find_link(map, hashttl_entry_hash(entry, map),
+                                                    hashttl_entry_key(entry), entry->key_size);
+            hashttl_unlink_entry(map, link, entry, 1);
+            expired++;
+        }
+    }
+    return expired;
+}
+
+int hashttl_init(HashTTLMap *map,
+                 size_t capacity,
+                 hash_func_t hash_func,
+                 eq_func_t eq_func,
+                 float load_factor,
+                 uint64_t tick_ms)
+{
+    if (!map)
+        return -1;
+
+    memset(map, 0, sizeof(*map));
+    hashmap_chain_defaults(&capacity, &load_factor);
+    map->capacity = capacity;
+    map->hash_func = (hash_func != NULL) ? hash_func : hashmap_hash_bytes;
+    map->eq_func = (eq_func != NULL) ? eq_func : hashmap_default_eq;
+    map->load_factor = load_factor;
+    map->tick_ms = (tick_ms > 0) ? tick_ms : DEFAULT_TICK_MS;
+    map->clock_func = hashttl_monotonic_ms;
+    map->wheel_tick = hashttl_now(map) / map->tick_ms;
+
+    map->buckets = (HashTTLEntry **)calloc(map->capacity, sizeof(HashTTLEntry *));
+    if (!map->buckets)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+void hashttl_destroy(HashTTLMap *map)
+{
+    if (!map || !map->buckets)
+        return;
+
+    hashmap_chain_clear((void **)map->buckets, map->capacity, hashttl_layout.next, hashttl_free_entry, NULL);
+    free(map->buckets);
+    memset(map, 0, sizeof(*map));
+}
+
+void hashttl_set_clock(HashTTLMap *map, clock_func_t clock_func, void *ctx)
+{
+    if (!map)
+        return;
+    map->clock_func = (clock_func != NULL) ? clock_func : hashttl_monotonic_ms;
+    map->clock_ctx = ctx;
+    map->wheel_tick = hashttl_now(map) / map->tick_ms;
+}
+
+void hashttl_set_expire_callback(HashTTLMap *map, expire_func_t expire_func, void *ctx)
+{
+    if (!map)
+        return;
+    map->expire_func = expire_func;
+    map->expire_ctx = ctx;
+}
+
+int hashttl_insert(HashTTLMap *map,
+                   const void *key_data, size_t key_size,
+                   const void *val_data, size_t val_size,
+                   uint64_t ttl_ms)
+{
+    if (!map || !key_data || key_size == 0)
+        return -1;
+
+    uint64_t now = hashttl_now(map);
+    hashttl_advance(map, now / map->tick_ms);
+    uint64_t deadline = (ttl_ms > 0) ? now + ttl_ms : 0;
+
+    uint64_t hash = map->hash_func(key_data, key_size);
+    HashTTLEntry *entry = *hashttl_find_link(map, hash, key_data, key_size);
+    if (entry)
+    {
+        // Key found (live or not yet swept), update value and deadline
+        HashMapData new_value;
+        if (hashmap_data_store(&new_value, val_data, val_size) != 0)
+            return -1;
+        hashmap_data_release(&entry->value, entry->value_size);
+        entry->value = new_value;
+        entry->value_size = val_size;
+        entry->deadline = deadline;
+        hashttl_schedule(map, entry);
+        return 0;
+    }
+
+    // Resize if load factor exceeded
+    if (hashmap_chain_full(map->size, map->capacity, map->load_factor))
+    {
+        if (hashttl_resize(map, map->capacity * 2) != 0)
+        {
+            fprintf(stderr, "Warning: hashttl resizing failed.\n");
+        }
+    }
+
+    entry = (HashTTLEntry *)malloc(sizeof(HashTTLEntry));
+    if (!entry)
+        return -1;
+    if (hashmap_data_store(&entry->key, key_data, key_size) != 0)
+    {
+        free(entry);
+        return -1;
+    }
+    if (hashmap_data_store(&entry->value, val_data, val_size) != 0)
+    {
+        hashmap_data_release(&entry->key, key_size);
+        free(entry);
+        return -1;
+    }
+    entry->key_size = key_size;
+    entry->value_size = val_size;
+    entry->deadline = deadline;
+    entry->wheel_next = NULL;
+    entry->wheel_pprev = NULL;
+
+    size_t index = hashmap_chain_index(hash, map->capacity);
+    entry->next = map->buckets[index];
+    map->buckets[index] = entry;
+    map->size++;
+    hashttl_schedule(map, entry);
+    return 0;
+}
+
+/**
+ * Look up a live entry, removing it instead if it has expired.
+ */
+static HashTTLEntry *hashttl_lookup(HashTTLMap *map, const void *key_data, size_t key_size)
+{
+    HashTTLEntry **link = hashttl_find_link(map, map->hash_func(key_data, key_size), key_data, key_size);
+    HashTTLEntry *entry = *link;
+    if (entry && hashttl_expired(entry, hashttl_now(map)))
+    {
+        hashttl_unlink_entry(map, link, entry, 1);
+        return NULL;
+    }
+    return entry;
+}
+
+void *hashttl_find(HashTTLMap *map,
+                   const void *key_data, size_t key_size,
+                   size_t *out_size)
+{
+    if (!map || !key_data || key_size == 0)
+        return NULL;
+
+    HashTTLEntry *entry = hashttl_lookup(map, key_data, key_size);
+    if (!entry)
+        return NULL;
+    if (out_size)
+        *out_size = entry->value_size;
+    return hashttl_entry_value(entry);
+}
+
+int hashttl_get(HashTTLMap *map,
+                const void *key_data, size_t key_size,
+                void **out_val, size_t *out_size)
+{
+    if (!map || !key_data || key_size == 0)
+        return -1;
+
+    HashTTLEntry *entry = hashttl_lookup(map, key_data, key_size);
+    if (!entry)
+        return 0;
+
+    if (out_val && out_size)
+    {
+        *out_val = malloc(entry->value_size);
+        if (!(*out_val))
+        {
+            return -1; // memory error
+        }
+        memcpy(*out_val, hashttl_entry_value(entry), entry->value_size);
+        *out_size = entry->value_size;
+    }
+    return 1;
+}
+
+int hashttl_set_ttl(HashTTLMap *map,
+                    const void *key_data, size_t key_size,
+                    uint64_t ttl_ms)
+{
+    if (!map || !key_data || key_size == 0)
+        return -1;
+
+    HashTTLEntry *entry = hashttl_lookup(map, key_data, key_size);
+    if (!entry)
+        return 0;
+    entry->deadline = (ttl_ms > 0) ? hashttl_now(map) + ttl_ms : 0;
+    hashttl_schedule(map, entry);
+    return 1;
+}
+
+int hashttl_remove(HashTTLMap *map, const void *key_data, size_t key_size)
+{
+    if (!map || !key_data || key_size == 0)
+        return -1;
+
+    HashTTLEntry **link = hashttl_find_link(map, map->hash_func(key_data, key_size), key_data, key_size);
+    HashTTLEntry *entry = *link;
+    if (!entry)
+        return 0;
+    hashttl_unlink_entry(map, link, entry, 0);
+    return 1;
+}
+
+size_t hashttl_tick(HashTTLMap *map)
+{
+    if (!map || !map->buckets)
+        return 0;
+    return hashttl_advance(map, hashttl_now(map) / map->tick_ms);
+}
@@ -0,0 +1,493 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/chashimage.h"
+#include "../include/chashmap.h"
+
+/*
+ * Regression checks for the parts of the library that are hard to exercise
+ * from the example program: write-ahead log recovery, map image validation,
+ * and the parallel build and resize paths against plain hashmap_insert().
+ *
+ * Usage: chashmap_check   (run by `make check`; exits non-zero on failure)
+ */
+
+static int failures;
+static char dir[] = "/tmp/chashmap_check.XXXXXX";
+
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        if (!(cond))                                                         \
+        {                                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                    #cond);                                                  \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+static void path_in_dir(char *buf, size_t size, const char *name)
+{
+    snprintf(buf, size, "%s/%s", dir, name);
+}
+
+static void remove_log(const char *path)
+{
+    char ckpt[512];
+    snprintf(ckpt, sizeof(ckpt), "%s.ckpt", path);
+    unlink(path);
+    unlink(ckpt);
+}
+
+static off_t file_size(const char *path)
+{
+    struct stat st;
+    return (stat(path, &st) == 0) ? st.st_size : -1;
+}
+
+static size_t key_of(char *buf, size_t size, int i)
+{
+    return (size_t)snprintf(buf, size, "key%d", i);
+}
+
+static int insert_int(HashMap *map, int i)
+{
+    char key[32];
+    size_t len = key_of(key, sizeof(key), i);
+    return hashmap_insert(map, key, len, &i, sizeof(i));
+}
+
+/**
+ * 1 if key i maps to value i, 0 if absent, -1 if present with another value.
+ */
+static int lookup_int(const HashMap *map, int i)
+{
+    char key[32];
+    size_t len = key_of(key, sizeof(key), i);
+    void *val = NULL;
+    size_t val_size = 0;
+    if (hashmap_get(map, key, len, &val, &val_size) != 1)
+        return 0;
+    int ok = (val_size == sizeof(i) && memcmp(val, &i, sizeof(i)) == 0);
+    free(val);
+    return ok ? 1 : -1;
+}
+
+/**
+ * 1 if both maps hold the same keys with the same values.
+ */
+static int maps_equal(const HashMap *a, const HashMap *b)
+{
+    if (a->size != b->size)
+        return 0;
+    for (size_t i = 0; i < a->capacity; i++)
+    {
+        for (const HashMapEntry *entry = a->buckets[i]; entry; entry = entry->next)
+        {
+            void *val = NULL;
+            size_t val_size = 0;
+            if (hashmap_get(b, hashmap_entry_key(entry), entry->key_size, &val, &val_size) != 1)
+                return 0;
+            int same = (val_size == entry->value_size &&
+                        memcmp(val, hashmap_entry_value(entry), val_size) == 0);
+            free(val);
+            if (!same)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static int read_file(const char *path, unsigned char **data, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+    fseek(fp, 0, SEEK_END);
+    *size = (size_t)ftell(fp);
+    rewind(fp);
+    *data = (unsigned char *)malloc(*size ? *size : 1);
+    int status = (*data && fread(*data, 1, *size, fp) == *size) ? 0 : -1;
+    fclose(fp);
+    return status;
+}
+
+static int write_file(const char *path, const unsigned char *data, size_t size)
+{
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+        return -1;
+    int status = (fwrite(data, 1, size, fp) == size) ? 0 : -1;
+    return (fclose(fp) == 0) ? status : -1;
+}
+
+static uint32_t crc32c(const unsigned char *data, size_t size)
+{
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+    {
+        c ^= data[i];
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+/**
+ * A log cut off in the middle of its last record loses only that record.
+ */
+static void check_wal_torn_tail(void)
+{
+    char path[256];
+    path_in_dir(path, sizeof(path), "torn.log");
+    remove_log(path);
+
+    HashMap map;
+    CHECK(hashmap_wal_open(&map, path, NULL, NULL, 0, 1) == 0);
+    for (int i = 0; i < 100; i++)
+        CHECK(insert_int(&map, i) == 0);
+    hashmap_destroy(&map);
+
+    // The last record is 13 header bytes, "key99" and an int
+    off_t full = file_size(path);
+    off_t last_record = 13 + 5 + (off_t)sizeof(int);
+    CHECK(truncate(path, full - 3) == 0);
+
+    CHECK(hashmap_wal_open(&map, path, NULL, NULL, 0, 1) == 0);
+    CHECK(map.size == 99);
+    for (int i = 0; i < 99; i++)
+        CHECK(lookup_int(&map, i) == 1);
+    CHECK(lookup_int(&map, 99) == 0);
+    CHECK(file_size(path) == full - last_record);
+
+    // The log keeps working after the tail was cut
+    CHECK(insert_int(&map, 99) == 0);
+    hashmap_destroy(&map);
+    CHECK(hashmap_wal_open(&map, path, NULL, NULL, 0, 1) == 0);
+    CHECK(map.size == 100 && lookup_int(&map, 99) == 1);
+    hashmap_destroy(&map);
+    remove_log(path);
+}
+
+/**
+ * Records after a checkpoint replay onto it, and a crash between writing
+ * the checkpoint and truncating the log replays the old log onto the new
+ * checkpoint without changing the result.
+ */
+static void check_wal_checkpoint(void)
+{
+    char path[256];
+    path_in_dir(path, sizeof(path), "ckpt.log");
+    remove_log(path);
+
+    HashMap map;
+    CHECK(hashmap_wal_open(&map, path, NULL, NULL, 0, 8) == 0);
+    for (int i = 0; i < 50; i++)
+        CHECK(insert_int(&map, i) == 0);
+    CHECK(hashmap_remove(&map, "key10", 5) == 1);
+    CHECK(hashmap_wal_sync(&map) == 0);
+
+    unsigned char *old_log = NULL;
+    size_t old_size = 0;
+    CHECK(read_file(path, &old_log, &old_size) == 0);
+
+    CHECK(hashmap_wal_checkpoint(&map) == 0);
+    for (int i = 50; i < 60; i++)
+        CHECK(insert_int(&map, i) == 0);
+    hashmap_destroy(&map);
+
+    CHECK(hashmap_wal_open(&map, path, NULL, NULL, 0, 8) == 0);
+    CHECK(map.size == 59);
+    for (int i = 0; i < 60; i++)
+        CHECK(lookup_int(&map, i) == (i == 10 ? 0 : 1));
+    hashmap_destroy(&map);
+
+    // Put back the log as it was just before the checkpoint truncated it
+    CHECK(old_log && write_file(path, old_log, old_size) == 0);
+    free(old_log);
+    CHECK(hashmap_wal_open(&map, path, NULL, NULL, 0, 8) == 0);
+    CHECK(map.size == 49);
+    for (int i = 0; i < 50; i++)
+        CHECK(lookup_int(&map, i) == (i == 10 ? 0 : 1));
+    hashmap_destroy(&map);
+    remove_log(path);
+}
+
+/**
+ * A commit that cannot reach the disk fails its operation, leaves no trace
+ * in the log and makes the log refuse further operations; reopening resumes
+ * from the committed state.
+ */
+static void check_wal_sticky_error(void)
+{
+    char path[256];
+    path_in_dir(path, sizeof(path), "sticky.log");
+    remove_log(path);
+
+    HashMap map;
+    CHECK(hashmap_wal_open(&map, path, NULL, NULL, 0, 1) == 0);
+    for (int i = 0; i < 10; i++)
+        CHECK(insert_int(&map, i) == 0);
+    off_t committed = file_size(path);
+
+    // Let the next write get only part of its record onto the disk
+    struct rlimit saved, limit;
+    void (*old_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+    CHECK(getrlimit(RLIMIT_FSIZE, &saved) == 0);
+    limit = saved;
+    limit.rlim_cur = (rlim_t)committed + 8;
+    CHECK(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+    char big[256] = {0};
+    int status = hashmap_insert(&map, "big", 3, big, sizeof(big));
+    CHECK(setrlimit(RLIMIT_FSIZE, &saved) == 0);
+    signal(SIGXFSZ, old_handler);
+
+    CHECK(status != 0);
+    CHECK(hashmap_get(&map, "big", 3, NULL, NULL) == 0);
+    CHECK(file_size(path) == committed);
+    CHECK(insert_int(&map, 10) != 0);
+    CHECK(hashmap_wal_sync(&map) != 0);
+    hashmap_destroy(&map);
+
+    CHECK(hashmap_wal_open(&map, path, NULL, NULL, 0, 1) == 0);
+    CHECK(map.size == 10);
+    CHECK(hashmap_get(&map, "big", 3, NULL, NULL) == 0);
+    CHECK(insert_int(&map, 10) == 0);
+    hashmap_destroy(&map);
+    CHECK(hashmap_wal_open(&map, path, NULL, NULL, 0, 1) == 0);
+    CHECK(map.size == 11 && lookup_int(&map, 10) == 1);
+    hashmap_destroy(&map);
+    remove_log(path);
+}
+
+/**
+ * A record that passes its CRC but cannot be applied fails the open and
+ * leaves the log as it was.
+ */
+static void check_wal_bad_record(void)
+{
+    char path[256];
+    path_in_dir(path, sizeof(path), "bad.log");
+    remove_log(path);
+
+    HashMap map;
+    CHECK(hashmap_wal_open(&map, path, NULL, NULL, 0, 1) == 0);
+    CHECK(insert_int(&map, 0) == 0);
+    CHECK(insert_int(&map, 1) == 0);
+    hashmap_destroy(&map);
+
+    // Give the second record an unknown op and a matching CRC
+    unsigned char *log = NULL;
+    size_t size = 0;
+    CHECK(read_file(path, &log, &size) == 0);
+    size_t record = 13 + 4 + sizeof(int);
+    CHECK(log && size == 16 + 2 * record);
+    if (!log || size != 16 + 2 * record)
+    {
+        free(log);
+        return;
+    }
+    unsigned char *rec = log + 16 + record;
+    rec[4] = 7;
+    uint32_t crc = crc32c(rec + 4, record - 4);
+    memcpy(rec, &crc, sizeof(crc));
+    CHECK(write_file(path, log, size) == 0);
+
+    CHECK(hashmap_wal_open(&map, path, NULL, NULL, 0, 1) != 0);
+    unsigned char *after = NULL;
+    size_t after_size = 0;
+    CHECK(read_file(path, &after, &after_size) == 0);
+    CHECK(after && after_size == size && memcmp(after, log, size) == 0);
+    free(after);
+    free(log);
+    remove_log(path);
+}
+
+static uint64_t other_hash(const void *data, size_t size)
+{
+    return hashmap_hash_bytes(data, size) ^ 0x5555555555555555ULL;
+}
+
+/**
+ * Corrupt or mismatched images are rejected at open or at lookup, never
+ * read out of bounds.
+ */
+static void check_image_corrupt(void)
+{
+    char path[256];
+    path_in_dir(path, sizeof(path), "map.img");
+
+    HashMap map;
+    CHECK(hashmap_init(&map, 0, NULL, NULL, 0.0f) == 0);
+    for (int i = 0; i < 1000; i++)
+        CHECK(insert_int(&map, i) == 0);
+    CHECK(hashmap_image_write(&map, path) == 0);
+    hashmap_destroy(&map);
+
+    HashMapImage image;
+    CHECK(hashmap_image_open(&image, path, NULL, NULL) == 0);
+    size_t found = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        char key[32];
+        size_t len = key_of(key, sizeof(key), i);
+        const void *val;
+        size_t val_size;
+        found += (hashmap_image_get(&image, key, len, &val, &val_size) == 1 &&
+                  val_size == sizeof(i) && memcmp(val, &i, sizeof(i)) == 0);
+    }
+    CHECK(found == 1000);
+    size_t offsets_pos = (size_t)((const unsigned char *)image.offsets - image.base);
+    size_t nbuckets = image.nbuckets;
+    hashmap_image_close(&image);
+
+    CHECK(hashmap_image_open(&image, path, other_hash, NULL) != 0);
+
+    unsigned char *data = NULL;
+    size_t size = 0;
+    CHECK(read_file(path, &data, &size) == 0);
+    if (!data)
+        return;
+
+    // Bad magic
+    data[0] ^= 0xFF;
+    CHECK(write_file(path, data, size) == 0);
+    CHECK(hashmap_image_open(&image, path, NULL, NULL) != 0);
+    data[0] ^= 0xFF;
+
+    // Truncated inside the offset table
+    CHECK(write_file(path, data, offsets_pos + 8) == 0);
+    CHECK(hashmap_image_open(&image, path, NULL, NULL) != 0);
+
+    // Bucket offsets past the record region, misaligned and out of order
+    for (size_t b = 0; b <= nbuckets; b++)
+    {
+        uint64_t offset = UINT64_MAX - 3 * b;
+        memcpy(data + offsets_pos + b * sizeof(uint64_t), &offset, sizeof(offset));
+    }
+    CHECK(write_file(path, data, size) == 0);
+    CHECK(hashmap_image_open(&image, path, NULL, NULL) == 0);
+    size_t errors = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        char key[32];
+        size_t len = key_of(key, sizeof(key), i);
+        const void *val;
+        size_t val_size;
+        errors += (hashmap_image_get(&image, key, len, &val, &val_size) < 0);
+    }
+    CHECK(errors == 1000);
+    hashmap_image_close(&image);
+    free(data);
+    unlink(path);
+}
+
+/**
+ * hashmap_build_bulk() (parallel path, with repeated keys) gives the map
+ * that inserting the pairs one by one gives.
+ */
+static void check_build_bulk(void)
+{
+    enum { N = 200000, DISTINCT = 150000 };
+    uint64_t *key_data = (uint64_t *)malloc(N * sizeof(uint64_t));
+    uint64_t *val_data = (uint64_t *)malloc(N * sizeof(uint64_t));
+    const void **keys = (const void **)malloc(N * sizeof(void *));
+    const void **vals = (const void **)malloc(N * sizeof(void *));
+    size_t *sizes = (size_t *)malloc(N * sizeof(size_t));
+    CHECK(key_data && val_data && keys && vals && sizes);
+    if (!key_data || !val_data || !keys || !vals || !sizes)
+        goto out;
+
+    for (size_t i = 0; i < N; i++)
+    {
+        key_data[i] = i % DISTINCT; // Pairs from DISTINCT on repeat earlier keys
+        val_data[i] = i;
+        keys[i] = &key_data[i];
+        vals[i] = &val_data[i];
+        sizes[i] = sizeof(uint64_t);
+    }
+
+    HashMap bulk, serial;
+    CHECK(hashmap_init(&bulk, 0, NULL, NULL, 0.0f) == 0);
+    CHECK(hashmap_init(&serial, 0, NULL, NULL, 0.0f) == 0);
+    CHECK(hashmap_build_bulk(&bulk, keys, sizes, vals, sizes, N, 4) == 0);
+    for (size_t i = 0; i < N; i++)
+        CHECK(hashmap_insert(&serial, keys[i], sizes[i], vals[i], sizes[i]) == 0);
+    CHECK(bulk.size == DISTINCT);
+    CHECK(maps_equal(&bulk, &serial));
+    hashmap_destroy(&bulk);
+    hashmap_destroy(&serial);
+
+out:
+    free(key_data);
+    free(val_data);
+    free(keys);
+    free(vals);
+    free(sizes);
+}
+
+/**
+ * A parallel resize leaves every chain exactly as a serial one does.
+ */
+static void check_parallel_resize(void)
+{
+    HashMap parallel, serial;
+    CHECK(hashmap_init(&parallel, 0, NULL, NULL, 0.0f) == 0);
+    CHECK(hashmap_init(&serial, 0, NULL, NULL, 0.0f) == 0);
+    CHECK(hashmap_set_resize_threads(&parallel, 4) == 0);
+    for (int i = 0; i < 300000; i++)
+    {
+        CHECK(insert_int(&parallel, i) == 0);
+        CHECK(insert_int(&serial, i) == 0);
+    }
+    CHECK(parallel.capacity == serial.capacity && parallel.capacity >= 65536);
+    CHECK(maps_equal(&parallel, &serial));
+
+    size_t same_chains = 0;
+    for (size_t b = 0; b < serial.capacity && b < parallel.capacity; b++)
+    {
+        const HashMapEntry *p = parallel.buckets[b], *s = serial.buckets[b];
+        while (p && s && p->key_size == s->key_size &&
+               memcmp(hashmap_entry_key(p), hashmap_entry_key(s), p->key_size) == 0)
+        {
+            p = p->next;
+            s = s->next;
+        }
+        same_chains += (!p && !s);
+    }
+    CHECK(same_chains == serial.capacity);
+    hashmap_destroy(&parallel);
+    hashmap_destroy(&serial);
+}
+
+int main(void)
+{
+    if (!mkdtemp(dir))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    check_wal_torn_tail();
+    check_wal_checkpoint();
+    check_wal_sticky_error();
+    check_wal_bad_record();
+    check_image_corrupt();
+    check_build_bulk();
+    check_parallel_resize();
+    rmdir(dir);
+
+    if (failures)
+    {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}